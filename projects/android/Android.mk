@@ -18,6 +18,24 @@ LOCAL_SRC_FILES        := \
     $(SRC_PATH)/liability.c \
     $(SRC_PATH)/expense.c \
     $(SRC_PATH)/profile.c \
+    $(SRC_PATH)/stats.c \
+    $(SRC_PATH)/events.c \
+    $(SRC_PATH)/factors.c \
+    $(SRC_PATH)/solver.c \
+    $(SRC_PATH)/payoff.c \
+    $(SRC_PATH)/diff.c \
+    $(SRC_PATH)/encode.c \
+    $(SRC_PATH)/store.c \
+    $(SRC_PATH)/query.c \
+    $(SRC_PATH)/handle.c \
+    $(SRC_PATH)/projection.c \
+    $(SRC_PATH)/calendar.c \
+    $(SRC_PATH)/inflation.c \
+    $(SRC_PATH)/rebalance.c \
+    $(SRC_PATH)/lots.c \
+    $(SRC_PATH)/prices.c \
+    $(SRC_PATH)/currency.c \
+    $(SRC_PATH)/backtest.c \
     $(SRC_PATH)/wealth.c
 
 include $(BUILD_SHARED_LIBRARY)
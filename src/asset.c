@@ -44,13 +44,5 @@ void financial_asset_set_class( financial_asset_t* asset, financial_asset_class_
 
 value_t financial_asset_collection_sum( const financial_asset_t* collection )
 {
-	value_t sum = 0.0;
-	const size_t count = vector_size( collection );
-
-	for( size_t i = 0; i < count; i++ )
-	{
-		sum += collection[ i ].base.amount;
-	}
-
-	return sum;
+	return financial_item_amount_sum( collection, sizeof(*collection), vector_size( collection ) );
 }
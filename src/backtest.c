@@ -0,0 +1,712 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <assert.h>
+#ifdef __ANDROID__
+#include <vector.h>
+#else
+#include <libcollections/vector.h>
+#endif
+#include "wealth.h"
+#include "backtest.h"
+#include "item.h"
+#include "profile.h"
+#include "parallel.h"
+
+/* Windows handed to a worker at a time. */
+#define BACKTEST_BLOCK        (16)
+
+/* Series start on a cache line, so the monthly loops run over aligned memory. */
+#define BACKTEST_ALIGNMENT    (64)
+
+/* Longest line accepted in a history file. */
+#define BACKTEST_LINE_SIZE    (1024)
+
+/* How far the weights may sum away from one. */
+#define BACKTEST_EPSILON      (1e-9)
+
+/* One series per class, each padded to a whole number of cache lines. */
+struct financial_return_history {
+	uint32_t first;      /* year * 12 + month - 1 */
+	size_t   months;
+	size_t   stride;
+	uint32_t present;    /* a bit per class with a series */
+	double*  returns;
+};
+
+static const char* const BACKTEST_CLASS_NAMES[ FINANCIAL_ASSET_CLASS_COUNT ] = {
+	"unspecified", "cash", "equity", "fixed_income", "money_market", "real_estate", "guaranteed", "commodities"
+};
+
+
+financial_return_history_t* financial_return_history_create( uint32_t first_year, uint32_t first_month, size_t months )
+{
+	financial_return_history_t* history = NULL;
+	size_t per_line = BACKTEST_ALIGNMENT / sizeof(double);
+
+	if( months == 0 || first_month < 1 || first_month > 12 || first_year > UINT32_MAX / 12 - 1 ||
+	    months > SIZE_MAX / (FINANCIAL_ASSET_CLASS_COUNT * sizeof(double)) - per_line )
+	{
+		goto done;
+	}
+
+	history = malloc( sizeof(financial_return_history_t) );
+
+	if( history )
+	{
+		void* returns = NULL;
+
+		history->first   = first_year * 12 + first_month - 1;
+		history->months  = months;
+		history->stride  = (months + per_line - 1) / per_line * per_line;
+		history->present = 0;
+
+		if( posix_memalign( &returns, BACKTEST_ALIGNMENT, FINANCIAL_ASSET_CLASS_COUNT * history->stride * sizeof(double) ) != 0 )
+		{
+			free( history );
+			history = NULL;
+			goto done;
+		}
+
+		history->returns = returns;
+		memset( history->returns, 0, FINANCIAL_ASSET_CLASS_COUNT * history->stride * sizeof(double) );
+	}
+
+done:
+	return history;
+}
+
+void financial_return_history_destroy( financial_return_history_t** p_history )
+{
+	if( p_history && *p_history )
+	{
+		free( (*p_history)->returns );
+		free( *p_history );
+		*p_history = NULL;
+	}
+}
+
+size_t financial_return_history_months( const financial_return_history_t* history )
+{
+	assert( history );
+	return history->months;
+}
+
+void financial_return_history_date( const financial_return_history_t* history, size_t month, uint32_t* year, uint32_t* month_of_year )
+{
+	assert( history );
+	uint64_t index = (uint64_t) history->first + month;
+
+	if( year )          *year          = (uint32_t) (index / 12);
+	if( month_of_year ) *month_of_year = (uint32_t) (index % 12) + 1;
+}
+
+bool financial_return_history_set( financial_return_history_t* history, financial_asset_class_t asset_class, const double* returns, size_t count )
+{
+	assert( history );
+	assert( returns || count == 0 );
+
+	if( (size_t) asset_class >= FINANCIAL_ASSET_CLASS_COUNT || count != history->months )
+	{
+		return false;
+	}
+
+	for( size_t m = 0; m < count; m++ )
+	{
+		if( !(returns[ m ] >= -1.0) || !isfinite( returns[ m ] ) )
+		{
+			return false;
+		}
+	}
+
+	memcpy( history->returns + (size_t) asset_class * history->stride, returns, count * sizeof(double) );
+	history->present |= 1u << asset_class;
+	return true;
+}
+
+const double* financial_return_history_series( const financial_return_history_t* history, financial_asset_class_t asset_class )
+{
+	assert( history );
+
+	if( (size_t) asset_class >= FINANCIAL_ASSET_CLASS_COUNT || !(history->present & (1u << asset_class)) )
+	{
+		return NULL;
+	}
+
+	return history->returns + (size_t) asset_class * history->stride;
+}
+
+/* Cuts the next comma separated field out of a line, trimmed of spaces. */
+static char* backtest_field( char** line )
+{
+	char* s = *line;
+	char* end;
+
+	if( !s )
+	{
+		return NULL;
+	}
+
+	while( isspace( (unsigned char) *s ) ) s++;
+	end = strchr( s, ',' );
+	*line = end ? end + 1 : NULL;
+	end = end ? end : s + strlen( s );
+
+	while( end > s && isspace( (unsigned char) end[ -1 ] ) ) end--;
+	*end = '\0';
+	return s;
+}
+
+static bool backtest_class( const char* name, financial_asset_class_t* asset_class )
+{
+	for( size_t c = 0; c < FINANCIAL_ASSET_CLASS_COUNT; c++ )
+	{
+		const char* a = name;
+		const char* b = BACKTEST_CLASS_NAMES[ c ];
+
+		while( *a && tolower( (unsigned char) *a ) == *b )
+		{
+			a++;
+			b++;
+		}
+
+		if( *a == '\0' && *b == '\0' )
+		{
+			*asset_class = (financial_asset_class_t) c;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Parses YYYY-MM, allowing a trailing -DD, into year * 12 + month - 1. */
+static bool backtest_date( const char* field, uint32_t* index )
+{
+	char* end;
+	unsigned long year = strtoul( field, &end, 10 );
+	unsigned long month;
+
+	if( end == field || *end != '-' || year > UINT32_MAX / 12 - 1 )
+	{
+		return false;
+	}
+
+	field = end + 1;
+	month = strtoul( field, &end, 10 );
+
+	if( end == field || month < 1 || month > 12 )
+	{
+		return false;
+	}
+
+	if( *end == '-' )
+	{
+		field = end + 1;
+		strtoul( field, &end, 10 );
+		if( end == field )
+		{
+			return false;
+		}
+	}
+
+	*index = (uint32_t) (year * 12 + month - 1);
+	return *end == '\0';
+}
+
+financial_return_history_t* financial_return_history_load( const char* filename )
+{
+	assert( filename );
+	financial_return_history_t* history = NULL;
+	FILE* file = fopen( filename, "r" );
+	char line[ BACKTEST_LINE_SIZE ];
+	financial_asset_class_t columns[ FINANCIAL_ASSET_CLASS_COUNT ];
+	size_t column_count = 0;
+	uint32_t first = 0;
+	size_t months = 0;
+	double* values = NULL; /* row major, column_count per month */
+	bool ok = true;
+
+	if( !file )
+	{
+		goto done;
+	}
+
+	vector_create( values, 12 * FINANCIAL_ASSET_CLASS_COUNT );
+
+	while( ok && fgets( line, sizeof(line), file ) )
+	{
+		size_t length = strlen( line );
+		char* s = line;
+
+		if( length == sizeof(line) - 1 && line[ length - 1 ] != '\n' && !feof( file ) )
+		{
+			ok = false;
+			break;
+		}
+
+		while( isspace( (unsigned char) *s ) ) s++;
+		if( *s == '\0' || *s == '#' )
+		{
+			continue;
+		}
+
+		char* field = backtest_field( &s );
+
+		if( column_count == 0 )
+		{
+			/* The header: a date column, then the classes. */
+			uint32_t seen = 0;
+
+			while( ok && (field = backtest_field( &s )) != NULL )
+			{
+				financial_asset_class_t asset_class;
+
+				if( column_count == FINANCIAL_ASSET_CLASS_COUNT || !backtest_class( field, &asset_class ) || (seen & (1u << asset_class)) )
+				{
+					ok = false;
+					break;
+				}
+
+				seen |= 1u << asset_class;
+				columns[ column_count++ ] = asset_class;
+			}
+
+			ok = ok && column_count > 0;
+			continue;
+		}
+
+		uint32_t index;
+
+		if( !backtest_date( field, &index ) || (months > 0 && index != first + months) )
+		{
+			ok = false;
+			break;
+		}
+
+		if( months == 0 )
+		{
+			first = index;
+		}
+
+		for( size_t c = 0; c < column_count; c++ )
+		{
+			char* end;
+			double value;
+
+			field = backtest_field( &s );
+			value = field ? strtod( field, &end ) : 0.0;
+
+			if( !field || end == field || *end != '\0' || !(value >= -1.0) || !isfinite( value ) )
+			{
+				ok = false;
+				break;
+			}
+
+			vector_push( values, value );
+		}
+
+		ok = ok && s == NULL;
+		months += 1;
+	}
+
+	if( ok && !ferror( file ) && months > 0 )
+	{
+		history = financial_return_history_create( first / 12, first % 12 + 1, months );
+	}
+
+	for( size_t c = 0; history && c < column_count; c++ )
+	{
+		double* series = history->returns + (size_t) columns[ c ] * history->stride;
+
+		for( size_t m = 0; m < months; m++ )
+		{
+			series[ m ] = values[ m * column_count + c ];
+		}
+
+		history->present |= 1u << columns[ c ];
+	}
+
+	vector_destroy( values );
+	fclose( file );
+
+done:
+	return history;
+}
+
+
+typedef struct backtest_job {
+	const financial_backtest_plan_t* plan;
+	const double* blended;   /* weighted monthly returns when rebalancing every month */
+	const double* series[ FINANCIAL_ASSET_CLASS_COUNT ];
+	double weights[ FINANCIAL_ASSET_CLASS_COUNT ];
+	size_t class_count;      /* classes with weight */
+	size_t window_count;
+	financial_backtest_window_t* windows;
+} backtest_job_t;
+
+static bool backtest_plan_valid( const financial_backtest_plan_t* plan )
+{
+	double sum = 0.0;
+
+	if( plan->months == 0 || plan->months > UINT32_MAX || !(plan->initial >= 0) || !isfinite( plan->initial ) ||
+	    !isfinite( plan->contribution ) || isnan( plan->goal ) )
+	{
+		return false;
+	}
+
+	for( size_t i = 0; i < FINANCIAL_ASSET_CLASS_COUNT; i++ )
+	{
+		if( !(plan->weights[ i ] >= 0) )
+		{
+			return false;
+		}
+		sum += plan->weights[ i ];
+	}
+
+	return fabs( sum - 1.0 ) <= BACKTEST_EPSILON;
+}
+
+static void backtest_window( const backtest_job_t* job, size_t start, financial_backtest_window_t* window )
+{
+	const financial_backtest_plan_t* plan = job->plan;
+	double contribution = plan->contribution;
+	double balance      = plan->initial;
+	double lowest       = HUGE_VAL;
+	uint32_t depleted   = 0;
+
+	if( job->blended )
+	{
+		/* Rebalancing every month holds the weights, so the classes act as one series. */
+		const double* returns = job->blended + start;
+
+		for( size_t m = 0; m < plan->months; m++ )
+		{
+			balance = balance * (1.0 + returns[ m ]) + contribution;
+
+			if( contribution < 0 && balance <= 0 )
+			{
+				depleted = (uint32_t) m + 1;
+				break;
+			}
+
+			lowest = balance < lowest ? balance : lowest;
+		}
+	}
+	else
+	{
+		double holdings[ FINANCIAL_ASSET_CLASS_COUNT ];
+		size_t count = job->class_count;
+		uint32_t rebalance = plan->rebalance_months;
+
+		for( size_t k = 0; k < count; k++ )
+		{
+			holdings[ k ] = balance * job->weights[ k ];
+		}
+
+		for( size_t m = 0; m < plan->months; m++ )
+		{
+			balance = 0.0;
+
+			for( size_t k = 0; k < count; k++ )
+			{
+				holdings[ k ] *= 1.0 + job->series[ k ][ start + m ];
+				balance += holdings[ k ];
+			}
+
+			if( contribution >= 0 )
+			{
+				for( size_t k = 0; k < count; k++ )
+				{
+					holdings[ k ] += contribution * job->weights[ k ];
+				}
+			}
+			else if( balance + contribution > 0 )
+			{
+				double scale = (balance + contribution) / balance;
+
+				for( size_t k = 0; k < count; k++ )
+				{
+					holdings[ k ] *= scale;
+				}
+			}
+
+			balance += contribution;
+
+			if( contribution < 0 && balance <= 0 )
+			{
+				depleted = (uint32_t) m + 1;
+				break;
+			}
+
+			if( rebalance > 0 && (m + 1) % rebalance == 0 )
+			{
+				for( size_t k = 0; k < count; k++ )
+				{
+					holdings[ k ] = balance * job->weights[ k ];
+				}
+			}
+
+			lowest = balance < lowest ? balance : lowest;
+		}
+	}
+
+	if( depleted )
+	{
+		balance = 0.0;
+		lowest  = 0.0;
+	}
+
+	window->start    = start;
+	window->final    = balance;
+	window->lowest   = lowest;
+	window->depleted = depleted;
+	window->success  = !depleted && balance >= plan->goal;
+}
+
+static void backtest_task( size_t block, size_t worker, void* data )
+{
+	backtest_job_t* job = data;
+	size_t first = block * BACKTEST_BLOCK;
+	size_t last  = first + BACKTEST_BLOCK < job->window_count ? first + BACKTEST_BLOCK : job->window_count;
+
+	for( size_t w = first; w < last; w++ )
+	{
+		backtest_window( job, w, &job->windows[ w ] );
+	}
+}
+
+static int backtest_compare( const void* l, const void* r )
+{
+	double a = *(const double*) l;
+	double b = *(const double*) r;
+	return (a > b) - (a < b);
+}
+
+/* Linear interpolation between the closest ranks. */
+static double backtest_percentile( const double* sorted, size_t count, double percentile )
+{
+	double rank = percentile * (double) (count - 1);
+	size_t low  = (size_t) rank;
+
+	if( low + 1 >= count )
+	{
+		return sorted[ count - 1 ];
+	}
+
+	return sorted[ low ] + (rank - (double) low) * (sorted[ low + 1 ] - sorted[ low ]);
+}
+
+static bool backtest_summarize( const financial_backtest_window_t* windows, size_t count, financial_backtest_summary_t* summary )
+{
+	double* finals = malloc( count * sizeof(double) );
+
+	if( !finals )
+	{
+		return false;
+	}
+
+	memset( summary, 0, sizeof(financial_backtest_summary_t) );
+	summary->windows = count;
+	summary->worst   = windows[ 0 ].final;
+	summary->best    = windows[ 0 ].final;
+
+	for( size_t w = 0; w < count; w++ )
+	{
+		const financial_backtest_window_t* window = &windows[ w ];
+
+		summary->successes  += window->success;
+		summary->depletions += window->depleted != 0;
+		summary->mean       += window->final;
+
+		if( window->final < summary->worst )
+		{
+			summary->worst       = window->final;
+			summary->worst_start = window->start;
+		}
+		if( window->final > summary->best )
+		{
+			summary->best       = window->final;
+			summary->best_start = window->start;
+		}
+
+		finals[ w ] = window->final;
+	}
+
+	qsort( finals, count, sizeof(double), backtest_compare );
+
+	summary->success_rate = (double) summary->successes / (double) count;
+	summary->mean        /= (double) count;
+	summary->median       = backtest_percentile( finals, count, 0.5 );
+	summary->p10          = backtest_percentile( finals, count, 0.1 );
+	summary->p90          = backtest_percentile( finals, count, 0.9 );
+
+	free( finals );
+	return true;
+}
+
+size_t financial_backtest_window_count( const financial_return_history_t* history, const financial_backtest_plan_t* plan )
+{
+	assert( history );
+	assert( plan );
+	return plan->months > 0 && plan->months <= history->months ? history->months - plan->months + 1 : 0;
+}
+
+bool financial_backtest_run( const financial_return_history_t* history, const financial_backtest_plan_t* plan,
+                             financial_backtest_window_t* windows, financial_backtest_summary_t* summary )
+{
+	assert( history );
+	assert( plan );
+	size_t window_count = financial_backtest_window_count( history, plan );
+	double* blended = NULL;
+	bool result = false;
+	backtest_job_t job = {
+		.plan         = plan,
+		.blended      = NULL,
+		.class_count  = 0,
+		.window_count = window_count,
+		.windows      = windows
+	};
+
+	if( window_count == 0 || !backtest_plan_valid( plan ) )
+	{
+		goto done;
+	}
+
+	for( size_t c = 0; c < FINANCIAL_ASSET_CLASS_COUNT; c++ )
+	{
+		if( plan->weights[ c ] > 0 )
+		{
+			const double* series = financial_return_history_series( history, (financial_asset_class_t) c );
+
+			if( !series )
+			{
+				goto done;
+			}
+
+			job.series[ job.class_count ]  = series;
+			job.weights[ job.class_count ] = plan->weights[ c ];
+			job.class_count += 1;
+		}
+	}
+
+	if( !job.windows )
+	{
+		job.windows = malloc( window_count * sizeof(financial_backtest_window_t) );
+		if( !job.windows )
+		{
+			goto done;
+		}
+	}
+
+	if( plan->rebalance_months == 1 )
+	{
+		void* memory = NULL;
+
+		if( posix_memalign( &memory, BACKTEST_ALIGNMENT, history->stride * sizeof(double) ) != 0 )
+		{
+			goto done;
+		}
+
+		/* One pass per class over contiguous series, which compilers vectorise. */
+		blended = memory;
+		memset( blended, 0, history->stride * sizeof(double) );
+
+		for( size_t k = 0; k < job.class_count; k++ )
+		{
+			const double* series = job.series[ k ];
+			double weight = job.weights[ k ];
+
+			for( size_t m = 0; m < history->months; m++ )
+			{
+				blended[ m ] += weight * series[ m ];
+			}
+		}
+
+		job.blended = blended;
+	}
+
+	size_t blocks = (window_count + BACKTEST_BLOCK - 1) / BACKTEST_BLOCK;
+
+	if( window_count * plan->months <= __financial_serial_threshold( ) )
+	{
+		for( size_t b = 0; b < blocks; b++ )
+		{
+			backtest_task( b, 0, &job );
+		}
+	}
+	else
+	{
+		__financial_parallel_for( blocks, backtest_task, &job );
+	}
+
+	result = !summary || backtest_summarize( job.windows, window_count, summary );
+
+done:
+	if( job.windows != windows )
+	{
+		free( job.windows );
+	}
+	free( blended );
+	return result;
+}
+
+bool financial_profile_backtest( const financial_profile_t* profile, const financial_return_history_t* history, size_t months, uint32_t rebalance_months,
+                                 financial_backtest_window_t* windows, financial_backtest_summary_t* summary )
+{
+	assert( profile );
+	assert( history );
+	double totals[ FINANCIAL_ASSET_CLASS_COUNT ];
+	double total = 0.0;
+	financial_backtest_plan_t plan = {
+		.initial          = 0.0,
+		.contribution     = value_to_double( financial_profile_disposable_income( profile ) ),
+		.goal             = value_to_double( financial_profile_goal( profile ) ),
+		.months           = months,
+		.rebalance_months = rebalance_months
+	};
+
+	__financial_profile_class_totals( profile, totals );
+
+	for( size_t c = 0; c < FINANCIAL_ASSET_CLASS_COUNT; c++ )
+	{
+		total += totals[ c ];
+	}
+
+	if( !(total > 0) )
+	{
+		return false;
+	}
+
+	for( size_t c = 0; c < FINANCIAL_ASSET_CLASS_COUNT; c++ )
+	{
+		plan.weights[ c ] = totals[ c ] / total;
+	}
+
+	plan.initial = total;
+	return financial_backtest_run( history, &plan, windows, summary );
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _WEALTH_BACKTEST_H_
+#define _WEALTH_BACKTEST_H_
+#include "wealth.h"
+#include "rebalance.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Return Histories
+ *
+ * A return history holds monthly returns per asset class over a run of
+ * consecutive months. Returns are fractions (0.01 for a 1% gain) and may
+ * not fall below -1. Months are counted from the first one, which is
+ * given by year and month (1 to 12).
+ *
+ * financial_return_history_load() reads a CSV file whose header names a
+ * date column and then one column per class, using the names unspecified,
+ * cash, equity, fixed_income, money_market, real_estate, guaranteed and
+ * commodities (case insensitive). Every other line is a YYYY-MM date
+ * followed by a return per column, one line per month in order. Blank
+ * lines and lines starting with '#' are skipped. A missing month, an
+ * unknown or repeated class or a line that does not parse fails the load.
+ */
+struct financial_return_history;
+typedef struct financial_return_history financial_return_history_t;
+
+financial_return_history_t* financial_return_history_create ( uint32_t first_year, uint32_t first_month, size_t months );
+financial_return_history_t* financial_return_history_load   ( const char* filename );
+void                        financial_return_history_destroy( financial_return_history_t** history );
+size_t                      financial_return_history_months ( const financial_return_history_t* history );
+void                        financial_return_history_date   ( const financial_return_history_t* history, size_t month, uint32_t* year, uint32_t* month_of_year );
+bool                        financial_return_history_set    ( financial_return_history_t* history, financial_asset_class_t asset_class, const double* returns, size_t count );
+const double*               financial_return_history_series ( const financial_return_history_t* history, financial_asset_class_t asset_class );
+
+/*
+ * Backtesting
+ *
+ * A backtest replays a plan over every window of plan->months consecutive
+ * months in the history, one window starting at each month, so a 30 year
+ * plan over 1926 to 2024 runs 829 windows. The balance starts at initial,
+ * split by the weights (indexed by financial_asset_class_t and summing to
+ * one), earns each class's return every month and then receives the
+ * contribution. Contributions are invested by the weights; withdrawals
+ * (negative contributions) are taken in proportion to the holdings.
+ *
+ * With rebalance_months set to 1 the holdings are reset to the weights
+ * every month, every twelfth month with 12, and never with 0, in which
+ * case they drift with returns. A window is depleted once the balance
+ * runs out, and stays empty. It succeeds when it is not depleted and ends
+ * at or above goal.
+ *
+ * Windows run on the library's worker threads (see
+ * financial_set_parallelism()). windows may be NULL; otherwise it receives
+ * financial_backtest_window_count() entries in order of start. A backtest
+ * fails if the plan is invalid, if the history is shorter than a window
+ * or if a class with weight has no series.
+ */
+typedef struct financial_backtest_plan {
+	double   weights[ FINANCIAL_ASSET_CLASS_COUNT ];
+	double   initial;
+	double   contribution;      /* added at the end of every month */
+	double   goal;
+	size_t   months;            /* length of every window */
+	uint32_t rebalance_months;
+} financial_backtest_plan_t;
+
+typedef struct financial_backtest_window {
+	size_t   start;             /* month of the history the window starts at */
+	double   final;
+	double   lowest;            /* lowest month end balance */
+	uint32_t depleted;          /* month the balance ran out, counting from one; 0 if it lasted */
+	bool     success;
+} financial_backtest_window_t;
+
+typedef struct financial_backtest_summary {
+	size_t windows;
+	size_t successes;
+	size_t depletions;
+	double success_rate;
+	double worst;               /* lowest final balance */
+	size_t worst_start;
+	double best;
+	size_t best_start;
+	double mean;
+	double median;
+	double p10;                 /* final balance 10% of windows fall below */
+	double p90;
+} financial_backtest_summary_t;
+
+size_t financial_backtest_window_count( const financial_return_history_t* history, const financial_backtest_plan_t* plan );
+bool   financial_backtest_run         ( const financial_return_history_t* history, const financial_backtest_plan_t* plan,
+                                        financial_backtest_window_t* windows, financial_backtest_summary_t* summary );
+
+/*
+ * Backtests a profile's current allocation: its assets by class (in the
+ * profile's currency) set the weights and the initial balance, its
+ * disposable income as of the last refresh is the monthly contribution,
+ * and its goal is the goal. Fails if the profile has no assets.
+ */
+bool   financial_profile_backtest     ( const financial_profile_t* profile, const financial_return_history_t* history, size_t months, uint32_t rebalance_months,
+                                        financial_backtest_window_t* windows, financial_backtest_summary_t* summary );
+
+#ifdef __cplusplus
+} /* extern C Linkage */
+#endif
+#endif /* _WEALTH_BACKTEST_H_ */
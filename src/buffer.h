@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _FINANCIAL_BUFFER_H_
+#define _FINANCIAL_BUFFER_H_
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Growable output buffer and bounds-checked reader shared by the patch and
+ * compressed encodings. Failures are sticky: once ok is false further puts
+ * and gets do nothing, so callers check once at the end.
+ */
+typedef struct financial_buffer {
+	uint8_t* data;
+	size_t   size;
+	size_t   capacity;
+	bool     ok;
+} financial_buffer_t;
+
+typedef struct financial_reader {
+	const uint8_t* p;
+	const uint8_t* end;
+	bool           ok;
+} financial_reader_t;
+
+static inline bool buffer_reserve( financial_buffer_t* buffer, size_t bytes )
+{
+	if( buffer->ok && buffer->size + bytes > buffer->capacity )
+	{
+		size_t capacity = buffer->capacity ? buffer->capacity : 256;
+		while( capacity < buffer->size + bytes )
+		{
+			capacity *= 2;
+		}
+
+		uint8_t* data = realloc( buffer->data, capacity );
+		if( data )
+		{
+			buffer->data     = data;
+			buffer->capacity = capacity;
+		}
+		else
+		{
+			buffer->ok = false;
+		}
+	}
+
+	return buffer->ok;
+}
+
+static inline void buffer_put_bytes( financial_buffer_t* buffer, const void* bytes, size_t size )
+{
+	if( buffer_reserve( buffer, size ) )
+	{
+		memcpy( buffer->data + buffer->size, bytes, size );
+		buffer->size += size;
+	}
+}
+
+static inline void buffer_put_byte( financial_buffer_t* buffer, uint8_t byte )
+{
+	if( buffer_reserve( buffer, 1 ) )
+	{
+		buffer->data[ buffer->size++ ] = byte;
+	}
+}
+
+static inline void buffer_put_varint( financial_buffer_t* buffer, uint64_t value )
+{
+	if( buffer_reserve( buffer, 10 ) )
+	{
+		uint8_t* p = buffer->data + buffer->size;
+		while( value >= 0x80 )
+		{
+			*p++ = (uint8_t) (value | 0x80);
+			value >>= 7;
+		}
+		*p++ = (uint8_t) value;
+		buffer->size = p - buffer->data;
+	}
+}
+
+static inline void buffer_put_raw64( financial_buffer_t* buffer, uint64_t value )
+{
+	if( buffer_reserve( buffer, 8 ) )
+	{
+		for( size_t i = 0; i < 8; i++ )
+		{
+			buffer->data[ buffer->size++ ] = (uint8_t) (value >> (8 * i));
+		}
+	}
+}
+
+static inline uint8_t reader_get_byte( financial_reader_t* reader )
+{
+	if( reader->ok && reader->p < reader->end )
+	{
+		return *reader->p++;
+	}
+
+	reader->ok = false;
+	return 0;
+}
+
+static inline uint64_t reader_get_varint( financial_reader_t* reader )
+{
+	const uint8_t* p = reader->p;
+	uint64_t value = 0;
+
+	for( unsigned shift = 0; shift < 64 && p < reader->end; shift += 7 )
+	{
+		uint8_t byte = *p++;
+		value |= (uint64_t) (byte & 0x7f) << shift;
+		if( !(byte & 0x80) )
+		{
+			reader->p = p;
+			return value;
+		}
+	}
+
+	reader->ok = false;
+	return 0;
+}
+
+static inline uint64_t reader_get_raw64( financial_reader_t* reader )
+{
+	uint64_t value = 0;
+
+	if( reader->ok && reader->end - reader->p >= 8 )
+	{
+		for( size_t i = 0; i < 8; i++ )
+		{
+			value |= (uint64_t) reader->p[ i ] << (8 * i);
+		}
+		reader->p += 8;
+	}
+	else
+	{
+		reader->ok = false;
+	}
+
+	return value;
+}
+
+static inline const uint8_t* reader_get_bytes( financial_reader_t* reader, size_t size )
+{
+	const uint8_t* result = NULL;
+
+	if( reader->ok && (size_t) (reader->end - reader->p) >= size )
+	{
+		result = reader->p;
+		reader->p += size;
+	}
+	else
+	{
+		reader->ok = false;
+	}
+
+	return result;
+}
+
+static inline uint64_t zigzag_encode( int64_t value )
+{
+	return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+}
+
+static inline int64_t zigzag_decode( uint64_t value )
+{
+	return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+#endif /* _FINANCIAL_BUFFER_H_ */
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <assert.h>
+#include "wealth.h"
+#include "calendar.h"
+
+static const uint8_t DAYS_IN_MONTH[ 2 ][ 12 ] = {
+	{ 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 },
+	{ 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 }
+};
+
+int financial_date_days_in_month( int32_t year, int month )
+{
+	return month >= 1 && month <= 12 ? DAYS_IN_MONTH[ financial_date_is_leap_year( year ) ][ month - 1 ] : 0;
+}
+
+bool financial_date_valid( financial_date_t date )
+{
+	return date.day >= 1 && date.day <= financial_date_days_in_month( date.year, date.month );
+}
+
+/*
+ * Days from civil and back, after Howard Hinnant's algorithms. Years are
+ * shifted to start in March so the leap day falls at the end, which turns
+ * the month lengths into the linear (153 * m + 2) / 5.
+ */
+int32_t financial_date_to_days( financial_date_t date )
+{
+	int32_t  y   = date.year - (date.month <= 2);
+	int32_t  era = (y >= 0 ? y : y - 399) / 400;
+	uint32_t yoe = (uint32_t) (y - era * 400);                                      /* [0, 399] */
+	uint32_t mp  = (date.month + 9) % 12;                                           /* March is 0 */
+	uint32_t doy = (153 * mp + 2) / 5 + date.day - 1;                              /* [0, 365] */
+	uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;                          /* [0, 146096] */
+	return era * 146097 + (int32_t) doe - 719468;
+}
+
+financial_date_t financial_date_from_days( int32_t days )
+{
+	days += 719468;
+	int32_t  era = (days >= 0 ? days : days - 146096) / 146097;
+	uint32_t doe = (uint32_t) (days - era * 146097);
+	uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	uint32_t mp  = (5 * doy + 2) / 153;
+	uint32_t m   = mp < 10 ? mp + 3 : mp - 9;
+
+	financial_date_t date = {
+		.year  = (int32_t) yoe + era * 400 + (m <= 2),
+		.month = (uint8_t) m,
+		.day   = (uint8_t) (doy - (153 * mp + 2) / 5 + 1)
+	};
+	return date;
+}
+
+financial_date_t financial_date_add_months( financial_date_t date, int32_t months )
+{
+	int32_t index = date.year * 12 + (date.month - 1) + months;
+	int32_t year  = index >= 0 ? index / 12 : (index - 11) / 12;
+	int     month = index - year * 12 + 1;
+	int     last  = financial_date_days_in_month( year, month );
+
+	return financial_date_make( year, month, date.day < last ? date.day : last );
+}
+
+static int32_t day_count_30_360( financial_date_t start, financial_date_t end, bool european )
+{
+	int d1 = start.day;
+	int d2 = end.day;
+
+	d1 = d1 == 31 ? 30 : d1;
+	if( european || d1 == 30 )
+	{
+		d2 = d2 == 31 ? 30 : d2;
+	}
+
+	return 360 * (end.year - start.year) + 30 * (end.month - start.month) + (d2 - d1);
+}
+
+int32_t financial_day_count( financial_date_t start, financial_date_t end, financial_day_count_t convention )
+{
+	switch( convention )
+	{
+		case FDC_30_360:
+			return day_count_30_360( start, end, false );
+		case FDC_30E_360:
+			return day_count_30_360( start, end, true );
+		default:
+			return financial_date_to_days( end ) - financial_date_to_days( start );
+	}
+}
+
+static double year_fraction_act_act( financial_date_t start, financial_date_t end )
+{
+	int32_t from = financial_date_to_days( start );
+	int32_t to   = financial_date_to_days( end );
+
+	if( from > to )
+	{
+		return -year_fraction_act_act( end, start );
+	}
+	if( start.year == end.year )
+	{
+		return (to - from) / (financial_date_is_leap_year( start.year ) ? 366.0 : 365.0);
+	}
+
+	int32_t first_end  = financial_date_to_days( financial_date_make( start.year + 1, 1, 1 ) );
+	int32_t last_start = financial_date_to_days( financial_date_make( end.year, 1, 1 ) );
+
+	return (first_end - from) / (financial_date_is_leap_year( start.year ) ? 366.0 : 365.0) +
+	       (end.year - start.year - 1) +
+	       (to - last_start) / (financial_date_is_leap_year( end.year ) ? 366.0 : 365.0);
+}
+
+double financial_year_fraction( financial_date_t start, financial_date_t end, financial_day_count_t convention )
+{
+	switch( convention )
+	{
+		case FDC_30_360:
+		case FDC_30E_360:
+		case FDC_ACT_360:
+			return financial_day_count( start, end, convention ) / 360.0;
+		case FDC_ACT_365:
+			return financial_day_count( start, end, convention ) / 365.0;
+		case FDC_ACT_ACT:
+			return year_fraction_act_act( start, end );
+		default:
+			return 0.0;
+	}
+}
+
+bool financial_date_schedule_batch( const financial_date_t* starts, size_t count, int32_t months, int32_t days, size_t periods,
+                                    financial_day_count_t convention, int32_t* boundaries, double* fractions )
+{
+	assert( starts || count == 0 );
+	assert( boundaries || count == 0 );
+
+	if( months == 0 && days == 0 )
+	{
+		return false;
+	}
+
+	for( size_t i = 0; i < count; i++ )
+	{
+		financial_date_t start    = starts[ i ];
+		financial_date_t previous = start;
+		int32_t* bounds = &boundaries[ i * (periods + 1) ];
+		double*  years  = fractions ? &fractions[ i * periods ] : NULL;
+		int32_t  first  = financial_date_to_days( start );
+
+		bounds[ 0 ] = first;
+
+		for( size_t k = 1; k <= periods; k++ )
+		{
+			financial_date_t date;
+
+			if( months != 0 )
+			{
+				date = financial_date_add_months( start, (int32_t) k * months );
+				bounds[ k ] = financial_date_to_days( date );
+			}
+			else
+			{
+				bounds[ k ] = first + (int32_t) k * days;
+				date = financial_date_from_days( bounds[ k ] );
+			}
+
+			if( years )
+			{
+				years[ k - 1 ] = financial_year_fraction( previous, date, convention );
+			}
+			previous = date;
+		}
+	}
+
+	return true;
+}
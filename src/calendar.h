@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _WEALTH_CALENDAR_H_
+#define _WEALTH_CALENDAR_H_
+#include "wealth.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Calendar
+ *
+ * Dates are proleptic Gregorian with months and days counting from one.
+ * A date converts to and from a day number (days since 1970-01-01) with
+ * plain integer arithmetic, so nothing here touches mktime() or the time
+ * zone, and day numbers subtract to give actual days.
+ */
+typedef struct financial_date {
+	int32_t year;
+	uint8_t month; /* 1 - 12 */
+	uint8_t day;   /* 1 - 31 */
+} financial_date_t;
+
+static inline financial_date_t financial_date_make( int32_t year, int month, int day )
+{
+	financial_date_t date = { year, (uint8_t) month, (uint8_t) day };
+	return date;
+}
+
+static inline bool financial_date_is_leap_year( int32_t year )
+{
+	return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+int              financial_date_days_in_month( int32_t year, int month );
+bool             financial_date_valid        ( financial_date_t date );
+int32_t          financial_date_to_days      ( financial_date_t date );
+financial_date_t financial_date_from_days    ( int32_t days );
+
+/*
+ * Moves a date by whole months. A day past the end of the target month
+ * becomes its last day, so Jan 31 plus one month is Feb 28 (or 29).
+ */
+financial_date_t financial_date_add_months   ( financial_date_t date, int32_t months );
+
+/*
+ * Day count conventions
+ *
+ *   FDC_30_360     30/360 bond basis: a 31st start is the 30th, and so is
+ *                  a 31st end when the start is the 30th or 31st.
+ *   FDC_30E_360    30E/360 (Eurobond): every 31st is the 30th.
+ *   FDC_ACT_360    actual days over 360.
+ *   FDC_ACT_365    actual days over 365 (fixed).
+ *   FDC_ACT_ACT    actual/actual ISDA: days in leap years over 366 plus
+ *                  days in other years over 365.
+ */
+typedef enum financial_day_count {
+	FDC_30_360 = 0,
+	FDC_30E_360,
+	FDC_ACT_360,
+	FDC_ACT_365,
+	FDC_ACT_ACT
+} financial_day_count_t;
+
+int32_t financial_day_count    ( financial_date_t start, financial_date_t end, financial_day_count_t convention );
+double  financial_year_fraction( financial_date_t start, financial_date_t end, financial_day_count_t convention );
+
+/*
+ * Schedule generation
+ *
+ * Builds count schedules at once. Schedule i starts at starts[ i ] and has
+ * periods periods, each months months long (measured from the start, so
+ * month ends do not drift) or, when months is zero, days days long.
+ * boundaries receives periods + 1 day numbers per schedule and fractions,
+ * if not NULL, the year fraction of each period under convention. Returns
+ * false without writing anything if both lengths are zero.
+ */
+bool financial_date_schedule_batch( const financial_date_t* starts, size_t count, int32_t months, int32_t days, size_t periods,
+                                    financial_day_count_t convention, int32_t* boundaries, double* fractions );
+
+#ifdef __cplusplus
+} /* extern C Linkage */
+#endif
+#endif /* _WEALTH_CALENDAR_H_ */
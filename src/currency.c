@@ -0,0 +1,397 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#ifdef __ANDROID__
+#include <vector.h>
+#else
+#include <libcollections/vector.h>
+#endif
+#include "wealth.h"
+#include "item.h"
+#include "profile.h"
+
+#define CURRENCY_NONE       ((size_t) -1)
+
+financial_currency_t financial_currency( const char* code )
+{
+	assert( code );
+	financial_currency_t currency = FC_NONE;
+
+	for( size_t i = 0; i < 3; i++ )
+	{
+		char c = code[ i ];
+
+		if( c >= 'a' && c <= 'z' )
+		{
+			c = (char) (c - 'a' + 'A');
+		}
+		if( c < 'A' || c > 'Z' )
+		{
+			return FC_NONE;
+		}
+
+		currency |= (financial_currency_t) (uint8_t) c << (8 * i);
+	}
+
+	return code[ 3 ] == '\0' ? currency : FC_NONE;
+}
+
+void financial_currency_code( financial_currency_t currency, char code[ 4 ] )
+{
+	assert( code );
+	for( size_t i = 0; i < 3; i++ )
+	{
+		code[ i ] = (char) ((currency >> (8 * i)) & 0xff);
+	}
+	code[ 3 ] = '\0';
+}
+
+financial_currency_t financial_item_currency( const financial_item_t* item )
+{
+	assert( item );
+	return item->currency;
+}
+
+
+static inline flags_t currency_flag( financial_item_type_t type )
+{
+	switch( type )
+	{
+		case FI_ASSET:     return FP_FLAG_ASSETS_DIRTY;
+		case FI_LIABILITY: return FP_FLAG_LIABILITIES_DIRTY;
+		default:           return FP_FLAG_MONTHLY_EXPENSES_DIRTY;
+	}
+}
+
+static inline value_t* currency_total( financial_profile_t* profile, financial_item_type_t type )
+{
+	switch( type )
+	{
+		case FI_ASSET:     return &profile->total_assets;
+		case FI_LIABILITY: return &profile->total_liabilities;
+		default:           return &profile->total_expenses;
+	}
+}
+
+/* The rate entry of a currency, or CURRENCY_NONE if it has none. */
+static size_t currency_find( const financial_profile_t* profile, financial_currency_t currency )
+{
+	if( profile->rates )
+	{
+		if( currency == FC_NONE || currency == profile->currency )
+		{
+			return 0;
+		}
+
+		for( size_t i = 1; i < vector_size( profile->rates ); i++ )
+		{
+			if( profile->rates[ i ].currency == currency )
+			{
+				return i;
+			}
+		}
+	}
+
+	return CURRENCY_NONE;
+}
+
+/* Items in a currency without a rate count as the profile's own. */
+static inline size_t currency_group( const financial_profile_t* profile, financial_currency_t currency )
+{
+	size_t index = currency_find( profile, currency );
+	return index == CURRENCY_NONE ? 0 : index;
+}
+
+/* Converts each subtotal once; the profile's own needs no conversion. */
+static value_t currency_convert( const financial_profile_t* profile, financial_item_type_t type )
+{
+	const financial_fx_rate_t* rates = profile->rates;
+	value_t total = rates[ 0 ].subtotals[ type ];
+
+	for( size_t i = 1; i < vector_size( rates ); i++ )
+	{
+		total += value_from_double( value_to_double( rates[ i ].subtotals[ type ] ) * rates[ i ].rate );
+	}
+
+	return total;
+}
+
+/* Re-prices the clean totals among types from their subtotals. */
+static void currency_reprice( financial_profile_t* profile, flags_t types )
+{
+	flags_t changed = 0;
+
+	for( financial_item_type_t type = FI_ASSET; type <= FI_MONTHLY_EXPENSE; type++ )
+	{
+		flags_t flag = currency_flag( type );
+
+		if( (types & flag) && !(profile->flags & flag) )
+		{
+			*currency_total( profile, type ) = currency_convert( profile, type );
+			changed |= flag;
+		}
+	}
+
+	if( !changed )
+	{
+		return;
+	}
+
+	if( !(profile->flags & (FP_FLAG_ASSETS_DIRTY | FP_FLAG_LIABILITIES_DIRTY)) )
+	{
+		profile->net_worth = profile->total_assets - profile->total_liabilities;
+	}
+
+	if( !(profile->flags & (FP_FLAG_INCOME_DIRTY | FP_FLAG_MONTHLY_EXPENSES_DIRTY)) )
+	{
+		profile->disposable_income = (profile->monthly_income > profile->total_expenses) ?
+		                             (profile->monthly_income - profile->total_expenses) : 0;
+	}
+
+	__financial_profile_updated( profile, changed );
+}
+
+value_t __financial_currency_sum( financial_profile_t* profile, financial_item_type_t type )
+{
+	const financial_collection_t* items = &profile->items[ type ];
+	financial_fx_rate_t* rates = profile->rates;
+	financial_currency_t currency = FC_NONE;
+	size_t group = 0;
+
+	for( size_t i = 0; i < vector_size( rates ); i++ )
+	{
+		rates[ i ].subtotals[ type ] = 0;
+	}
+
+	/* Items of one currency tend to sit together, so the lookup is rarely repeated. */
+	for( size_t i = 0; i < items->count; i++ )
+	{
+		const financial_item_t* item = __financial_collection_at( items, i );
+
+		if( item->currency != currency )
+		{
+			currency = item->currency;
+			group    = currency_group( profile, currency );
+		}
+
+		rates[ group ].subtotals[ type ] += item->amount;
+	}
+
+	return currency_convert( profile, type );
+}
+
+void __financial_currency_copy( financial_profile_t* profile, const financial_fx_rate_t* rates )
+{
+	financial_fx_rate_t* copy = NULL;
+
+	if( rates )
+	{
+		vector_create( copy, vector_size( rates ) );
+		for( size_t i = 0; i < vector_size( rates ); i++ )
+		{
+			vector_push( copy, rates[ i ] );
+		}
+	}
+
+	if( profile->rates )
+	{
+		vector_destroy( profile->rates );
+	}
+
+	profile->rates = copy;
+}
+
+
+financial_currency_t financial_profile_currency( const financial_profile_t* profile )
+{
+	assert( profile );
+	return profile->currency;
+}
+
+bool financial_profile_set_currency( financial_profile_t* profile, financial_currency_t currency )
+{
+	assert( profile );
+
+	/* Changing the currency only relabels the amounts, which would leave
+	 * every rate priced in the old one. */
+	if( currency != profile->currency && profile->rates && vector_size( profile->rates ) > 1 )
+	{
+		return false;
+	}
+
+	profile->currency = currency;
+	if( profile->rates )
+	{
+		profile->rates[ 0 ].currency = currency;
+	}
+
+	return true;
+}
+
+bool financial_profile_fx_rate( const financial_profile_t* profile, financial_currency_t currency, double* rate )
+{
+	assert( profile );
+	assert( rate );
+
+	if( currency == FC_NONE || currency == profile->currency )
+	{
+		*rate = 1.0;
+		return true;
+	}
+
+	size_t index = currency_find( profile, currency );
+
+	if( index == CURRENCY_NONE )
+	{
+		return false;
+	}
+
+	*rate = profile->rates[ index ].rate;
+	return true;
+}
+
+bool financial_profile_set_fx_rate( financial_profile_t* profile, financial_currency_t currency, double rate )
+{
+	assert( profile );
+
+	if( currency == FC_NONE || currency == profile->currency || !(rate > 0) || !isfinite( rate ) )
+	{
+		return false;
+	}
+
+	if( !profile->rates )
+	{
+		financial_fx_rate_t own = { .currency = profile->currency, .rate = 1.0, .subtotals = { 0, 0, 0 } };
+		vector_create( profile->rates, 4 );
+		vector_push( profile->rates, own );
+	}
+
+	size_t index = currency_find( profile, currency );
+
+	if( index == CURRENCY_NONE )
+	{
+		financial_fx_rate_t entry = { .currency = currency, .rate = rate, .subtotals = { 0, 0, 0 } };
+		vector_push( profile->rates, entry );
+
+		/* Items may already be in this currency, so subtotals start at the next refresh. */
+		profile->flags |= FP_FLAG_ASSETS_DIRTY | FP_FLAG_LIABILITIES_DIRTY | FP_FLAG_MONTHLY_EXPENSES_DIRTY;
+	}
+	else if( profile->rates[ index ].rate != rate )
+	{
+		flags_t types = 0;
+
+		profile->rates[ index ].rate = rate;
+
+		for( financial_item_type_t type = FI_ASSET; type <= FI_MONTHLY_EXPENSE; type++ )
+		{
+			if( profile->rates[ index ].subtotals[ type ] != 0 )
+			{
+				types |= currency_flag( type );
+			}
+		}
+
+		currency_reprice( profile, types );
+	}
+
+	return true;
+}
+
+bool financial_profile_item_set_currency( financial_profile_t* profile, financial_item_type_t type, size_t index, financial_currency_t currency )
+{
+	assert( profile );
+
+	if( type > FI_MONTHLY_EXPENSE || index >= financial_profile_item_count( profile, type ) )
+	{
+		return false;
+	}
+
+	/* Items in the profile's own currency are stored without a code, so they follow it. */
+	if( currency == profile->currency )
+	{
+		currency = FC_NONE;
+	}
+
+	if( currency != FC_NONE && currency_find( profile, currency ) == CURRENCY_NONE )
+	{
+		return false;
+	}
+
+	financial_item_t* item = __financial_collection_at( &profile->items[ type ], index );
+
+	if( item->currency != currency )
+	{
+		size_t from = currency_group( profile, item->currency );
+		size_t to   = currency_group( profile, currency );
+
+		/* Only a real change copies a chunk shared with a fork. */
+		item = __financial_collection_write( &profile->items[ type ], index );
+		if( !item )
+		{
+			return false;
+		}
+
+		item->currency = currency;
+
+		if( profile->rates && from != to && !(profile->flags & currency_flag( type )) )
+		{
+			profile->rates[ from ].subtotals[ type ] -= item->amount;
+			profile->rates[ to ].subtotals[ type ]   += item->amount;
+			currency_reprice( profile, currency_flag( type ) );
+		}
+	}
+
+	return true;
+}
+
+bool financial_profile_currency_subtotal( const financial_profile_t* profile, financial_item_type_t type, financial_currency_t currency, value_t* subtotal )
+{
+	assert( profile );
+	assert( subtotal );
+
+	if( type > FI_MONTHLY_EXPENSE || (profile->flags & currency_flag( type )) )
+	{
+		return false;
+	}
+
+	if( !profile->rates )
+	{
+		if( currency != FC_NONE && currency != profile->currency )
+		{
+			return false;
+		}
+		*subtotal = *currency_total( (financial_profile_t*) profile, type );
+		return true;
+	}
+
+	size_t index = currency_find( profile, currency );
+
+	if( index == CURRENCY_NONE )
+	{
+		return false;
+	}
+
+	*subtotal = profile->rates[ index ].subtotals[ type ];
+	return true;
+}
@@ -0,0 +1,858 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#ifdef __ANDROID__
+#include <vector.h>
+#else
+#include <libcollections/vector.h>
+#endif
+#include "wealth.h"
+#include "item.h"
+#include "handle.h"
+#include "profile.h"
+#include "buffer.h"
+
+/*
+ * Patch layout
+ *
+ *   'F' 'D' version encoding varint(scale)
+ *   scalar mask, then each changed scalar
+ *   for assets, liabilities and expenses:
+ *     varint(changes)  { varint(index gap) field-mask fields... }
+ *     varint(removes)  { varint(index gap) }
+ *     varint(inserts)  { description amount [class] varint(currency) }
+ *     varint(ordered)  { varint(index) }
+ *
+ * The currency scalar carries the profile's currency, varint(rate count)
+ * and each rate as varint(code) raw64. Version 1 patches, written before
+ * currencies, have no currency on inserts, and patches before version 3
+ * have no order; both are still applied.
+ *
+ * Kept items stay in a's order and inserts are appended. When that is not
+ * b's order, ordered is the collection's final count and each index names
+ * the item, counted in that order, that belongs at the next position.
+ * Otherwise ordered is zero.
+ *
+ * Indices refer to the profile the patch was made against and ascend, so
+ * they are stored as gaps. Amounts are stored as a zigzag varint of the
+ * change in minor units (shifted left one bit), or as a 1 followed by the
+ * raw eight bytes when an amount is not a whole number of minor units.
+ */
+#define PATCH_VERSION             (3)
+
+#define PATCH_SCALAR_GOAL         (1 << 0)
+#define PATCH_SCALAR_INCOME       (1 << 1)
+#define PATCH_SCALAR_CREDIT_SCORE (1 << 2)
+#define PATCH_SCALAR_CREDIT_DATE  (1 << 3)
+#define PATCH_SCALAR_CURRENCY     (1 << 4)
+
+#define PATCH_FIELD_AMOUNT        (1 << 0)
+#define PATCH_FIELD_DESCRIPTION   (1 << 1)
+#define PATCH_FIELD_CLASS         (1 << 2)
+#define PATCH_FIELD_CURRENCY      (1 << 3)
+
+#define PATCH_NONE                ((size_t) -1)
+
+typedef struct financial_patch_entry {
+	uint64_t hash;
+	size_t   head;
+	size_t   tail;
+} financial_patch_entry_t;
+
+
+static void patch_put_amount( financial_buffer_t* buffer, value_t from, value_t to )
+{
+	int64_t a, b;
+
+	if( __financial_amount_to_minor( from, &a ) && __financial_amount_to_minor( to, &b ) )
+	{
+		int64_t delta = (int64_t) ((uint64_t) b - (uint64_t) a);
+		uint64_t zz = zigzag_encode( delta );
+
+		/* A wrapped difference is sent raw rather than trusted. */
+		if( (delta >= 0) == (b >= a) && (zz >> 63) == 0 )
+		{
+			buffer_put_varint( buffer, zz << 1 );
+			return;
+		}
+	}
+
+	uint64_t bits;
+	memcpy( &bits, &to, sizeof(bits) );
+	buffer_put_varint( buffer, 1 );
+	buffer_put_raw64( buffer, bits );
+}
+
+static value_t patch_get_amount( financial_reader_t* reader, value_t from )
+{
+	uint64_t tag = reader_get_varint( reader );
+	value_t result;
+
+	if( tag & 1 )
+	{
+		uint64_t bits = reader_get_raw64( reader );
+		memcpy( &result, &bits, sizeof(result) );
+	}
+	else
+	{
+		int64_t minor = 0;
+		__financial_amount_to_minor( from, &minor );
+		minor = (int64_t) ((uint64_t) minor + (uint64_t) zigzag_decode( tag >> 1 ));
+#ifdef WEALTH_FIXED_POINT
+		result = minor;
+#else
+		result = (double) minor / FP_MINOR_SCALE;
+#endif
+	}
+
+	return result;
+}
+
+static void patch_put_description( financial_buffer_t* buffer, const char* description )
+{
+	size_t length = strnlen( description, sizeof(desc_short_t) - 1 );
+	buffer_put_varint( buffer, length );
+	buffer_put_bytes( buffer, description, length );
+}
+
+static bool patch_get_description( financial_reader_t* reader, char* description )
+{
+	uint64_t length = reader_get_varint( reader );
+
+	if( !reader->ok || length >= sizeof(desc_short_t) || length > (uint64_t) (reader->end - reader->p) )
+	{
+		reader->ok = false;
+		return false;
+	}
+
+	if( description )
+	{
+		memcpy( description, reader->p, length );
+		description[ length ] = '\0';
+	}
+	reader->p += length;
+	return true;
+}
+
+
+static uint64_t patch_item_class( financial_item_type_t type, const financial_item_t* item )
+{
+	switch( type )
+	{
+		case FI_ASSET:
+			return (uint64_t) ((const financial_asset_t*) item)->asset_class;
+		case FI_LIABILITY:
+			return (uint64_t) ((const financial_liability_t*) item)->liability_class;
+		default:
+			return 0;
+	}
+}
+
+static void patch_item_set_class( financial_item_type_t type, financial_item_t* item, uint64_t cls )
+{
+	switch( type )
+	{
+		case FI_ASSET:
+			((financial_asset_t*) item)->asset_class = (financial_asset_class_t) cls;
+			break;
+		case FI_LIABILITY:
+			((financial_liability_t*) item)->liability_class = (financial_liability_class_t) cls;
+			break;
+		default:
+			break;
+	}
+}
+
+static value_t* patch_total( financial_profile_t* profile, financial_item_type_t type, flags_t* flag )
+{
+	switch( type )
+	{
+		case FI_ASSET:
+			*flag = FP_FLAG_ASSETS_DIRTY;
+			return &profile->total_assets;
+		case FI_LIABILITY:
+			*flag = FP_FLAG_LIABILITIES_DIRTY;
+			return &profile->total_liabilities;
+		default:
+			*flag = FP_FLAG_MONTHLY_EXPENSES_DIRTY;
+			return &profile->total_expenses;
+	}
+}
+
+static uint64_t patch_hash( const char* description )
+{
+	uint64_t hash = 14695981039346656037ULL; /* FNV-1a */
+
+	for( size_t i = 0; i < sizeof(desc_short_t) && description[ i ]; i++ )
+	{
+		hash ^= (uint8_t) description[ i ];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+
+/*
+ * Items are matched by description. Each distinct description owns one
+ * table entry holding a queue of the indices in a that carry it, linked
+ * through next[] in order of appearance, so duplicates pair up in order
+ * and every match is a single dequeue.
+ */
+static bool patch_diff_collection( financial_buffer_t* buffer, const financial_profile_t* a, const financial_profile_t* b, financial_item_type_t type )
+{
+	const financial_collection_t* a_items = &a->items[ type ];
+	const financial_collection_t* b_items = &b->items[ type ];
+	size_t a_count = a_items->count;
+	size_t b_count = b_items->count;
+
+	size_t slots = 16;
+	while( slots < 2 * a_count )
+	{
+		slots <<= 1;
+	}
+
+	financial_patch_entry_t* table = malloc( slots * sizeof(financial_patch_entry_t) );
+	size_t* a_match = malloc( (a_count ? a_count : 1) * sizeof(size_t) );
+	size_t* next = malloc( (a_count ? a_count : 1) * sizeof(size_t) );
+	uint8_t* b_matched = calloc( b_count ? b_count : 1, 1 );
+	size_t* position = malloc( (b_count ? b_count : 1) * sizeof(size_t) );
+	bool result = false;
+
+	if( !table || !a_match || !next || !b_matched || !position )
+	{
+		goto done;
+	}
+
+	for( size_t s = 0; s < slots; s++ )
+	{
+		table[ s ].head = PATCH_NONE;
+	}
+
+	for( size_t i = 0; i < a_count; i++ )
+	{
+		const financial_item_t* item = __financial_collection_at( a_items, i );
+		uint64_t hash = patch_hash( item->description );
+		size_t s = (size_t) hash & (slots - 1);
+
+		while( table[ s ].head != PATCH_NONE )
+		{
+			const financial_item_t* first = __financial_collection_at( a_items, table[ s ].head );
+
+			if( table[ s ].hash == hash && strncmp( first->description, item->description, sizeof(desc_short_t) ) == 0 )
+			{
+				break;
+			}
+			s = (s + 1) & (slots - 1);
+		}
+
+		if( table[ s ].head == PATCH_NONE )
+		{
+			table[ s ].hash = hash;
+			table[ s ].head = i;
+		}
+		else
+		{
+			next[ table[ s ].tail ] = i;
+		}
+
+		table[ s ].tail = i;
+		next[ i ]       = PATCH_NONE;
+		a_match[ i ]    = PATCH_NONE;
+	}
+
+	/*
+	 * An entry whose queue has run dry keeps its hash and sets head to
+	 * PATCH_NONE - 1, so it still occupies its slot in the probe sequence.
+	 */
+	for( size_t j = 0; j < b_count; j++ )
+	{
+		const financial_item_t* item = __financial_collection_at( b_items, j );
+		uint64_t hash = patch_hash( item->description );
+		size_t s = (size_t) hash & (slots - 1);
+
+		for( ; table[ s ].head != PATCH_NONE; s = (s + 1) & (slots - 1) )
+		{
+			const financial_item_t* last = __financial_collection_at( a_items, table[ s ].tail );
+
+			if( table[ s ].hash == hash && strncmp( last->description, item->description, sizeof(desc_short_t) ) == 0 )
+			{
+				size_t i = table[ s ].head;
+
+				if( i != PATCH_NONE - 1 )
+				{
+					table[ s ].head = next[ i ] != PATCH_NONE ? next[ i ] : PATCH_NONE - 1;
+					a_match[ i ]    = j;
+					b_matched[ j ] = 1;
+				}
+				break;
+			}
+		}
+	}
+
+	/* Where each item of b lands once the patch is applied. */
+	size_t placed = 0;
+	for( size_t i = 0; i < a_count; i++ )
+	{
+		if( a_match[ i ] != PATCH_NONE )
+		{
+			position[ a_match[ i ] ] = placed++;
+		}
+	}
+	for( size_t j = 0; j < b_count; j++ )
+	{
+		if( !b_matched[ j ] )
+		{
+			position[ j ] = placed++;
+		}
+	}
+
+	/* Changes */
+	size_t changes = 0;
+	for( size_t i = 0; i < a_count; i++ )
+	{
+		if( a_match[ i ] != PATCH_NONE )
+		{
+			const financial_item_t* from = __financial_collection_at( a_items, i );
+			const financial_item_t* to   = __financial_collection_at( b_items, a_match[ i ] );
+
+			if( memcmp( &from->amount, &to->amount, sizeof(value_t) ) != 0 || patch_item_class( type, from ) != patch_item_class( type, to ) ||
+			    from->currency != to->currency )
+			{
+				changes += 1;
+			}
+			else
+			{
+				a_match[ i ] = PATCH_NONE - 1; /* matched, unchanged */
+			}
+		}
+	}
+
+	buffer_put_varint( buffer, changes );
+	for( size_t i = 0, last = 0; i < a_count; i++ )
+	{
+		if( a_match[ i ] < PATCH_NONE - 1 )
+		{
+			const financial_item_t* from = __financial_collection_at( a_items, i );
+			const financial_item_t* to   = __financial_collection_at( b_items, a_match[ i ] );
+			uint8_t fields = 0;
+
+			if( memcmp( &from->amount, &to->amount, sizeof(value_t) ) != 0 )      fields |= PATCH_FIELD_AMOUNT;
+			if( patch_item_class( type, from ) != patch_item_class( type, to ) ) fields |= PATCH_FIELD_CLASS;
+			if( from->currency != to->currency )                                 fields |= PATCH_FIELD_CURRENCY;
+
+			buffer_put_varint( buffer, i - last );
+			buffer_put_byte( buffer, fields );
+			if( fields & PATCH_FIELD_AMOUNT ) patch_put_amount( buffer, from->amount, to->amount );
+			if( fields & PATCH_FIELD_CLASS )  buffer_put_varint( buffer, patch_item_class( type, to ) );
+			if( fields & PATCH_FIELD_CURRENCY ) buffer_put_varint( buffer, to->currency );
+			last = i;
+		}
+	}
+
+	/* Removes */
+	size_t removes = 0;
+	for( size_t i = 0; i < a_count; i++ )
+	{
+		removes += a_match[ i ] == PATCH_NONE;
+	}
+
+	buffer_put_varint( buffer, removes );
+	for( size_t i = 0, last = 0; i < a_count; i++ )
+	{
+		if( a_match[ i ] == PATCH_NONE )
+		{
+			buffer_put_varint( buffer, i - last );
+			last = i;
+		}
+	}
+
+	/* Inserts */
+	size_t inserts = 0;
+	for( size_t j = 0; j < b_count; j++ )
+	{
+		inserts += !b_matched[ j ];
+	}
+
+	buffer_put_varint( buffer, inserts );
+	for( size_t j = 0; j < b_count; j++ )
+	{
+		if( !b_matched[ j ] )
+		{
+			const financial_item_t* item = __financial_collection_at( b_items, j );
+			patch_put_description( buffer, item->description );
+			patch_put_amount( buffer, 0, item->amount );
+			if( type != FI_MONTHLY_EXPENSE ) buffer_put_varint( buffer, patch_item_class( type, item ) );
+			buffer_put_varint( buffer, item->currency );
+		}
+	}
+
+	/* Order */
+	bool ordered = true;
+	for( size_t j = 0; j < b_count && ordered; j++ )
+	{
+		ordered = position[ j ] == j;
+	}
+
+	buffer_put_varint( buffer, ordered ? 0 : b_count );
+	for( size_t j = 0; j < b_count && !ordered; j++ )
+	{
+		buffer_put_varint( buffer, position[ j ] );
+	}
+
+	result = buffer->ok;
+
+done:
+	free( table );
+	free( a_match );
+	free( next );
+	free( b_matched );
+	free( position );
+	return result;
+}
+
+static bool patch_same_rates( const financial_profile_t* a, const financial_profile_t* b )
+{
+	size_t a_count = a->rates ? vector_size( a->rates ) : 0;
+	size_t b_count = b->rates ? vector_size( b->rates ) : 0;
+
+	if( a->currency != b->currency || a_count != b_count )
+	{
+		return false;
+	}
+
+	for( size_t i = 1; i < a_count; i++ )
+	{
+		if( a->rates[ i ].currency != b->rates[ i ].currency || a->rates[ i ].rate != b->rates[ i ].rate )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool financial_profile_diff( const financial_profile_t* a, const financial_profile_t* b, uint8_t** patch, size_t* size )
+{
+	assert( a );
+	assert( b );
+	assert( patch );
+	assert( size );
+	financial_buffer_t buffer = { .data = NULL, .size = 0, .capacity = 0, .ok = true };
+
+	buffer_put_byte( &buffer, 'F' );
+	buffer_put_byte( &buffer, 'D' );
+	buffer_put_byte( &buffer, PATCH_VERSION );
+	buffer_put_byte( &buffer, FP_ENCODING_NATIVE );
+	buffer_put_varint( &buffer, FP_MINOR_SCALE );
+
+	uint8_t scalars = 0;
+	if( memcmp( &a->goal, &b->goal, sizeof(value_t) ) != 0 )                     scalars |= PATCH_SCALAR_GOAL;
+	if( memcmp( &a->monthly_income, &b->monthly_income, sizeof(value_t) ) != 0 ) scalars |= PATCH_SCALAR_INCOME;
+	if( a->credit_score != b->credit_score )                                     scalars |= PATCH_SCALAR_CREDIT_SCORE;
+	if( a->credit_score_updated != b->credit_score_updated )                     scalars |= PATCH_SCALAR_CREDIT_DATE;
+	if( !patch_same_rates( a, b ) )                                              scalars |= PATCH_SCALAR_CURRENCY;
+
+	buffer_put_byte( &buffer, scalars );
+	if( scalars & PATCH_SCALAR_GOAL )         patch_put_amount( &buffer, a->goal, b->goal );
+	if( scalars & PATCH_SCALAR_INCOME )       patch_put_amount( &buffer, a->monthly_income, b->monthly_income );
+	if( scalars & PATCH_SCALAR_CREDIT_SCORE ) buffer_put_varint( &buffer, b->credit_score );
+	if( scalars & PATCH_SCALAR_CREDIT_DATE )  buffer_put_varint( &buffer, b->credit_score_updated );
+	if( scalars & PATCH_SCALAR_CURRENCY )
+	{
+		size_t rate_count = b->rates ? vector_size( b->rates ) - 1 : 0;
+
+		buffer_put_varint( &buffer, b->currency );
+		buffer_put_varint( &buffer, rate_count );
+		for( size_t i = 1; i <= rate_count; i++ )
+		{
+			uint64_t bits;
+			memcpy( &bits, &b->rates[ i ].rate, sizeof(bits) );
+			buffer_put_varint( &buffer, b->rates[ i ].currency );
+			buffer_put_raw64( &buffer, bits );
+		}
+	}
+
+	bool result = patch_diff_collection( &buffer, a, b, FI_ASSET ) &&
+	              patch_diff_collection( &buffer, a, b, FI_LIABILITY ) &&
+	              patch_diff_collection( &buffer, a, b, FI_MONTHLY_EXPENSE );
+
+	if( result )
+	{
+		*patch = buffer.data;
+		*size  = buffer.size;
+	}
+	else
+	{
+		free( buffer.data );
+	}
+
+	return result;
+}
+
+
+/*
+ * Patches are read twice: once to check every index and length against the
+ * profile, then again to apply, so a bad patch leaves the profile alone.
+ */
+static void patch_apply_collection( financial_reader_t* reader, financial_profile_t* profile, financial_item_type_t type, uint8_t version, bool apply, flags_t* changed )
+{
+	financial_collection_t* items = &profile->items[ type ];
+	size_t count  = items->count;
+	size_t stride = items->stride;
+	flags_t flag;
+	value_t* total = patch_total( profile, type, &flag );
+	value_t delta = 0;
+	bool touched = false;
+
+	/* Changes */
+	uint64_t changes = reader_get_varint( reader );
+	for( uint64_t k = 0, index = 0; reader->ok && k < changes; k++ )
+	{
+		uint64_t gap = reader_get_varint( reader );
+		uint8_t fields = reader_get_byte( reader );
+		index += gap;
+
+		if( !reader->ok || index >= count || (k > 0 && gap == 0) )
+		{
+			reader->ok = false;
+			break;
+		}
+
+		financial_item_t* item = apply ? __financial_collection_write( items, index ) : NULL;
+
+		if( apply && !item )
+		{
+			reader->ok = false;
+			break;
+		}
+		touched = touched || apply;
+
+		if( fields & PATCH_FIELD_AMOUNT )
+		{
+			value_t amount = patch_get_amount( reader, apply ? item->amount : 0 );
+			if( apply )
+			{
+				delta += amount - item->amount;
+				item->amount = amount;
+			}
+		}
+		if( fields & PATCH_FIELD_DESCRIPTION )
+		{
+			patch_get_description( reader, apply ? item->description : NULL );
+		}
+		if( fields & PATCH_FIELD_CLASS )
+		{
+			uint64_t cls = reader_get_varint( reader );
+			if( apply ) patch_item_set_class( type, item, cls );
+		}
+		if( fields & PATCH_FIELD_CURRENCY )
+		{
+			uint64_t currency = reader_get_varint( reader );
+			if( currency > UINT32_MAX )
+			{
+				reader->ok = false;
+				break;
+			}
+			if( apply ) item->currency = (financial_currency_t) currency;
+		}
+	}
+
+	/* Removes, compacted in one pass so the remaining items keep their order. */
+	uint64_t removes = reader->ok ? reader_get_varint( reader ) : 0;
+	if( reader->ok && removes > count )
+	{
+		reader->ok = false;
+	}
+
+	size_t write = 0;
+	size_t read  = 0;
+	for( uint64_t k = 0, index = 0; reader->ok && k < removes; k++ )
+	{
+		uint64_t gap = reader_get_varint( reader );
+		index += gap;
+
+		if( !reader->ok || index >= count || (k > 0 && gap == 0) )
+		{
+			reader->ok = false;
+			break;
+		}
+
+		if( apply )
+		{
+			/* Everything from the first hole on moves, so it is made private at once. */
+			if( k == 0 && !__financial_collection_unshare( items, index, count - index ) )
+			{
+				reader->ok = false;
+				break;
+			}
+			touched = true;
+
+			delta -= __financial_collection_at( items, index )->amount;
+			if( profile->handles[ type ] )
+			{
+				__financial_handles_release( profile->handles[ type ], index );
+			}
+			for( ; read < index; read++, write++ )
+			{
+				if( write != read ) memcpy( __financial_collection_at( items, write ), __financial_collection_at( items, read ), stride );
+			}
+			read = index + 1;
+		}
+	}
+
+	if( apply && reader->ok && removes > 0 )
+	{
+		for( ; read < count; read++, write++ )
+		{
+			memcpy( __financial_collection_at( items, write ), __financial_collection_at( items, read ), stride );
+		}
+		__financial_collection_pop( items, removes );
+		if( profile->handles[ type ] )
+		{
+			__financial_handles_compact( profile->handles[ type ] );
+		}
+	}
+
+	/* Inserts */
+	uint64_t inserts = reader->ok ? reader_get_varint( reader ) : 0;
+	for( uint64_t k = 0; reader->ok && k < inserts; k++ )
+	{
+		desc_short_t description;
+		value_t amount;
+		uint64_t cls = 0;
+		uint64_t currency = FC_NONE;
+
+		patch_get_description( reader, description );
+		amount = patch_get_amount( reader, 0 );
+		if( type != FI_MONTHLY_EXPENSE ) cls = reader_get_varint( reader );
+		if( version > 1 ) currency = reader_get_varint( reader );
+
+		if( currency > UINT32_MAX )
+		{
+			reader->ok = false;
+			break;
+		}
+
+		if( apply && reader->ok )
+		{
+			financial_item_t* item = __financial_profile_item_add( profile, type );
+			if( !item )
+			{
+				reader->ok = false;
+				break;
+			}
+			financial_item_set_description( item, description );
+			item->amount = amount;
+			patch_item_set_class( type, item, cls );
+			item->currency = (financial_currency_t) currency;
+			delta += amount;
+			touched = true;
+		}
+	}
+
+	/* Order, checked to be a permutation of the patched collection. */
+	uint64_t ordered = reader->ok && version > 2 ? reader_get_varint( reader ) : 0;
+	if( reader->ok && ordered > 0 )
+	{
+		size_t final = count - (size_t) removes + (size_t) inserts;
+		size_t* order = NULL;
+		uint8_t* seen = NULL;
+
+		if( ordered != final || ordered > (uint64_t) (reader->end - reader->p) ||
+		    !(order = malloc( final * sizeof(size_t) )) || !(seen = calloc( final, 1 )) )
+		{
+			reader->ok = false;
+		}
+
+		for( size_t i = 0; reader->ok && i < final; i++ )
+		{
+			uint64_t index = reader_get_varint( reader );
+
+			if( !reader->ok || index >= final || seen[ index ] )
+			{
+				reader->ok = false;
+				break;
+			}
+
+			seen[ index ] = 1;
+			order[ i ]    = (size_t) index;
+		}
+
+		if( apply && reader->ok )
+		{
+			financial_handle_table_t* handles = profile->handles[ type ];
+
+			if( !__financial_collection_permute( items, order, handles ? handles->items : NULL ) )
+			{
+				reader->ok = false;
+			}
+			else if( handles )
+			{
+				__financial_handles_reindex( handles );
+			}
+		}
+
+		free( order );
+		free( seen );
+	}
+
+	if( apply && touched )
+	{
+		/*
+		 * item_add marks the collection dirty; a clean total is adjusted
+		 * instead, unless amounts are converted per currency and the
+		 * subtotals must be rebuilt.
+		 */
+		if( profile->rates )
+		{
+			profile->flags |= flag;
+		}
+		else if( !(*changed & flag) )
+		{
+			profile->flags &= ~flag;
+			*total += delta;
+		}
+		*changed |= flag;
+	}
+}
+
+static bool patch_apply( financial_reader_t* reader, financial_profile_t* profile, bool apply )
+{
+	flags_t dirty   = profile->flags & FP_FLAG_ALL;
+	flags_t changed = dirty; /* collections that must be rescanned anyway */
+	uint8_t version;
+
+	if( reader_get_byte( reader ) != 'F' || reader_get_byte( reader ) != 'D' ||
+	    (version = reader_get_byte( reader )) < 1 || version > PATCH_VERSION ||
+	    reader_get_byte( reader ) != FP_ENCODING_NATIVE ||
+	    reader_get_varint( reader ) != FP_MINOR_SCALE )
+	{
+		return false;
+	}
+
+	uint8_t scalars = reader_get_byte( reader );
+	if( scalars & PATCH_SCALAR_GOAL )
+	{
+		value_t goal = patch_get_amount( reader, profile->goal );
+		if( apply ) profile->goal = goal;
+	}
+	if( scalars & PATCH_SCALAR_INCOME )
+	{
+		value_t income = patch_get_amount( reader, profile->monthly_income );
+		if( apply ) profile->monthly_income = income;
+	}
+	if( scalars & PATCH_SCALAR_CREDIT_SCORE )
+	{
+		uint64_t score = reader_get_varint( reader );
+		if( apply ) profile->credit_score = (uint16_t) score;
+	}
+	if( scalars & PATCH_SCALAR_CREDIT_DATE )
+	{
+		uint64_t date = reader_get_varint( reader );
+		if( apply ) profile->credit_score_updated = (uint32_t) date;
+	}
+	if( scalars & PATCH_SCALAR_CURRENCY )
+	{
+		uint64_t currency   = reader_get_varint( reader );
+		uint64_t rate_count = reader_get_varint( reader );
+
+		if( !reader->ok || currency > UINT32_MAX || rate_count > (uint64_t) (reader->end - reader->p) / 9 )
+		{
+			return false;
+		}
+
+		/* The table is replaced whole, and subtotals are rebuilt by the next refresh. */
+		if( apply )
+		{
+			__financial_currency_copy( profile, NULL );
+			profile->currency = (financial_currency_t) currency;
+			profile->flags   |= FP_FLAG_ASSETS_DIRTY | FP_FLAG_LIABILITIES_DIRTY | FP_FLAG_MONTHLY_EXPENSES_DIRTY;
+			changed          |= FP_FLAG_ASSETS_DIRTY | FP_FLAG_LIABILITIES_DIRTY | FP_FLAG_MONTHLY_EXPENSES_DIRTY;
+		}
+
+		for( uint64_t k = 0; k < rate_count; k++ )
+		{
+			uint64_t code = reader_get_varint( reader );
+			uint64_t bits = reader_get_raw64( reader );
+			double rate;
+			memcpy( &rate, &bits, sizeof(rate) );
+
+			if( !reader->ok || code == FC_NONE || code > UINT32_MAX || code == currency || !(rate > 0) || !isfinite( rate ) )
+			{
+				return false;
+			}
+
+			if( apply )
+			{
+				financial_profile_set_fx_rate( profile, (financial_currency_t) code, rate );
+			}
+		}
+	}
+
+	patch_apply_collection( reader, profile, FI_ASSET, version, apply, &changed );
+	patch_apply_collection( reader, profile, FI_LIABILITY, version, apply, &changed );
+	patch_apply_collection( reader, profile, FI_MONTHLY_EXPENSE, version, apply, &changed );
+
+	if( !reader->ok || reader->p != reader->end )
+	{
+		return false;
+	}
+
+	if( apply )
+	{
+		if( scalars & PATCH_SCALAR_INCOME )
+		{
+			changed |= FP_FLAG_INCOME_DIRTY;
+		}
+
+		if( !(profile->flags & (FP_FLAG_ASSETS_DIRTY | FP_FLAG_LIABILITIES_DIRTY)) )
+		{
+			profile->net_worth = profile->total_assets - profile->total_liabilities;
+		}
+
+		if( !(profile->flags & (FP_FLAG_INCOME_DIRTY | FP_FLAG_MONTHLY_EXPENSES_DIRTY)) )
+		{
+			profile->disposable_income = (profile->monthly_income > profile->total_expenses) ?
+			                             (profile->monthly_income - profile->total_expenses) : 0;
+		}
+
+		/* Collections that were already dirty are reported by the next refresh. */
+		__financial_profile_updated( profile, changed & ~dirty );
+	}
+
+	return true;
+}
+
+bool financial_profile_patch( financial_profile_t* profile, const uint8_t* patch, size_t size )
+{
+	assert( profile );
+	assert( patch || size == 0 );
+	financial_reader_t check = { .p = patch, .end = patch + size, .ok = true };
+	financial_reader_t apply = check;
+
+	return patch_apply( &check, profile, false ) && patch_apply( &apply, profile, true );
+}
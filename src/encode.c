@@ -0,0 +1,680 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#ifdef WEALTH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef __ANDROID__
+#include <vector.h>
+#else
+#include <libcollections/vector.h>
+#endif
+#include "wealth.h"
+#include "item.h"
+#include "stats.h"
+#include "profile.h"
+#include "buffer.h"
+
+/*
+ * Compressed layout
+ *
+ *   'F' 'P' 'C' codec varint(body size) payload
+ *
+ * The payload is the body, deflated when codec is FP_CODEC_ZLIB:
+ *
+ *   encoding varint(scale)
+ *   totals, income and goal as amounts; flags and credit fields as varints
+ *   for assets, liabilities and expenses:
+ *     varint(count)
+ *     descriptions: varint(prefix shared with previous) varint(length) bytes
+ *     classes: bits per class, then the classes packed LSB first
+ *     amounts: mode, then one varint per item
+ *   optionally, when the profile uses currencies:
+ *     varint(currency) varint(rate count), each rate as varint(code) raw64
+ *     for assets, liabilities and expenses, runs of varint(length) varint(code)
+ *
+ * Amount columns hold zigzag deltas of minor units when every amount is a
+ * whole number of them, and otherwise the XOR of each amount's bits with
+ * the previous one's.
+ */
+#define ENCODE_AMOUNTS_DELTA      (0)
+#define ENCODE_AMOUNTS_XOR        (1)
+
+/*
+ * The decompressed size comes from the stream itself, so it is checked
+ * against what deflate can actually produce before anything is allocated:
+ * at most 1032 bytes out per byte in, plus a little slack for tiny inputs.
+ */
+#define ENCODE_MAX_DEFLATE_RATIO  (1032)
+#define ENCODE_DEFLATE_SLACK      (64)
+
+
+static uint64_t encode_value_bits( value_t amount )
+{
+	uint64_t bits;
+	memcpy( &bits, &amount, sizeof(bits) );
+	return bits;
+}
+
+static uint64_t encode_value_bits_double( double value )
+{
+	uint64_t bits;
+	memcpy( &bits, &value, sizeof(bits) );
+	return bits;
+}
+
+static value_t decode_minor( int64_t minor, uint32_t scale )
+{
+#ifdef WEALTH_FIXED_POINT
+	if( scale == WEALTH_MONEY_SCALE )
+	{
+		return minor;
+	}
+#endif
+	return value_from_double( (double) minor / scale );
+}
+
+/* A single amount: zigzag minor units shifted left, or 1 and raw bits. */
+static void encode_amount( financial_buffer_t* buffer, value_t amount )
+{
+	int64_t minor;
+
+	if( __financial_amount_to_minor( amount, &minor ) && (zigzag_encode( minor ) >> 63) == 0 )
+	{
+		buffer_put_varint( buffer, zigzag_encode( minor ) << 1 );
+	}
+	else
+	{
+		buffer_put_varint( buffer, 1 );
+		buffer_put_raw64( buffer, encode_value_bits( amount ) );
+	}
+}
+
+static value_t decode_amount( financial_reader_t* reader, uint8_t encoding, uint32_t scale )
+{
+	uint64_t tag = reader_get_varint( reader );
+
+	if( tag & 1 )
+	{
+		uint64_t bits = reader_get_raw64( reader );
+		value_t raw;
+		memcpy( &raw, &bits, sizeof(raw) );
+		return __financial_profile_decode_amount( raw, encoding, scale );
+	}
+
+	return decode_minor( zigzag_decode( tag >> 1 ), scale );
+}
+
+static void encode_collection( financial_buffer_t* buffer, const financial_collection_t* items, financial_item_type_t type )
+{
+	size_t count = items->count;
+	buffer_put_varint( buffer, count );
+
+	/* Descriptions, front coded against the previous item. */
+	const char* previous = "";
+	size_t previous_length = 0;
+
+	for( size_t i = 0; i < count; i++ )
+	{
+		const financial_item_t* item = __financial_collection_at( items, i );
+		size_t length = strnlen( item->description, sizeof(desc_short_t) - 1 );
+		size_t prefix = 0;
+
+		while( prefix < length && prefix < previous_length && item->description[ prefix ] == previous[ prefix ] )
+		{
+			prefix += 1;
+		}
+
+		buffer_put_varint( buffer, prefix );
+		buffer_put_varint( buffer, length - prefix );
+		buffer_put_bytes( buffer, item->description + prefix, length - prefix );
+
+		previous        = item->description;
+		previous_length = length;
+	}
+
+	/* Classes, packed with just enough bits for the largest one. */
+	if( type != FI_MONTHLY_EXPENSE )
+	{
+		uint32_t largest = 0;
+
+		for( size_t i = 0; i < count; i++ )
+		{
+			const char* item = (const char*) __financial_collection_at( items, i );
+			uint32_t cls = type == FI_ASSET ? (uint32_t) ((const financial_asset_t*) item)->asset_class
+			                                : (uint32_t) ((const financial_liability_t*) item)->liability_class;
+			largest = cls > largest ? cls : largest;
+		}
+
+		uint8_t bits = 0;
+		while( bits < 32 && (largest >> bits) )
+		{
+			bits += 1;
+		}
+		buffer_put_byte( buffer, bits );
+
+		if( bits > 0 )
+		{
+			uint64_t accumulator = 0;
+			unsigned filled = 0;
+
+			for( size_t i = 0; i < count; i++ )
+			{
+				const char* item = (const char*) __financial_collection_at( items, i );
+				uint64_t cls = type == FI_ASSET ? (uint64_t) ((const financial_asset_t*) item)->asset_class
+				                                : (uint64_t) ((const financial_liability_t*) item)->liability_class;
+				accumulator |= cls << filled;
+				filled += bits;
+
+				while( filled >= 8 )
+				{
+					buffer_put_byte( buffer, (uint8_t) accumulator );
+					accumulator >>= 8;
+					filled -= 8;
+				}
+			}
+
+			if( filled > 0 )
+			{
+				buffer_put_byte( buffer, (uint8_t) accumulator );
+			}
+		}
+	}
+
+	/* Amounts */
+	bool whole = true;
+	for( size_t i = 0; whole && i < count; i++ )
+	{
+		int64_t minor;
+		whole = __financial_amount_to_minor( __financial_collection_at( items, i )->amount, &minor ) &&
+		        minor > -((int64_t) 1 << 61) && minor < ((int64_t) 1 << 61);
+	}
+
+	buffer_put_byte( buffer, whole ? ENCODE_AMOUNTS_DELTA : ENCODE_AMOUNTS_XOR );
+
+	if( whole )
+	{
+		int64_t last = 0;
+		for( size_t i = 0; i < count; i++ )
+		{
+			int64_t minor = 0;
+			__financial_amount_to_minor( __financial_collection_at( items, i )->amount, &minor );
+			buffer_put_varint( buffer, zigzag_encode( minor - last ) );
+			last = minor;
+		}
+	}
+	else
+	{
+		uint64_t last = 0;
+		for( size_t i = 0; i < count; i++ )
+		{
+			uint64_t bits = encode_value_bits( __financial_collection_at( items, i )->amount );
+			buffer_put_varint( buffer, bits ^ last );
+			last = bits;
+		}
+	}
+}
+
+static bool decode_collection( financial_reader_t* reader, financial_profile_t* profile, financial_item_type_t type, uint8_t encoding, uint32_t scale )
+{
+	uint64_t count = reader_get_varint( reader );
+
+	/* Every item takes at least three bytes, which bounds a corrupt count. */
+	if( !reader->ok || count > (uint64_t) (reader->end - reader->p) / 3 )
+	{
+		return false;
+	}
+
+	/* Every field is overwritten below, so the items are only appended. */
+	financial_collection_t* items = &profile->items[ type ];
+
+	for( uint64_t i = 0; i < count; i++ )
+	{
+		if( !__financial_collection_push( items ) )
+		{
+			return false;
+		}
+	}
+
+	/* Descriptions */
+	const char* previous = "";
+	size_t previous_length = 0;
+
+	for( uint64_t i = 0; i < count; i++ )
+	{
+		financial_item_t* item = __financial_collection_at( items, i );
+		uint64_t prefix = reader_get_varint( reader );
+		uint64_t suffix = reader_get_varint( reader );
+		const uint8_t* bytes = reader_get_bytes( reader, suffix );
+
+		if( !reader->ok || prefix > previous_length || prefix + suffix >= sizeof(desc_short_t) )
+		{
+			return false;
+		}
+
+		item->currency = FC_NONE;
+		memcpy( item->description, previous, prefix );
+		memcpy( item->description + prefix, bytes, suffix );
+		memset( item->description + prefix + suffix, 0, sizeof(desc_short_t) - (prefix + suffix) );
+
+		previous        = item->description;
+		previous_length = prefix + suffix;
+	}
+
+	/* Classes */
+	if( type != FI_MONTHLY_EXPENSE )
+	{
+		uint8_t bits = reader_get_byte( reader );
+		if( bits > 32 )
+		{
+			return false;
+		}
+
+		uint64_t mask = bits ? ((uint64_t) 1 << bits) - 1 : 0;
+		uint64_t accumulator = 0;
+		unsigned filled = 0;
+
+		for( uint64_t i = 0; i < count; i++ )
+		{
+			while( filled < bits )
+			{
+				accumulator |= (uint64_t) reader_get_byte( reader ) << filled;
+				filled += 8;
+			}
+
+			uint64_t cls = accumulator & mask;
+			accumulator >>= bits;
+			filled -= bits;
+
+			if( type == FI_ASSET )
+			{
+				((financial_asset_t*) __financial_collection_at( items, i ))->asset_class = (financial_asset_class_t) cls;
+			}
+			else
+			{
+				((financial_liability_t*) __financial_collection_at( items, i ))->liability_class = (financial_liability_class_t) cls;
+			}
+		}
+	}
+
+	/* Amounts */
+	uint8_t mode = reader_get_byte( reader );
+
+	if( mode == ENCODE_AMOUNTS_DELTA )
+	{
+		int64_t minor = 0;
+		for( uint64_t i = 0; i < count; i++ )
+		{
+			minor += zigzag_decode( reader_get_varint( reader ) );
+			__financial_collection_at( items, i )->amount = decode_minor( minor, scale );
+		}
+	}
+	else if( mode == ENCODE_AMOUNTS_XOR )
+	{
+		uint64_t bits = 0;
+		for( uint64_t i = 0; i < count; i++ )
+		{
+			value_t raw;
+			bits ^= reader_get_varint( reader );
+			memcpy( &raw, &bits, sizeof(raw) );
+			__financial_collection_at( items, i )->amount = __financial_profile_decode_amount( raw, encoding, scale );
+		}
+	}
+	else
+	{
+		return false;
+	}
+
+	return reader->ok;
+}
+
+static bool encode_uses_currencies( const financial_profile_t* profile )
+{
+	if( profile->currency != FC_NONE || profile->rates )
+	{
+		return true;
+	}
+
+	for( financial_item_type_t type = FI_ASSET; type <= FI_MONTHLY_EXPENSE; type++ )
+	{
+		const financial_collection_t* items = &profile->items[ type ];
+
+		for( size_t i = 0; i < items->count; i++ )
+		{
+			if( __financial_collection_at( items, i )->currency != FC_NONE )
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+static void encode_currencies( financial_buffer_t* buffer, const financial_profile_t* profile )
+{
+	size_t rate_count = profile->rates ? vector_size( profile->rates ) - 1 : 0;
+
+	buffer_put_varint( buffer, profile->currency );
+	buffer_put_varint( buffer, rate_count );
+
+	for( size_t i = 1; i <= rate_count; i++ )
+	{
+		buffer_put_varint( buffer, profile->rates[ i ].currency );
+		buffer_put_raw64( buffer, encode_value_bits_double( profile->rates[ i ].rate ) );
+	}
+
+	/* Items are usually grouped by currency, so codes are run length encoded. */
+	for( financial_item_type_t type = FI_ASSET; type <= FI_MONTHLY_EXPENSE; type++ )
+	{
+		const financial_collection_t* items = &profile->items[ type ];
+		size_t i = 0;
+
+		while( i < items->count )
+		{
+			financial_currency_t currency = __financial_collection_at( items, i )->currency;
+			size_t run = 1;
+
+			while( i + run < items->count && __financial_collection_at( items, i + run )->currency == currency )
+			{
+				run += 1;
+			}
+
+			buffer_put_varint( buffer, run );
+			buffer_put_varint( buffer, currency );
+			i += run;
+		}
+	}
+}
+
+static bool decode_currencies( financial_reader_t* reader, financial_profile_t* profile )
+{
+	uint64_t currency   = reader_get_varint( reader );
+	uint64_t rate_count = reader_get_varint( reader );
+
+	if( !reader->ok || currency > UINT32_MAX || rate_count > (uint64_t) (reader->end - reader->p) / 9 )
+	{
+		return false;
+	}
+
+	profile->currency = (financial_currency_t) currency;
+
+	for( uint64_t i = 0; i < rate_count; i++ )
+	{
+		uint64_t code = reader_get_varint( reader );
+		uint64_t bits = reader_get_raw64( reader );
+		double rate;
+		memcpy( &rate, &bits, sizeof(rate) );
+
+		if( !reader->ok || code > UINT32_MAX || !financial_profile_set_fx_rate( profile, (financial_currency_t) code, rate ) )
+		{
+			return false;
+		}
+	}
+
+	for( financial_item_type_t type = FI_ASSET; type <= FI_MONTHLY_EXPENSE; type++ )
+	{
+		financial_collection_t* items = &profile->items[ type ];
+		size_t i = 0;
+
+		/* The profile is still being decoded, so none of its chunks are shared. */
+		while( i < items->count )
+		{
+			uint64_t run  = reader_get_varint( reader );
+			uint64_t code = reader_get_varint( reader );
+
+			if( !reader->ok || run == 0 || run > items->count - i || code > UINT32_MAX )
+			{
+				return false;
+			}
+
+			for( ; run > 0; run--, i++ )
+			{
+				__financial_collection_at( items, i )->currency = (financial_currency_t) code;
+			}
+		}
+	}
+
+	return true;
+}
+
+static bool encode_body( financial_buffer_t* buffer, const financial_profile_t* profile )
+{
+	buffer_put_byte( buffer, FP_ENCODING_NATIVE );
+	buffer_put_varint( buffer, FP_MINOR_SCALE );
+
+	encode_amount( buffer, profile->total_assets );
+	encode_amount( buffer, profile->total_liabilities );
+	encode_amount( buffer, profile->total_expenses );
+	encode_amount( buffer, profile->monthly_income );
+	encode_amount( buffer, profile->disposable_income );
+	encode_amount( buffer, profile->net_worth );
+	encode_amount( buffer, profile->goal );
+	buffer_put_varint( buffer, profile->flags );
+	buffer_put_varint( buffer, profile->credit_score );
+	buffer_put_varint( buffer, profile->credit_score_updated );
+	buffer_put_varint( buffer, profile->last_updated );
+
+	encode_collection( buffer, &profile->items[ FI_ASSET ], FI_ASSET );
+	encode_collection( buffer, &profile->items[ FI_LIABILITY ], FI_LIABILITY );
+	encode_collection( buffer, &profile->items[ FI_MONTHLY_EXPENSE ], FI_MONTHLY_EXPENSE );
+
+	if( encode_uses_currencies( profile ) )
+	{
+		encode_currencies( buffer, profile );
+	}
+
+	return buffer->ok;
+}
+
+static financial_profile_t* decode_body( financial_reader_t* reader )
+{
+	uint8_t encoding = reader_get_byte( reader );
+	uint64_t scale   = reader_get_varint( reader );
+
+	if( !reader->ok || (encoding != FP_ENCODING_DOUBLE && encoding != FP_ENCODING_FIXED) || scale == 0 || scale > UINT32_MAX )
+	{
+		return NULL;
+	}
+
+	financial_profile_t* profile = financial_profile_create( );
+
+	if( profile )
+	{
+		profile->total_assets         = decode_amount( reader, encoding, (uint32_t) scale );
+		profile->total_liabilities    = decode_amount( reader, encoding, (uint32_t) scale );
+		profile->total_expenses       = decode_amount( reader, encoding, (uint32_t) scale );
+		profile->monthly_income       = decode_amount( reader, encoding, (uint32_t) scale );
+		profile->disposable_income    = decode_amount( reader, encoding, (uint32_t) scale );
+		profile->net_worth            = decode_amount( reader, encoding, (uint32_t) scale );
+		profile->goal                 = decode_amount( reader, encoding, (uint32_t) scale );
+		flags_t flags                 = (flags_t) reader_get_varint( reader );
+		profile->credit_score         = (uint16_t) reader_get_varint( reader );
+		profile->credit_score_updated = (uint32_t) reader_get_varint( reader );
+		profile->last_updated         = (uint32_t) reader_get_varint( reader );
+
+		if( !decode_collection( reader, profile, FI_ASSET, encoding, (uint32_t) scale ) ||
+		    !decode_collection( reader, profile, FI_LIABILITY, encoding, (uint32_t) scale ) ||
+		    !decode_collection( reader, profile, FI_MONTHLY_EXPENSE, encoding, (uint32_t) scale ) ||
+		    (reader->p != reader->end && !decode_currencies( reader, profile )) ||
+		    reader->p != reader->end )
+		{
+			financial_profile_destroy( &profile );
+		}
+		else
+		{
+			/* Currency subtotals are not encoded, so profiles with rates rescan on refresh. */
+			profile->flags = flags | (profile->flags & (FP_FLAG_ASSETS_DIRTY | FP_FLAG_LIABILITIES_DIRTY | FP_FLAG_MONTHLY_EXPENSES_DIRTY));
+		}
+	}
+
+	return profile;
+}
+
+
+bool financial_profile_encode( const financial_profile_t* profile, financial_profile_codec_t codec, uint8_t** data, size_t* size )
+{
+	assert( profile );
+	assert( data );
+	assert( size );
+	financial_buffer_t body = { .data = NULL, .size = 0, .capacity = 0, .ok = true };
+	financial_buffer_t out  = { .data = NULL, .size = 0, .capacity = 0, .ok = true };
+	bool result = false;
+
+	if( !encode_body( &body, profile ) )
+	{
+		goto done;
+	}
+
+	buffer_put_byte( &out, 'F' );
+	buffer_put_byte( &out, 'P' );
+	buffer_put_byte( &out, FP_ENCODING_COMPRESSED );
+	buffer_put_byte( &out, (uint8_t) codec );
+	buffer_put_varint( &out, body.size );
+
+	switch( codec )
+	{
+		case FP_CODEC_NONE:
+			buffer_put_bytes( &out, body.data, body.size );
+			break;
+#ifdef WEALTH_ZLIB
+		case FP_CODEC_ZLIB:
+		{
+			uLongf bound = compressBound( body.size );
+			if( buffer_reserve( &out, bound ) &&
+			    compress2( out.data + out.size, &bound, body.data, body.size, Z_BEST_SPEED ) == Z_OK )
+			{
+				out.size += bound;
+			}
+			else
+			{
+				out.ok = false;
+			}
+			break;
+		}
+#endif
+		default:
+			out.ok = false;
+			break;
+	}
+
+	if( out.ok )
+	{
+		*data  = out.data;
+		*size  = out.size;
+		out.data = NULL;
+		result = true;
+	}
+
+done:
+	free( body.data );
+	free( out.data );
+	return result;
+}
+
+financial_profile_t* financial_profile_decode( const uint8_t* data, size_t size )
+{
+	assert( data || size == 0 );
+	financial_reader_t reader = { .p = data, .end = data + size, .ok = true };
+	financial_profile_t* profile = NULL;
+
+	if( reader_get_byte( &reader ) != 'F' || reader_get_byte( &reader ) != 'P' ||
+	    reader_get_byte( &reader ) != FP_ENCODING_COMPRESSED )
+	{
+		return NULL;
+	}
+
+	uint8_t codec = reader_get_byte( &reader );
+	uint64_t body_size = reader_get_varint( &reader );
+
+	if( !reader.ok )
+	{
+		return NULL;
+	}
+
+	switch( codec )
+	{
+		case FP_CODEC_NONE:
+		{
+			if( body_size == (uint64_t) (reader.end - reader.p) )
+			{
+				profile = decode_body( &reader );
+			}
+			break;
+		}
+#ifdef WEALTH_ZLIB
+		case FP_CODEC_ZLIB:
+		{
+			uint64_t input = (uint64_t) (reader.end - reader.p);
+			uLongf length  = (uLongf) body_size;
+			uint8_t* body  = NULL;
+
+			if( length == body_size && body_size <= input * ENCODE_MAX_DEFLATE_RATIO + ENCODE_DEFLATE_SLACK )
+			{
+				body = malloc( length ? length : 1 );
+			}
+
+			if( body && uncompress( body, &length, reader.p, (uLong) (reader.end - reader.p) ) == Z_OK && length == body_size )
+			{
+				financial_reader_t inner = { .p = body, .end = body + length, .ok = true };
+				profile = decode_body( &inner );
+			}
+			free( body );
+			break;
+		}
+#endif
+		default:
+			break;
+	}
+
+	return profile;
+}
+
+bool financial_profile_save_compressed( const financial_profile_t* profile, const char* filename, financial_profile_codec_t codec )
+{
+	assert( profile );
+	STATS_TIMER_BEGIN( timer );
+	uint8_t* data = NULL;
+	size_t size   = 0;
+	bool result   = false;
+
+	if( financial_profile_encode( profile, codec, &data, &size ) )
+	{
+		FILE* file = fopen( filename, "wb" );
+
+		if( file )
+		{
+			result = fwrite( data, 1, size, file ) == size;
+			result = fclose( file ) == 0 && result;
+		}
+
+		free( data );
+	}
+
+	STATS_COUNT( FS_BYTES_SAVED, result ? size : 0 );
+	STATS_TIMER_END( FS_OP_SAVE, timer );
+	return result;
+}
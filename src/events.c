@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "wealth.h"
+#include "events.h"
+
+
+struct financial_subscription {
+	const financial_profile_t*      profile;
+	financial_profile_updated_fxn_t callback;
+	void*                           data;
+	financial_event_queue_t*        queue;
+	flags_t                         mask;
+	flags_t                         pending; /* queued subscriptions; updated atomically */
+	bool                            active;
+	struct financial_subscription*  next;
+};
+
+/*
+ * Bounded multi-producer/single-consumer ring. Each slot carries a sequence
+ * number so producers claim slots with a single CAS on the head and the
+ * consumer never takes a lock (D. Vyukov's bounded queue).
+ */
+typedef struct financial_event_slot {
+	size_t                    sequence;
+	financial_subscription_t* subscription;
+} financial_event_slot_t;
+
+struct financial_event_queue {
+	size_t                 mask;
+	size_t                 dropped;
+	size_t                 head; /* producers */
+	size_t                 tail; /* consumer */
+	financial_event_slot_t slots[];
+};
+
+
+financial_event_queue_t* financial_event_queue_create( size_t capacity )
+{
+	size_t size = 2;
+	while( size < capacity )
+	{
+		size <<= 1;
+	}
+
+	financial_event_queue_t* queue = malloc( sizeof(financial_event_queue_t) + size * sizeof(financial_event_slot_t) );
+
+	if( queue )
+	{
+		queue->mask    = size - 1;
+		queue->dropped = 0;
+		queue->head    = 0;
+		queue->tail    = 0;
+
+		for( size_t i = 0; i < size; i++ )
+		{
+			queue->slots[ i ].sequence     = i;
+			queue->slots[ i ].subscription = NULL;
+		}
+	}
+
+	return queue;
+}
+
+void financial_event_queue_destroy( financial_event_queue_t** p_queue )
+{
+	if( p_queue && *p_queue )
+	{
+		free( *p_queue );
+		*p_queue = NULL;
+	}
+}
+
+static bool financial_event_queue_push( financial_event_queue_t* queue, financial_subscription_t* subscription )
+{
+	size_t pos = __atomic_load_n( &queue->head, __ATOMIC_RELAXED );
+	financial_event_slot_t* slot;
+
+	for( ;; )
+	{
+		slot = &queue->slots[ pos & queue->mask ];
+		size_t sequence = __atomic_load_n( &slot->sequence, __ATOMIC_ACQUIRE );
+		intptr_t difference = (intptr_t) sequence - (intptr_t) pos;
+
+		if( difference == 0 )
+		{
+			if( __atomic_compare_exchange_n( &queue->head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) )
+			{
+				break;
+			}
+		}
+		else if( difference < 0 )
+		{
+			return false; /* full */
+		}
+		else
+		{
+			pos = __atomic_load_n( &queue->head, __ATOMIC_RELAXED );
+		}
+	}
+
+	slot->subscription = subscription;
+	__atomic_store_n( &slot->sequence, pos + 1, __ATOMIC_RELEASE );
+	return true;
+}
+
+static financial_subscription_t* financial_event_queue_pop( financial_event_queue_t* queue )
+{
+	size_t pos = queue->tail;
+	financial_event_slot_t* slot = &queue->slots[ pos & queue->mask ];
+	size_t sequence = __atomic_load_n( &slot->sequence, __ATOMIC_ACQUIRE );
+	financial_subscription_t* result = NULL;
+
+	if( sequence == pos + 1 )
+	{
+		result = slot->subscription;
+		queue->tail = pos + 1;
+		__atomic_store_n( &slot->sequence, pos + queue->mask + 1, __ATOMIC_RELEASE );
+	}
+
+	return result;
+}
+
+size_t financial_event_queue_drain( financial_event_queue_t* queue, size_t max_events )
+{
+	assert( queue );
+	size_t delivered = 0;
+
+	while( delivered < max_events )
+	{
+		financial_subscription_t* subscription = financial_event_queue_pop( queue );
+
+		if( !subscription )
+		{
+			break;
+		}
+
+		flags_t flags = __atomic_exchange_n( &subscription->pending, 0, __ATOMIC_ACQ_REL );
+
+		if( flags && subscription->active )
+		{
+			subscription->callback( subscription->profile, flags, subscription->data );
+			delivered += 1;
+		}
+	}
+
+	return delivered;
+}
+
+size_t financial_event_queue_dropped( const financial_event_queue_t* queue )
+{
+	assert( queue );
+	return __atomic_load_n( &queue->dropped, __ATOMIC_RELAXED );
+}
+
+static void financial_subscription_post( financial_subscription_t* subscription, flags_t flags )
+{
+	flags_t previous = __atomic_fetch_or( &subscription->pending, flags, __ATOMIC_ACQ_REL );
+
+	/* Already queued; the new bits ride along with that event. */
+	if( previous == 0 && !financial_event_queue_push( subscription->queue, subscription ) )
+	{
+		__atomic_store_n( &subscription->pending, 0, __ATOMIC_RELEASE );
+		__atomic_fetch_add( &subscription->queue->dropped, 1, __ATOMIC_RELAXED );
+	}
+}
+
+
+
+financial_subscription_t* __financial_subscriptions_add( financial_subscription_t** list, const financial_profile_t* profile, flags_t mask, financial_profile_updated_fxn_t callback, void* data, financial_event_queue_t* queue )
+{
+	assert( list );
+	assert( callback );
+	financial_subscription_t* subscription = NULL;
+
+	/* Reuse a slot that was unsubscribed and has nothing left in a queue. */
+	for( financial_subscription_t* s = *list; s; s = s->next )
+	{
+		if( !s->active && __atomic_load_n( &s->pending, __ATOMIC_ACQUIRE ) == 0 )
+		{
+			subscription = s;
+			break;
+		}
+	}
+
+	if( !subscription )
+	{
+		subscription = malloc( sizeof(financial_subscription_t) );
+		if( !subscription )
+		{
+			return NULL;
+		}
+		subscription->next = *list;
+		*list = subscription;
+	}
+
+	subscription->profile  = profile;
+	subscription->callback = callback;
+	subscription->data     = data;
+	subscription->queue    = queue;
+	subscription->mask     = mask;
+	subscription->pending  = 0;
+	subscription->active   = true;
+
+	return subscription;
+}
+
+void __financial_subscriptions_remove( financial_subscription_t* list, financial_subscription_t* subscription )
+{
+	(void) list;
+	if( subscription )
+	{
+		/* The node is kept because a queue may still reference it. */
+		subscription->active = false;
+	}
+}
+
+void __financial_subscriptions_notify( financial_subscription_t* list, flags_t flags )
+{
+	for( financial_subscription_t* s = list; s; s = s->next )
+	{
+		flags_t relevant = flags & s->mask;
+
+		if( !s->active || !relevant )
+		{
+			continue;
+		}
+
+		if( s->queue )
+		{
+			financial_subscription_post( s, relevant );
+		}
+		else
+		{
+			s->callback( s->profile, relevant, s->data );
+		}
+	}
+}
+
+void __financial_subscriptions_destroy( financial_subscription_t** list )
+{
+	assert( list );
+	financial_subscription_t* s = *list;
+
+	while( s )
+	{
+		financial_subscription_t* next = s->next;
+		free( s );
+		s = next;
+	}
+
+	*list = NULL;
+}
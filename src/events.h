@@ -0,0 +1,30 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _FINANCIAL_EVENTS_H_
+#define _FINANCIAL_EVENTS_H_
+
+financial_subscription_t* __financial_subscriptions_add     ( financial_subscription_t** list, const financial_profile_t* profile, flags_t mask, financial_profile_updated_fxn_t callback, void* data, financial_event_queue_t* queue );
+void                      __financial_subscriptions_remove  ( financial_subscription_t* list, financial_subscription_t* subscription );
+void                      __financial_subscriptions_notify  ( financial_subscription_t* list, flags_t flags );
+void                      __financial_subscriptions_destroy ( financial_subscription_t** list );
+
+#endif /* _FINANCIAL_EVENTS_H_ */
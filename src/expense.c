@@ -32,13 +32,5 @@
 
 value_t financial_expense_collection_sum( const financial_expense_t* collection )
 {
-	value_t sum = 0.0;
-	const size_t count = vector_size( collection );
-
-	for( size_t i = 0; i < count; i++ )
-	{
-		sum += collection[ i ].base.amount;
-	}
-
-	return sum;
+	return financial_item_amount_sum( collection, sizeof(*collection), vector_size( collection ) );
 }
@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include "wealth.h"
+#include "factors.h"
+
+/*
+ * Rows are laid out per rate so a projection walking time for one rate
+ * reads consecutive memory.
+ */
+struct financial_factor_table {
+	size_t  rate_count;
+	size_t  periods;
+	size_t  row;         /* periods + 1 */
+	double* rates;
+	double* growth;      /* rate_count rows of (1 + r)^n */
+	double* annuity_fv;  /* rate_count rows of ((1 + r)^n - 1) / r */
+	double* annuity_pv;  /* rate_count rows of (1 - (1 + r)^-n) / r */
+};
+
+
+financial_factor_table_t* financial_factor_table_create( const double* rates, size_t rate_count, size_t periods )
+{
+	assert( rates || rate_count == 0 );
+	financial_factor_table_t* table = malloc( sizeof(financial_factor_table_t) );
+
+	if( table )
+	{
+		size_t row = periods + 1;
+		double* data = malloc( (rate_count + 3 * rate_count * row) * sizeof(double) );
+
+		if( !data )
+		{
+			free( table );
+			return NULL;
+		}
+
+		table->rate_count = rate_count;
+		table->periods    = periods;
+		table->row        = row;
+		table->rates      = data;
+		table->growth     = table->rates + rate_count;
+		table->annuity_fv = table->growth + rate_count * row;
+		table->annuity_pv = table->annuity_fv + rate_count * row;
+
+		for( size_t r = 0; r < rate_count; r++ )
+		{
+			double rate = rates[ r ];
+			double* growth = &table->growth[ r * row ];
+			double* fv     = &table->annuity_fv[ r * row ];
+			double* pv     = &table->annuity_pv[ r * row ];
+
+			table->rates[ r ] = rate;
+
+			for( size_t n = 0; n < row; n++ )
+			{
+				/* pow() per entry keeps the table identical to the inline helpers. */
+				double g = pow( 1 + rate, (double) n );
+				growth[ n ] = g;
+				fv[ n ]     = rate == 0 ? (double) n : (g - 1) / rate;
+				pv[ n ]     = rate == 0 ? (double) n : (1 - 1 / g) / rate;
+			}
+		}
+	}
+
+	return table;
+}
+
+void financial_factor_table_destroy( financial_factor_table_t** p_table )
+{
+	if( p_table && *p_table )
+	{
+		free( (*p_table)->rates );
+		free( *p_table );
+		*p_table = NULL;
+	}
+}
+
+size_t financial_factor_table_rate_count( const financial_factor_table_t* table )
+{
+	assert( table );
+	return table->rate_count;
+}
+
+size_t financial_factor_table_periods( const financial_factor_table_t* table )
+{
+	assert( table );
+	return table->periods;
+}
+
+double financial_factor_table_rate( const financial_factor_table_t* table, size_t rate )
+{
+	assert( table );
+	assert( rate < table->rate_count );
+	return table->rates[ rate ];
+}
+
+bool financial_factor_table_find_rate( const financial_factor_table_t* table, double rate, size_t* index )
+{
+	assert( table );
+
+	for( size_t r = 0; r < table->rate_count; r++ )
+	{
+		if( table->rates[ r ] == rate )
+		{
+			if( index ) *index = r;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static inline double financial_factor_lookup( const financial_factor_table_t* table, const double* row, double time, bool* found )
+{
+	double result = 0.0;
+	*found = false;
+
+	if( time >= 0 && time <= (double) table->periods )
+	{
+		size_t n = (size_t) time;
+		double fraction = time - (double) n;
+
+		result = row[ n ];
+		if( fraction > 0 )
+		{
+			result += fraction * (row[ n + 1 ] - result);
+		}
+		*found = true;
+	}
+
+	return result;
+}
+
+double financial_factor_growth( const financial_factor_table_t* table, size_t rate, double time )
+{
+	assert( table );
+	assert( rate < table->rate_count );
+	bool found;
+	double result = financial_factor_lookup( table, &table->growth[ rate * table->row ], time, &found );
+	return found ? result : pow( 1 + table->rates[ rate ], time );
+}
+
+double financial_factor_annuity_fv( const financial_factor_table_t* table, size_t rate, double time )
+{
+	assert( table );
+	assert( rate < table->rate_count );
+	bool found;
+	double result = financial_factor_lookup( table, &table->annuity_fv[ rate * table->row ], time, &found );
+
+	if( !found )
+	{
+		double r = table->rates[ rate ];
+		result = r == 0 ? time : (pow( 1 + r, time ) - 1) / r;
+	}
+
+	return result;
+}
+
+double financial_factor_annuity_pv( const financial_factor_table_t* table, size_t rate, double time )
+{
+	assert( table );
+	assert( rate < table->rate_count );
+	bool found;
+	double result = financial_factor_lookup( table, &table->annuity_pv[ rate * table->row ], time, &found );
+
+	if( !found )
+	{
+		double r = table->rates[ rate ];
+		result = r == 0 ? time : (1 - 1 / pow( 1 + r, time )) / r;
+	}
+
+	return result;
+}
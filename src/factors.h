@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _WEALTH_FACTORS_H_
+#define _WEALTH_FACTORS_H_
+#include "wealth.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Interest factor tables
+ *
+ * For a fixed set of periodic rates and a horizon of N periods the table
+ * holds (1 + r)^n and the ordinary annuity factors for n = 0..N, so the
+ * helpers below are a load and a multiply instead of a pow(). Non-integer
+ * times are linearly interpolated between neighbouring periods; times past
+ * the horizon fall back to computing the factor directly.
+ */
+struct financial_factor_table;
+typedef struct financial_factor_table financial_factor_table_t;
+
+financial_factor_table_t* financial_factor_table_create      ( const double* rates, size_t rate_count, size_t periods );
+void                      financial_factor_table_destroy     ( financial_factor_table_t** table );
+size_t                    financial_factor_table_rate_count  ( const financial_factor_table_t* table );
+size_t                    financial_factor_table_periods     ( const financial_factor_table_t* table );
+double                    financial_factor_table_rate        ( const financial_factor_table_t* table, size_t rate );
+bool                      financial_factor_table_find_rate   ( const financial_factor_table_t* table, double rate, size_t* index );
+
+double  financial_factor_growth            ( const financial_factor_table_t* table, size_t rate, double time ); /* (1 + r)^t */
+double  financial_factor_annuity_fv        ( const financial_factor_table_t* table, size_t rate, double time ); /* ((1 + r)^t - 1) / r */
+double  financial_factor_annuity_pv        ( const financial_factor_table_t* table, size_t rate, double time ); /* (1 - (1 + r)^-t) / r */
+
+static inline value_t financial_factor_compound_interest( const financial_factor_table_t* table, value_t principle, size_t rate, double time )
+{
+	return value_from_double( value_to_double( principle ) * financial_factor_growth( table, rate, time ) );
+}
+
+static inline value_t financial_factor_annuity_future_value( const financial_factor_table_t* table, value_t amount, size_t rate, double time )
+{
+	return value_from_double( value_to_double( amount ) * financial_factor_annuity_fv( table, rate, time ) );
+}
+
+static inline value_t financial_factor_annuity_due_future_value( const financial_factor_table_t* table, value_t amount, size_t rate, double time )
+{
+	return value_from_double( value_to_double( amount ) * financial_factor_annuity_fv( table, rate, time ) * (1 + financial_factor_table_rate( table, rate )) );
+}
+
+static inline value_t financial_factor_annuity_present_value( const financial_factor_table_t* table, value_t amount, size_t rate, double time )
+{
+	return value_from_double( value_to_double( amount ) * financial_factor_annuity_pv( table, rate, time ) );
+}
+
+static inline value_t financial_factor_annuity_due_present_value( const financial_factor_table_t* table, value_t amount, size_t rate, double time )
+{
+	return value_from_double( value_to_double( amount ) * financial_factor_annuity_pv( table, rate, time ) * (1 + financial_factor_table_rate( table, rate )) );
+}
+
+#ifdef __cplusplus
+} /* extern C Linkage */
+#if __cplusplus >= 201402L
+#include <cstddef>
+namespace wealth {
+
+/*
+ * The same tables built at compile time:
+ *
+ *   constexpr double rates[] = { 0.01 / 12, 0.04 / 12 };
+ *   constexpr auto table = wealth::make_factor_table<480>( rates );
+ *   static_assert( table.growth( 1, 12 ) > 1.04, "" );
+ *
+ * Powers are formed by repeated squaring, so entries can differ from pow()
+ * in the last few bits.
+ */
+template <std::size_t Rates, std::size_t Periods>
+class FactorTable {
+  public:
+	constexpr explicit FactorTable( const double (&rates)[ Rates ] )
+		: m_rates( ), m_growth( ), m_annuity_fv( ), m_annuity_pv( )
+	{
+		for( std::size_t r = 0; r < Rates; r++ )
+		{
+			m_rates[ r ] = rates[ r ];
+
+			for( std::size_t n = 0; n <= Periods; n++ )
+			{
+				double g = power( 1 + rates[ r ], n );
+				m_growth[ r ][ n ]     = g;
+				m_annuity_fv[ r ][ n ] = rates[ r ] == 0 ? (double) n : (g - 1) / rates[ r ];
+				m_annuity_pv[ r ][ n ] = rates[ r ] == 0 ? (double) n : (1 - 1 / g) / rates[ r ];
+			}
+		}
+	}
+
+	constexpr std::size_t rate_count( ) const                 { return Rates; }
+	constexpr std::size_t periods( ) const                    { return Periods; }
+	constexpr double rate( std::size_t r ) const              { return m_rates[ r ]; }
+	constexpr double growth( std::size_t r, std::size_t n ) const     { return m_growth[ r ][ n ]; }
+	constexpr double annuity_fv( std::size_t r, std::size_t n ) const { return m_annuity_fv[ r ][ n ]; }
+	constexpr double annuity_pv( std::size_t r, std::size_t n ) const { return m_annuity_pv[ r ][ n ]; }
+
+	value_t compound_interest( value_t principle, std::size_t r, std::size_t n ) const
+	{
+		return value_from_double( value_to_double( principle ) * m_growth[ r ][ n ] );
+	}
+
+	value_t annuity_future_value( value_t amount, std::size_t r, std::size_t n ) const
+	{
+		return value_from_double( value_to_double( amount ) * m_annuity_fv[ r ][ n ] );
+	}
+
+	value_t annuity_present_value( value_t amount, std::size_t r, std::size_t n ) const
+	{
+		return value_from_double( value_to_double( amount ) * m_annuity_pv[ r ][ n ] );
+	}
+
+  private:
+	static constexpr double power( double base, std::size_t exponent )
+	{
+		double result = 1;
+		while( exponent )
+		{
+			if( exponent & 1 ) result *= base;
+			base *= base;
+			exponent >>= 1;
+		}
+		return result;
+	}
+
+	double m_rates[ Rates ];
+	double m_growth[ Rates ][ Periods + 1 ];
+	double m_annuity_fv[ Rates ][ Periods + 1 ];
+	double m_annuity_pv[ Rates ][ Periods + 1 ];
+};
+
+template <std::size_t Periods, std::size_t Rates>
+constexpr FactorTable<Rates, Periods> make_factor_table( const double (&rates)[ Rates ] )
+{
+	return FactorTable<Rates, Periods>( rates );
+}
+
+} /* namespace wealth */
+#endif
+#endif
+#endif /* _WEALTH_FACTORS_H_ */
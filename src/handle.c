@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#ifdef __ANDROID__
+#include <vector.h>
+#else
+#include <libcollections/vector.h>
+#endif
+#include "wealth.h"
+#include "item.h"
+#include "handle.h"
+#include "profile.h"
+
+/*
+ * A handle is the slot number in the low 32 bits and the slot's
+ * generation in the high 32 bits. Generations start at one and move on
+ * every time a slot is freed, so a stale handle never matches again and
+ * no handle is ever zero.
+ */
+#define HANDLE_NONE         (UINT32_MAX)
+#define HANDLE_RELEASED     (UINT32_MAX)
+
+static inline financial_item_handle_t handle_make( uint32_t slot, uint32_t generation )
+{
+	return ((financial_item_handle_t) generation << 32) | slot;
+}
+
+static void handle_free_slot( financial_handle_table_t* table, uint32_t slot )
+{
+	financial_handle_slot_t* s = &table->slots[ slot ];
+	s->generation = s->generation == UINT32_MAX ? 1 : s->generation + 1;
+	s->index = table->free_slot;
+	table->free_slot = slot;
+}
+
+financial_handle_table_t* __financial_handles_create( size_t count )
+{
+	financial_handle_table_t* table = malloc( sizeof(financial_handle_table_t) );
+
+	if( table )
+	{
+		vector_create( table->slots, count > 10 ? count : 10 );
+		vector_create( table->items, count > 10 ? count : 10 );
+		table->free_slot = HANDLE_NONE;
+
+		for( size_t i = 0; i < count; i++ )
+		{
+			financial_handle_slot_t slot = { .index = (uint32_t) i, .generation = 1 };
+			vector_push( table->slots, slot );
+			vector_push( table->items, (uint32_t) i );
+		}
+	}
+
+	return table;
+}
+
+void __financial_handles_destroy( financial_handle_table_t** p_table )
+{
+	if( p_table && *p_table )
+	{
+		vector_destroy( (*p_table)->slots );
+		vector_destroy( (*p_table)->items );
+		free( *p_table );
+		*p_table = NULL;
+	}
+}
+
+/* Gives the item just appended to the collection a slot. */
+void __financial_handles_push( financial_handle_table_t* table )
+{
+	uint32_t index = (uint32_t) vector_size( table->items );
+	uint32_t slot  = table->free_slot;
+
+	if( slot != HANDLE_NONE )
+	{
+		table->free_slot = table->slots[ slot ].index;
+		table->slots[ slot ].index = index;
+	}
+	else
+	{
+		financial_handle_slot_t s = { .index = index, .generation = 1 };
+		slot = (uint32_t) vector_size( table->slots );
+		vector_push( table->slots, s );
+	}
+
+	vector_push( table->items, slot );
+}
+
+/* Mirrors removing an item by moving the last one into its place. */
+void __financial_handles_remove( financial_handle_table_t* table, size_t index )
+{
+	size_t last = vector_size( table->items ) - 1;
+	uint32_t moved = table->items[ last ];
+
+	handle_free_slot( table, table->items[ index ] );
+	if( index != last )
+	{
+		table->items[ index ] = moved;
+		table->slots[ moved ].index = (uint32_t) index;
+	}
+	vector_pop( table->items );
+}
+
+/*
+ * Releases the slot of an item that an order-preserving removal is about
+ * to drop; __financial_handles_compact() closes the gaps afterwards.
+ */
+void __financial_handles_release( financial_handle_table_t* table, size_t index )
+{
+	handle_free_slot( table, table->items[ index ] );
+	table->items[ index ] = HANDLE_RELEASED;
+}
+
+void __financial_handles_compact( financial_handle_table_t* table )
+{
+	size_t count = vector_size( table->items );
+	size_t write = 0;
+
+	for( size_t read = 0; read < count; read++ )
+	{
+		uint32_t slot = table->items[ read ];
+		table->items[ write ] = slot;
+		write += slot != HANDLE_RELEASED;
+	}
+
+	while( vector_size( table->items ) > write )
+	{
+		vector_pop( table->items );
+	}
+
+	__financial_handles_reindex( table );
+}
+
+/* Points every live slot back at its item after the items were permuted. */
+void __financial_handles_reindex( financial_handle_table_t* table )
+{
+	size_t count = vector_size( table->items );
+
+	for( size_t i = 0; i < count; i++ )
+	{
+		table->slots[ table->items[ i ] ].index = (uint32_t) i;
+	}
+}
+
+void __financial_handles_clear( financial_handle_table_t* table )
+{
+	size_t count = vector_size( table->items );
+
+	for( size_t i = 0; i < count; i++ )
+	{
+		handle_free_slot( table, table->items[ i ] );
+	}
+
+	vector_clear( table->items );
+}
+
+
+financial_item_handle_t financial_profile_item_handle( financial_profile_t* profile, financial_item_type_t type, size_t index )
+{
+	assert( profile );
+	size_t count = financial_profile_item_count( profile, type );
+
+	if( index >= count || type > FI_MONTHLY_EXPENSE || count > UINT32_MAX - 1 )
+	{
+		return FI_HANDLE_NONE;
+	}
+
+	financial_handle_table_t* table = profile->handles[ type ];
+
+	if( !table )
+	{
+		table = __financial_handles_create( count );
+		if( !table )
+		{
+			return FI_HANDLE_NONE;
+		}
+		profile->handles[ type ] = table;
+	}
+
+	uint32_t slot = table->items[ index ];
+	return handle_make( slot, table->slots[ slot ].generation );
+}
+
+size_t financial_profile_item_handle_index( const financial_profile_t* profile, financial_item_type_t type, financial_item_handle_t handle )
+{
+	assert( profile );
+	const financial_handle_table_t* table = type <= FI_MONTHLY_EXPENSE ? profile->handles[ type ] : NULL;
+	uint32_t slot = (uint32_t) handle;
+
+	if( table && slot < vector_size( table->slots ) &&
+	    table->slots[ slot ].generation == (uint32_t) (handle >> 32) )
+	{
+		return table->slots[ slot ].index;
+	}
+
+	return (size_t) -1;
+}
+
+financial_item_t* financial_profile_item_resolve( financial_profile_t* profile, financial_item_type_t type, financial_item_handle_t handle )
+{
+	size_t index = financial_profile_item_handle_index( profile, type, handle );
+	return index != (size_t) -1 ? financial_profile_item_get( profile, type, index ) : NULL;
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _FINANCIAL_HANDLE_H_
+#define _FINANCIAL_HANDLE_H_
+
+/*
+ * Slot table behind the item handles of one collection. items runs
+ * parallel to the collection and names the slot of each item; a live slot
+ * holds the item's index, a free one the next free slot.
+ */
+typedef struct financial_handle_slot {
+	uint32_t index;
+	uint32_t generation;
+} financial_handle_slot_t;
+
+typedef struct financial_handle_table {
+	financial_handle_slot_t* slots;
+	uint32_t*                items;
+	uint32_t                 free_slot;
+} financial_handle_table_t;
+
+financial_handle_table_t* __financial_handles_create  ( size_t count );
+void                      __financial_handles_destroy ( financial_handle_table_t** table );
+void                      __financial_handles_push    ( financial_handle_table_t* table );
+void                      __financial_handles_remove  ( financial_handle_table_t* table, size_t index );
+void                      __financial_handles_release ( financial_handle_table_t* table, size_t index );
+void                      __financial_handles_compact ( financial_handle_table_t* table );
+void                      __financial_handles_reindex ( financial_handle_table_t* table );
+void                      __financial_handles_clear   ( financial_handle_table_t* table );
+
+#endif /* _FINANCIAL_HANDLE_H_ */
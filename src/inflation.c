@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include "wealth.h"
+#include "inflation.h"
+
+struct financial_deflator {
+	size_t  periods;
+	double* factors; /* periods + 1 cumulative factors, factors[ 0 ] = 1 */
+};
+
+static financial_deflator_t* deflator_alloc( size_t periods )
+{
+	financial_deflator_t* deflator = malloc( sizeof(financial_deflator_t) );
+
+	if( deflator )
+	{
+		deflator->periods = periods;
+		deflator->factors = malloc( (periods + 1) * sizeof(double) );
+		if( !deflator->factors )
+		{
+			free( deflator );
+			return NULL;
+		}
+		deflator->factors[ 0 ] = 1.0;
+	}
+
+	return deflator;
+}
+
+financial_deflator_t* financial_deflator_create_constant( double rate, size_t periods )
+{
+	financial_deflator_t* deflator = deflator_alloc( periods );
+
+	if( deflator )
+	{
+		double step = 1 / (1 + rate);
+		for( size_t n = 1; n <= periods; n++ )
+		{
+			deflator->factors[ n ] = deflator->factors[ n - 1 ] * step;
+		}
+	}
+
+	return deflator;
+}
+
+financial_deflator_t* financial_deflator_create_rates( const double* rates, size_t periods )
+{
+	assert( rates || periods == 0 );
+	financial_deflator_t* deflator = deflator_alloc( periods );
+
+	if( deflator )
+	{
+		for( size_t n = 1; n <= periods; n++ )
+		{
+			deflator->factors[ n ] = deflator->factors[ n - 1 ] / (1 + rates[ n - 1 ]);
+		}
+	}
+
+	return deflator;
+}
+
+financial_deflator_t* financial_deflator_create_cpi( const double* cpi, size_t count )
+{
+	assert( cpi );
+	financial_deflator_t* deflator = count > 0 && cpi[ 0 ] > 0 ? deflator_alloc( count - 1 ) : NULL;
+
+	if( deflator )
+	{
+		for( size_t n = 1; n < count; n++ )
+		{
+			deflator->factors[ n ] = cpi[ 0 ] / cpi[ n ];
+		}
+	}
+
+	return deflator;
+}
+
+void financial_deflator_destroy( financial_deflator_t** p_deflator )
+{
+	if( p_deflator && *p_deflator )
+	{
+		free( (*p_deflator)->factors );
+		free( *p_deflator );
+		*p_deflator = NULL;
+	}
+}
+
+size_t financial_deflator_periods( const financial_deflator_t* deflator )
+{
+	assert( deflator );
+	return deflator->periods;
+}
+
+const double* financial_deflator_factors( const financial_deflator_t* deflator )
+{
+	assert( deflator );
+	return deflator->factors;
+}
+
+double financial_deflator_factor( const financial_deflator_t* deflator, size_t period )
+{
+	assert( deflator );
+	assert( period <= deflator->periods );
+	return deflator->factors[ period ];
+}
+
+value_t financial_deflate_amount( const financial_deflator_t* deflator, value_t amount, size_t period )
+{
+	return value_from_double( value_to_double( amount ) * financial_deflator_factor( deflator, period ) );
+}
+
+value_t financial_inflate_amount( const financial_deflator_t* deflator, value_t amount, size_t period )
+{
+	return value_from_double( value_to_double( amount ) / financial_deflator_factor( deflator, period ) );
+}
+
+bool financial_deflate_series( const financial_deflator_t* deflator, size_t first_period, const double* nominal, double* real, size_t count )
+{
+	assert( deflator );
+	assert( (nominal && real) || count == 0 );
+
+	if( first_period > deflator->periods || count > deflator->periods - first_period + 1 )
+	{
+		return false;
+	}
+
+	const double* factors = deflator->factors + first_period;
+	for( size_t i = 0; i < count; i++ )
+	{
+		real[ i ] = nominal[ i ] * factors[ i ];
+	}
+
+	return true;
+}
+
+bool financial_deflate_rows( const financial_deflator_t* deflator, size_t first_period, const double* nominal, double* real, size_t rows, size_t columns )
+{
+	assert( deflator );
+	assert( (nominal && real) || rows == 0 || columns == 0 );
+
+	if( first_period > deflator->periods || rows > deflator->periods - first_period + 1 )
+	{
+		return false;
+	}
+
+	const double* factors = deflator->factors + first_period;
+	for( size_t n = 0; n < rows; n++ )
+	{
+		const double  factor = factors[ n ];
+		const double* in     = nominal + n * columns;
+		double*       out    = real + n * columns;
+
+		for( size_t c = 0; c < columns; c++ )
+		{
+			out[ c ] = in[ c ] * factor;
+		}
+	}
+
+	return true;
+}
+
+value_t financial_deflator_annuity_fv( const financial_deflator_t* deflator, value_t amount, double rate, size_t period )
+{
+	double factor = financial_deflator_factor( deflator, period );
+	double fv = rate == 0 ? value_to_double( amount ) * period : value_to_double( annuity_future_value( amount, rate, (double) period ) );
+	return value_from_double( fv * factor );
+}
+
+
+static bool deflating_begin( void* context, const double* rates, size_t rate_count, size_t periods )
+{
+	financial_deflating_sink_t* state = context;
+
+	if( rate_count > state->capacity || periods > state->deflator->periods )
+	{
+		return false;
+	}
+
+	return !state->inner.begin || state->inner.begin( state->inner.context, rates, rate_count, periods );
+}
+
+static bool deflating_row( void* context, size_t period, double deposit, const double* balances, size_t rate_count )
+{
+	financial_deflating_sink_t* state = context;
+	const double factor = state->deflator->factors[ period ];
+
+	for( size_t r = 0; r < rate_count; r++ )
+	{
+		state->row[ r ] = balances[ r ] * factor;
+	}
+
+	return !state->inner.row || state->inner.row( state->inner.context, period, deposit * factor, state->row, rate_count );
+}
+
+static bool deflating_end( void* context )
+{
+	financial_deflating_sink_t* state = context;
+	return !state->inner.end || state->inner.end( state->inner.context );
+}
+
+financial_projection_sink_t financial_projection_deflating_sink( financial_deflating_sink_t* state, const financial_deflator_t* deflator,
+                                                                 const financial_projection_sink_t* inner, double* row, size_t capacity )
+{
+	assert( state );
+	assert( deflator );
+	assert( inner );
+	assert( row || capacity == 0 );
+	financial_projection_sink_t sink = { deflating_begin, deflating_row, deflating_end, state };
+	state->deflator = deflator;
+	state->inner    = *inner;
+	state->row      = row;
+	state->capacity = capacity;
+	return sink;
+}
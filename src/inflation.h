@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _WEALTH_INFLATION_H_
+#define _WEALTH_INFLATION_H_
+#include "wealth.h"
+#include "projection.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Inflation
+ *
+ * A deflator turns money of period n into today's (period zero) money.
+ * Its factors are the cumulative products 1 / ((1 + i_0) ... (1 + i_n-1)),
+ * built once when it is created, so deflating a series costs one multiply
+ * per element. The path is a constant per-period rate, a series of
+ * per-period rates, or a series of CPI levels with today's level first.
+ *
+ * Deflating divides out inflation: a balance projected for period n is
+ * worth amount * factor( n ) today. Inflating is the reverse, e.g. the
+ * nominal amount a goal must reach in period n to be worth today's goal.
+ */
+struct financial_deflator;
+typedef struct financial_deflator financial_deflator_t;
+
+financial_deflator_t* financial_deflator_create_constant( double rate, size_t periods );
+financial_deflator_t* financial_deflator_create_rates   ( const double* rates, size_t periods );
+financial_deflator_t* financial_deflator_create_cpi     ( const double* cpi, size_t count );
+void                  financial_deflator_destroy        ( financial_deflator_t** deflator );
+size_t                financial_deflator_periods        ( const financial_deflator_t* deflator );
+const double*         financial_deflator_factors        ( const financial_deflator_t* deflator );
+double                financial_deflator_factor         ( const financial_deflator_t* deflator, size_t period );
+
+value_t financial_deflate_amount( const financial_deflator_t* deflator, value_t amount, size_t period );
+value_t financial_inflate_amount( const financial_deflator_t* deflator, value_t amount, size_t period );
+
+/*
+ * Series
+ *
+ * financial_deflate_series() deflates count values for consecutive periods
+ * starting at first_period; real may be nominal. financial_deflate_rows()
+ * does the same for a row-major table with columns values per period, as
+ * filled by the projection buffer sink. Both return false, leaving real
+ * alone, when the periods run past the deflator.
+ */
+bool financial_deflate_series( const financial_deflator_t* deflator, size_t first_period, const double* nominal, double* real, size_t count );
+bool financial_deflate_rows  ( const financial_deflator_t* deflator, size_t first_period, const double* nominal, double* real, size_t rows, size_t columns );
+
+/*
+ * Annuities in today's money
+ *
+ * The deflator variant values a level nominal deposit stream at period n in
+ * today's money. The inline helpers do the same for constant inflation;
+ * financial_real_rate() is the Fisher rate, which grows deposits that
+ * themselves rise with inflation.
+ */
+value_t financial_deflator_annuity_fv( const financial_deflator_t* deflator, value_t amount, double rate, size_t period );
+
+static inline double financial_real_rate( double rate, double inflation )
+{
+	return (1 + rate) / (1 + inflation) - 1;
+}
+
+static inline value_t real_compound_interest( value_t principle, double rate, double inflation, double time )
+{
+	return compound_interest( principle, financial_real_rate( rate, inflation ), time );
+}
+
+static inline value_t real_annuity_future_value( value_t amount, double rate, double inflation, double time )
+{
+	return value_from_double( value_to_double( annuity_future_value( amount, rate, time ) ) / pow( 1 + inflation, time ) );
+}
+
+static inline value_t real_annuity_due_future_value( value_t amount, double rate, double inflation, double time )
+{
+	return value_from_double( value_to_double( annuity_due_future_value( amount, rate, time ) ) / pow( 1 + inflation, time ) );
+}
+
+/*
+ * Deflating sink
+ *
+ * Wraps another projection sink so it receives balances (and deposits) in
+ * today's money. Row n is deflated by factor( n ). The caller provides room
+ * for one row of balances; a projection with more rates than capacity, or
+ * more periods than the deflator, fails in begin.
+ */
+typedef struct financial_deflating_sink {
+	const financial_deflator_t*  deflator;
+	financial_projection_sink_t  inner;
+	double*                      row;
+	size_t                       capacity;
+} financial_deflating_sink_t;
+
+financial_projection_sink_t financial_projection_deflating_sink( financial_deflating_sink_t* state, const financial_deflator_t* deflator,
+                                                                 const financial_projection_sink_t* inner, double* row, size_t capacity );
+
+#ifdef __cplusplus
+} /* extern C Linkage */
+#endif
+#endif /* _WEALTH_INFLATION_H_ */
@@ -21,6 +21,7 @@
  */
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <assert.h>
 #ifdef __ANDROID__
 #include <vector.h>
@@ -29,6 +30,7 @@
 #endif
 #include "wealth.h"
 #include "item.h"
+#include "parallel.h"
 
 
 const char* financial_item_description( const financial_item_t* item )
@@ -60,17 +62,191 @@ void financial_item_set_amount( financial_item_t* item, value_t amount )
 
 value_t financial_item_collection_sum( financial_item_t* collection )
 {
-	value_t sum = 0.0;
-	const size_t count = vector_size( collection );
+	return financial_item_amount_sum( collection, sizeof(*collection), vector_size( collection ) );
+}
 
-	for( size_t i = 0; i < count; i++ )
+
+/*
+ * Summation
+ *
+ * Small collections are summed with a plain loop. Larger ones are split
+ * into FINANCIAL_SUM_BLOCK item blocks, each summed pairwise, and the block
+ * sums are combined pairwise by always splitting the block range in half.
+ * That tree depends only on the item count, so summing the blocks on any
+ * number of threads, or from chunks rather than one array, produces the
+ * same bits.
+ */
+#define FINANCIAL_SUM_BLOCK        (4096)
+#define FINANCIAL_SUM_LEAF         (32)
+
+#define amount_at(base, stride, i) (((const financial_item_t*) ((const char*) (base) + (i) * (stride)))->amount)
+
+/* Items to sum: one array when base is set, a profile's chunks otherwise. */
+typedef struct financial_item_source {
+	const char*                   base;
+	const financial_collection_t* collection;
+	size_t                        stride;
+	size_t                        count;
+} financial_item_source_t;
+
+/* The longest contiguous run of at most *count items starting at first. */
+static const char* financial_item_source_run( const financial_item_source_t* source, size_t first, size_t* count )
+{
+	if( source->base )
+	{
+		return source->base + first * source->stride;
+	}
+	else
 	{
-		sum += collection[ i ].amount;
+		size_t left = FINANCIAL_ITEM_CHUNK - (first & (FINANCIAL_ITEM_CHUNK - 1));
+		*count = *count < left ? *count : left;
+		return (const char*) __financial_collection_at( source->collection, first );
+	}
+}
+
+static value_t financial_item_pairwise_sum( const financial_item_source_t* source, size_t first, size_t count )
+{
+	if( count <= FINANCIAL_SUM_LEAF )
+	{
+		value_t s[ 4 ] = { 0, 0, 0, 0 };
+		size_t stride = source->stride;
+		size_t run = count;
+		const char* base = financial_item_source_run( source, first, &run );
+
+		if( run == count )
+		{
+			size_t i = 0;
+
+			for( ; i + 4 <= count; i += 4 )
+			{
+				s[ 0 ] += amount_at( base, stride, i );
+				s[ 1 ] += amount_at( base, stride, i + 1 );
+				s[ 2 ] += amount_at( base, stride, i + 2 );
+				s[ 3 ] += amount_at( base, stride, i + 3 );
+			}
+
+			for( ; i < count; i++ )
+			{
+				s[ 0 ] += amount_at( base, stride, i );
+			}
+		}
+		else
+		{
+			/* A leaf across a chunk boundary adds in the same order, one run at a time. */
+			size_t quads = count & ~(size_t) 3;
+
+			for( size_t i = 0; ; )
+			{
+				for( size_t k = 0; k < run; k++, i++ )
+				{
+					s[ i < quads ? (i & 3) : 0 ] += amount_at( base, stride, k );
+				}
+
+				if( i == count )
+				{
+					break;
+				}
+
+				run  = count - i;
+				base = financial_item_source_run( source, first + i, &run );
+			}
+		}
+
+		return (s[ 0 ] + s[ 1 ]) + (s[ 2 ] + s[ 3 ]);
+	}
+	else
+	{
+		size_t half = count / 2;
+		return financial_item_pairwise_sum( source, first, half ) +
+		       financial_item_pairwise_sum( source, first + half, count - half );
+	}
+}
+
+static value_t financial_item_block_sum( const financial_item_source_t* source, size_t block )
+{
+	size_t first = block * FINANCIAL_SUM_BLOCK;
+	size_t n     = source->count - first < FINANCIAL_SUM_BLOCK ? source->count - first : FINANCIAL_SUM_BLOCK;
+	return financial_item_pairwise_sum( source, first, n );
+}
+
+/* Combines blocks [first, last) either from precomputed sums or on the fly. */
+static value_t financial_item_block_tree_sum( const financial_item_source_t* source, const value_t* sums, size_t first, size_t last )
+{
+	if( last - first == 1 )
+	{
+		return sums ? sums[ first ] : financial_item_block_sum( source, first );
+	}
+	else
+	{
+		size_t middle = first + (last - first) / 2;
+		return financial_item_block_tree_sum( source, sums, first, middle ) +
+		       financial_item_block_tree_sum( source, sums, middle, last );
+	}
+}
+
+typedef struct financial_item_sum_job {
+	const financial_item_source_t* source;
+	value_t*                       sums;
+} financial_item_sum_job_t;
+
+static void financial_item_sum_task( size_t block, size_t worker, void* data )
+{
+	financial_item_sum_job_t* job = data;
+	job->sums[ block ] = financial_item_block_sum( job->source, block );
+}
+
+static value_t financial_item_source_sum( const financial_item_source_t* source )
+{
+	value_t sum = 0;
+
+	if( source->count <= __financial_serial_threshold( ) )
+	{
+		for( size_t i = 0; i < source->count; )
+		{
+			size_t run = source->count - i;
+			const char* base = financial_item_source_run( source, i, &run );
+
+			for( size_t k = 0; k < run; k++ )
+			{
+				sum += amount_at( base, source->stride, k );
+			}
+			i += run;
+		}
+	}
+	else
+	{
+		size_t blocks = (source->count + FINANCIAL_SUM_BLOCK - 1) / FINANCIAL_SUM_BLOCK;
+		financial_item_sum_job_t job = { .source = source, .sums = NULL };
+
+		if( __financial_parallel_workers( blocks ) > 1 )
+		{
+			job.sums = malloc( blocks * sizeof(value_t) );
+		}
+
+		if( job.sums )
+		{
+			__financial_parallel_for( blocks, financial_item_sum_task, &job );
+		}
+
+		sum = financial_item_block_tree_sum( source, job.sums, 0, blocks );
+		free( job.sums );
 	}
 
 	return sum;
 }
 
+value_t financial_item_amount_sum( const void* collection, size_t item_size, size_t count )
+{
+	financial_item_source_t source = { .base = collection, .collection = NULL, .stride = item_size, .count = count };
+	return financial_item_source_sum( &source );
+}
+
+value_t __financial_collection_sum( const financial_collection_t* collection )
+{
+	financial_item_source_t source = { .base = NULL, .collection = collection, .stride = collection->stride, .count = collection->count };
+	return financial_item_source_sum( &source );
+}
+
 
 static inline int financial_item_description_asc_compare( const void* l, const void* r )
 {
@@ -88,7 +264,7 @@ static inline int financial_item_amount_asc_compare( const void* l, const void*
 {
 	const financial_item_t* left  = l;
 	const financial_item_t* right = r;
-	return (int) (left->amount - right->amount);
+	return (left->amount > right->amount) - (left->amount < right->amount);
 }
 
 static inline int financial_item_amount_des_compare( const void* l, const void* r )
@@ -105,9 +281,526 @@ static int (*financial_item_sort_methods[])( const void*, const void* ) = {
 };
 
 //void financial_item_collection_sort( financial_item_t* collection, financial_item_sort_method_t method )
-void financial_item_collection_sort( void* collection, size_t item_size, financial_item_sort_method_t method )
+void financial_item_collection_sort( void* collection, size_t item_size, financial_item_sort_method_t method, uint32_t* tags )
 {
 	const size_t count = vector_size( collection );
 	int (*compare)( const void*, const void* ) = financial_item_sort_methods[ method ];
-	qsort( collection, count, item_size, compare );
+
+	if( !tags )
+	{
+		qsort( collection, count, item_size, compare );
+		return;
+	}
+
+	/*
+	 * Each item is sorted with its tag appended so the tags follow the
+	 * permutation. The comparators only look at the item itself.
+	 */
+	size_t record = item_size + sizeof(uint64_t);
+	char* records = malloc( count * record );
+
+	if( records )
+	{
+		for( size_t i = 0; i < count; i++ )
+		{
+			memcpy( records + i * record, (char*) collection + i * item_size, item_size );
+			memcpy( records + i * record + item_size, &tags[ i ], sizeof(uint32_t) );
+		}
+
+		qsort( records, count, record, compare );
+
+		for( size_t i = 0; i < count; i++ )
+		{
+			memcpy( (char*) collection + i * item_size, records + i * record, item_size );
+			memcpy( &tags[ i ], records + i * record + item_size, sizeof(uint32_t) );
+		}
+
+		free( records );
+	}
+}
+
+
+/*
+ * Chunked collections
+ *
+ * Chunks [0, used) are allocated, where used covers count items; popping
+ * releases chunks that empty. The last reference to a chunk frees it.
+ */
+static inline size_t __financial_collection_used( size_t count )
+{
+	return (count + FINANCIAL_ITEM_CHUNK - 1) >> FINANCIAL_ITEM_CHUNK_SHIFT;
+}
+
+static inline size_t __financial_chunk_size( size_t stride )
+{
+	return sizeof(financial_item_chunk_t) + FINANCIAL_ITEM_CHUNK * stride;
+}
+
+/*
+ * Chunk lookup
+ *
+ * Addresses are divided into buckets at least as large as a chunk's items,
+ * so the items of a chunk fall in at most two buckets. The lookup maps each
+ * of those buckets to the chunk with linear probing, and holds no more than
+ * half as many entries as slots. An item is then found by probing its own
+ * bucket and checking the chunks found there, whatever memory it is in.
+ */
+typedef struct financial_chunk_slot {
+	uintptr_t bucket;
+	size_t    chunk; /* index + 1, or zero when the slot is empty */
+} financial_chunk_slot_t;
+
+static inline size_t __financial_lookup_home( const financial_collection_t* collection, uintptr_t bucket )
+{
+	return (size_t) (((uint64_t) bucket * 0x9E3779B97F4A7C15ull) >> (64 - collection->lookup_bits));
+}
+
+static inline uintptr_t __financial_chunk_items( const financial_collection_t* collection, size_t k )
+{
+	return (uintptr_t) (collection->chunks[ k ] + 1);
+}
+
+static void __financial_lookup_put( financial_collection_t* collection, uintptr_t bucket, size_t k )
+{
+	size_t mask = ((size_t) 1 << collection->lookup_bits) - 1;
+	size_t i    = __financial_lookup_home( collection, bucket );
+
+	while( collection->lookup[ i ].chunk )
+	{
+		i = (i + 1) & mask;
+	}
+
+	collection->lookup[ i ].bucket = bucket;
+	collection->lookup[ i ].chunk  = k + 1;
+}
+
+/* Removes an entry and moves later ones of its run back, so no probe stops early. */
+static void __financial_lookup_take( financial_collection_t* collection, uintptr_t bucket, size_t k )
+{
+	financial_chunk_slot_t* lookup = collection->lookup;
+	size_t mask = ((size_t) 1 << collection->lookup_bits) - 1;
+	size_t i    = __financial_lookup_home( collection, bucket );
+
+	while( lookup[ i ].chunk != k + 1 || lookup[ i ].bucket != bucket )
+	{
+		assert( lookup[ i ].chunk );
+		i = (i + 1) & mask;
+	}
+
+	for( size_t j = (i + 1) & mask; lookup[ j ].chunk; j = (j + 1) & mask )
+	{
+		size_t home = __financial_lookup_home( collection, lookup[ j ].bucket );
+
+		/* The entry at j may fill the hole at i unless its home lies in (i, j]. */
+		if( ((j - home) & mask) >= ((j - i) & mask) )
+		{
+			lookup[ i ] = lookup[ j ];
+			i = j;
+		}
+	}
+
+	lookup[ i ].chunk = 0;
+}
+
+static void __financial_lookup_add( financial_collection_t* collection, size_t k )
+{
+	uintptr_t items = __financial_chunk_items( collection, k );
+	uintptr_t first = items >> collection->bucket_shift;
+	uintptr_t last  = (items + FINANCIAL_ITEM_CHUNK * collection->stride - 1) >> collection->bucket_shift;
+
+	__financial_lookup_put( collection, first, k );
+	if( last != first )
+	{
+		__financial_lookup_put( collection, last, k );
+	}
+}
+
+static void __financial_lookup_remove( financial_collection_t* collection, size_t k )
+{
+	uintptr_t items = __financial_chunk_items( collection, k );
+	uintptr_t first = items >> collection->bucket_shift;
+	uintptr_t last  = (items + FINANCIAL_ITEM_CHUNK * collection->stride - 1) >> collection->bucket_shift;
+
+	__financial_lookup_take( collection, first, k );
+	if( last != first )
+	{
+		__financial_lookup_take( collection, last, k );
+	}
+}
+
+/* Makes room for the entries of `chunks` chunks, rebuilding the lookup from chunks [0, used). */
+static bool __financial_lookup_reserve( financial_collection_t* collection, size_t chunks, size_t used )
+{
+	uint32_t bits = collection->lookup ? collection->lookup_bits : 3;
+
+	while( ((size_t) 1 << bits) < 4 * chunks )
+	{
+		bits += 1;
+	}
+
+	if( collection->lookup && bits == collection->lookup_bits )
+	{
+		return true;
+	}
+
+	financial_chunk_slot_t* lookup = calloc( (size_t) 1 << bits, sizeof(financial_chunk_slot_t) );
+
+	if( !lookup )
+	{
+		return false;
+	}
+
+	free( collection->lookup );
+	collection->lookup      = lookup;
+	collection->lookup_bits = bits;
+
+	for( size_t k = 0; k < used; k++ )
+	{
+		__financial_lookup_add( collection, k );
+	}
+
+	return true;
+}
+
+static void __financial_chunk_release( financial_item_chunk_t* chunk )
+{
+	if( __atomic_sub_fetch( &chunk->refs, 1, __ATOMIC_ACQ_REL ) == 0 )
+	{
+		free( chunk );
+	}
+}
+
+/* Gives the collection its own copy of chunk k if another still shares it. */
+static bool __financial_chunk_unshare( financial_collection_t* collection, size_t k )
+{
+	financial_item_chunk_t* chunk = collection->chunks[ k ];
+
+	if( __atomic_load_n( &chunk->refs, __ATOMIC_ACQUIRE ) > 1 )
+	{
+		size_t first = k << FINANCIAL_ITEM_CHUNK_SHIFT;
+		size_t count = collection->count - first < FINANCIAL_ITEM_CHUNK ? collection->count - first : FINANCIAL_ITEM_CHUNK;
+		financial_item_chunk_t* copy = malloc( __financial_chunk_size( collection->stride ) );
+
+		if( !copy )
+		{
+			return false;
+		}
+
+		copy->refs     = 1;
+		copy->reserved = 0;
+		memcpy( copy + 1, chunk + 1, count * collection->stride );
+		__financial_lookup_remove( collection, k );
+		__financial_chunk_release( chunk );
+		collection->chunks[ k ] = copy;
+		__financial_lookup_add( collection, k );
+		collection->version += 1;
+	}
+
+	return true;
+}
+
+void __financial_collection_init( financial_collection_t* collection, size_t stride )
+{
+	collection->chunks   = NULL;
+	collection->count    = 0;
+	collection->capacity = 0;
+	collection->stride   = stride;
+	collection->version  = 0;
+
+	collection->lookup       = NULL;
+	collection->lookup_bits  = 0;
+	collection->bucket_shift = 0;
+	while( ((size_t) 1 << collection->bucket_shift) < FINANCIAL_ITEM_CHUNK * stride )
+	{
+		collection->bucket_shift += 1;
+	}
+}
+
+void __financial_collection_destroy( financial_collection_t* collection )
+{
+	size_t used = __financial_collection_used( collection->count );
+
+	for( size_t k = 0; k < used; k++ )
+	{
+		__financial_chunk_release( collection->chunks[ k ] );
+	}
+
+	size_t version = collection->version;
+	free( collection->chunks );
+	free( collection->lookup );
+	__financial_collection_init( collection, collection->stride );
+	collection->version = version + 1;
+}
+
+/* Makes an empty collection share every chunk of another. */
+bool __financial_collection_share( financial_collection_t* collection, const financial_collection_t* from )
+{
+	size_t used = __financial_collection_used( from->count );
+	__financial_collection_init( collection, from->stride );
+
+	if( used > 0 )
+	{
+		size_t slots = (size_t) 1 << from->lookup_bits;
+		collection->chunks = malloc( used * sizeof(financial_item_chunk_t*) );
+		collection->lookup = malloc( slots * sizeof(financial_chunk_slot_t) );
+
+		if( !collection->chunks || !collection->lookup )
+		{
+			free( collection->chunks );
+			free( collection->lookup );
+			__financial_collection_init( collection, from->stride );
+			return false;
+		}
+
+		/* The chunks and their indices are the same, so the lookup is too. */
+		memcpy( collection->lookup, from->lookup, slots * sizeof(financial_chunk_slot_t) );
+		collection->lookup_bits = from->lookup_bits;
+
+		for( size_t k = 0; k < used; k++ )
+		{
+			collection->chunks[ k ] = from->chunks[ k ];
+			__atomic_add_fetch( &collection->chunks[ k ]->refs, 1, __ATOMIC_ACQ_REL );
+		}
+
+		collection->capacity = used;
+		collection->count    = from->count;
+	}
+
+	return true;
+}
+
+/* Appends a zeroed item; a shared last chunk is copied before its free slot is used. */
+financial_item_t* __financial_collection_push( financial_collection_t* collection )
+{
+	size_t k = collection->count >> FINANCIAL_ITEM_CHUNK_SHIFT;
+
+	if( (collection->count & (FINANCIAL_ITEM_CHUNK - 1)) == 0 )
+	{
+		if( k == collection->capacity )
+		{
+			size_t capacity = collection->capacity ? 2 * collection->capacity : 4;
+			financial_item_chunk_t** chunks = realloc( collection->chunks, capacity * sizeof(financial_item_chunk_t*) );
+
+			if( !chunks )
+			{
+				return NULL;
+			}
+
+			collection->chunks   = chunks;
+			collection->capacity = capacity;
+		}
+
+		financial_item_chunk_t* chunk = malloc( __financial_chunk_size( collection->stride ) );
+
+		if( !chunk || !__financial_lookup_reserve( collection, k + 1, k ) )
+		{
+			free( chunk );
+			return NULL;
+		}
+
+		chunk->refs     = 1;
+		chunk->reserved = 0;
+		collection->chunks[ k ] = chunk;
+		__financial_lookup_add( collection, k );
+	}
+	else if( !__financial_chunk_unshare( collection, k ) )
+	{
+		return NULL;
+	}
+
+	financial_item_t* item = __financial_collection_at( collection, collection->count );
+	memset( item, 0, collection->stride );
+	collection->count += 1;
+	return item;
+}
+
+void __financial_collection_pop( financial_collection_t* collection, size_t count )
+{
+	assert( count <= collection->count );
+	size_t used = __financial_collection_used( collection->count );
+	collection->count -= count;
+
+	for( size_t k = __financial_collection_used( collection->count ); k < used; k++ )
+	{
+		__financial_lookup_remove( collection, k );
+		__financial_chunk_release( collection->chunks[ k ] );
+		collection->version += 1;
+	}
+}
+
+/* Copies any chunk holding items [first, first + count) that is still shared. */
+bool __financial_collection_unshare( financial_collection_t* collection, size_t first, size_t count )
+{
+	if( count > 0 )
+	{
+		size_t last = (first + count - 1) >> FINANCIAL_ITEM_CHUNK_SHIFT;
+
+		for( size_t k = first >> FINANCIAL_ITEM_CHUNK_SHIFT; k <= last; k++ )
+		{
+			if( !__financial_chunk_unshare( collection, k ) )
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+financial_item_t* __financial_collection_write( financial_collection_t* collection, size_t index )
+{
+	assert( index < collection->count );
+	return __financial_chunk_unshare( collection, index >> FINANCIAL_ITEM_CHUNK_SHIFT ) ? __financial_collection_at( collection, index ) : NULL;
+}
+
+/* The items from first to the end of its chunk. */
+financial_item_span_t __financial_collection_span( const financial_collection_t* collection, size_t first )
+{
+	financial_item_span_t span = { .base = NULL, .stride = collection->stride, .count = 0 };
+
+	if( first < collection->count )
+	{
+		size_t left = FINANCIAL_ITEM_CHUNK - (first & (FINANCIAL_ITEM_CHUNK - 1));
+		span.base  = __financial_collection_at( collection, first );
+		span.count = collection->count - first < left ? collection->count - first : left;
+	}
+
+	return span;
+}
+
+/* Finds an item through the chunk lookup, or returns SIZE_MAX for an item elsewhere. */
+size_t __financial_collection_index( const financial_collection_t* collection, const financial_item_t* item )
+{
+	if( collection->lookup )
+	{
+		uintptr_t p      = (uintptr_t) item;
+		uintptr_t bucket = p >> collection->bucket_shift;
+		size_t mask      = ((size_t) 1 << collection->lookup_bits) - 1;
+
+		for( size_t i = __financial_lookup_home( collection, bucket ); collection->lookup[ i ].chunk; i = (i + 1) & mask )
+		{
+			size_t k = collection->lookup[ i ].chunk - 1;
+			uintptr_t items = __financial_chunk_items( collection, k );
+
+			if( collection->lookup[ i ].bucket == bucket && p >= items && p < items + FINANCIAL_ITEM_CHUNK * collection->stride )
+			{
+				size_t index = (k << FINANCIAL_ITEM_CHUNK_SHIFT) + (p - items) / collection->stride;
+				return (p - items) % collection->stride == 0 && index < collection->count ? index : SIZE_MAX;
+			}
+		}
+	}
+
+	return SIZE_MAX;
+}
+
+/*
+ * Writes back records, each an item followed by its old index as a
+ * uint64_t, so the tags can follow. Chunks the permutation leaves
+ * unchanged stay shared, and nothing is written unless every chunk that
+ * changes could be made private.
+ */
+static bool collection_place( financial_collection_t* collection, const char* records, uint32_t* tags )
+{
+	size_t count  = collection->count;
+	size_t stride = collection->stride;
+	size_t record = stride + sizeof(uint64_t);
+	size_t used   = __financial_collection_used( count );
+	uint8_t* changed = calloc( used ? used : 1, 1 );
+	uint32_t* placed_tags = tags ? malloc( (count ? count : 1) * sizeof(uint32_t) ) : NULL;
+	bool writable = changed && (!tags || placed_tags);
+
+	if( !writable )
+	{
+		goto done;
+	}
+
+	for( size_t i = 0; i < count; i++ )
+	{
+		if( memcmp( records + i * record, __financial_collection_at( collection, i ), stride ) != 0 )
+		{
+			changed[ i >> FINANCIAL_ITEM_CHUNK_SHIFT ] = 1;
+		}
+	}
+
+	for( size_t k = 0; k < used && writable; k++ )
+	{
+		writable = !changed[ k ] || __financial_chunk_unshare( collection, k );
+	}
+
+	if( writable )
+	{
+		for( size_t i = 0; i < count; i++ )
+		{
+			uint64_t index;
+			memcpy( &index, records + i * record + stride, sizeof(index) );
+
+			if( changed[ i >> FINANCIAL_ITEM_CHUNK_SHIFT ] )
+			{
+				memcpy( __financial_collection_at( collection, i ), records + i * record, stride );
+			}
+			if( tags )
+			{
+				placed_tags[ i ] = tags[ index ];
+			}
+		}
+
+		if( tags )
+		{
+			memcpy( tags, placed_tags, count * sizeof(uint32_t) );
+		}
+	}
+
+done:
+	free( changed );
+	free( placed_tags );
+	return writable;
+}
+
+/* Sorts through a contiguous copy of the items tagged with their old indices. */
+void __financial_collection_sort( financial_collection_t* collection, financial_item_sort_method_t method, uint32_t* tags )
+{
+	size_t count  = collection->count;
+	size_t stride = collection->stride;
+	size_t record = stride + sizeof(uint64_t);
+	char* records = malloc( (count ? count : 1) * record );
+
+	if( records )
+	{
+		for( size_t i = 0; i < count; i++ )
+		{
+			uint64_t index = i;
+			memcpy( records + i * record, __financial_collection_at( collection, i ), stride );
+			memcpy( records + i * record + stride, &index, sizeof(index) );
+		}
+
+		qsort( records, count, record, financial_item_sort_methods[ method ] );
+		collection_place( collection, records, tags );
+	}
+
+	free( records );
+}
+
+/* Moves the item at order[ i ] to index i; order must be a permutation. */
+bool __financial_collection_permute( financial_collection_t* collection, const size_t* order, uint32_t* tags )
+{
+	size_t count  = collection->count;
+	size_t stride = collection->stride;
+	size_t record = stride + sizeof(uint64_t);
+	char* records = malloc( (count ? count : 1) * record );
+	bool result = false;
+
+	if( records )
+	{
+		for( size_t i = 0; i < count; i++ )
+		{
+			uint64_t index = order[ i ];
+			memcpy( records + i * record, __financial_collection_at( collection, order[ i ] ), stride );
+			memcpy( records + i * record + stride, &index, sizeof(index) );
+		}
+
+		result = collection_place( collection, records, tags );
+	}
+
+	free( records );
+	return result;
 }
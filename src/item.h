@@ -25,6 +25,7 @@
 struct financial_item {
 	desc_short_t          description;
 	value_t               amount;
+	financial_currency_t  currency;  /* FC_NONE for the profile's currency */
 };
 
 struct financial_asset {
@@ -41,7 +42,60 @@ struct financial_expense {
 	financial_item_t base;
 };
 
-void    financial_item_collection_sort ( void* collection, size_t item_size, financial_item_sort_method_t method );
+/*
+ * Profiles keep the items of one type in chunks of FINANCIAL_ITEM_CHUNK
+ * items, each followed by its items. A chunk never moves once allocated,
+ * and forks share chunks: every chunk carries an atomic reference count,
+ * and a collection copies a chunk still shared with another before writing
+ * to it, so a fork only pays for the chunks it touches. Reads go through
+ * __financial_collection_at() and __financial_collection_span(); writes
+ * through __financial_collection_write() or a range made private with
+ * __financial_collection_unshare().
+ */
+#define FINANCIAL_ITEM_CHUNK_SHIFT          (6)
+#define FINANCIAL_ITEM_CHUNK                ((size_t) 1 << FINANCIAL_ITEM_CHUNK_SHIFT)
+
+typedef struct financial_item_chunk {
+	uint32_t refs;
+	uint32_t reserved; /* keeps the items that follow 8 byte aligned */
+} financial_item_chunk_t;
+
+struct financial_chunk_slot;
+
+typedef struct financial_collection {
+	financial_item_chunk_t** chunks;
+	size_t                   count;
+	size_t                   capacity; /* chunk pointers allocated */
+	size_t                   stride;
+	size_t                   version;  /* changes when a chunk is copied or released */
+
+	/* Chunks by address, so an item's index is found in constant time; see item.c. */
+	struct financial_chunk_slot* lookup;
+	uint32_t                     lookup_bits;  /* lookup has 2^lookup_bits slots */
+	uint32_t                     bucket_shift; /* bytes per address bucket, as a power of two */
+} financial_collection_t;
+
+static inline financial_item_t* __financial_collection_at( const financial_collection_t* collection, size_t index )
+{
+	return (financial_item_t*) ((char*) (collection->chunks[ index >> FINANCIAL_ITEM_CHUNK_SHIFT ] + 1) +
+	                            (index & (FINANCIAL_ITEM_CHUNK - 1)) * collection->stride);
+}
+
+void                  __financial_collection_init    ( financial_collection_t* collection, size_t stride );
+void                  __financial_collection_destroy ( financial_collection_t* collection );
+bool                  __financial_collection_share   ( financial_collection_t* collection, const financial_collection_t* from );
+financial_item_t*     __financial_collection_push    ( financial_collection_t* collection );
+void                  __financial_collection_pop     ( financial_collection_t* collection, size_t count );
+bool                  __financial_collection_unshare ( financial_collection_t* collection, size_t first, size_t count );
+financial_item_t*     __financial_collection_write   ( financial_collection_t* collection, size_t index );
+financial_item_span_t __financial_collection_span    ( const financial_collection_t* collection, size_t first );
+size_t                __financial_collection_index   ( const financial_collection_t* collection, const financial_item_t* item );
+value_t               __financial_collection_sum     ( const financial_collection_t* collection );
+void                  __financial_collection_sort    ( financial_collection_t* collection, financial_item_sort_method_t method, uint32_t* tags );
+bool                  __financial_collection_permute ( financial_collection_t* collection, const size_t* order, uint32_t* tags );
+
+void    financial_item_collection_sort ( void* collection, size_t item_size, financial_item_sort_method_t method, uint32_t* tags );
+value_t financial_item_amount_sum      ( const void* collection, size_t item_size, size_t count );
 
 value_t financial_asset_collection_sum       ( const financial_asset_t* collection );
 value_t financial_liability_collection_sum   ( const financial_liability_t* collection );
@@ -0,0 +1,454 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#ifdef __ANDROID__
+#include <vector.h>
+#else
+#include <libcollections/vector.h>
+#endif
+#include "wealth.h"
+#include "lots.h"
+
+/* Heaps are rebuilt once they hold more closed lots than open ones, and at least this many. */
+#define LOTS_COMPACT_MIN     (64)
+
+/*
+ * Sales within this fraction of what a lot or the book holds take all of
+ * it, so rounding in the running totals never leaves dust lots behind.
+ */
+#define LOTS_EPSILON         (1e-9)
+
+/* FIFO, LIFO and HIFO each keep a heap of lot indices. */
+#define LOTS_HEAPS           (3)
+
+typedef struct lot_entry {
+	int32_t acquired;    /* days, see financial_date_to_days() */
+	int32_t long_term;   /* sales after this day are long term */
+	double  quantity;
+	double  cost_basis;
+	double  unit_cost;   /* cost per share when acquired */
+} lot_entry_t;
+
+/*
+ * Lots are stored by identifier. A sale only pops lots from the heap of
+ * the method used, so the other heaps may still hold closed lots; those
+ * are dropped when they reach the top.
+ */
+struct financial_lot_book {
+	lot_entry_t* lots;
+	uint32_t*    heaps[ LOTS_HEAPS ];
+	size_t       open_lots;
+	double       quantity[ 2 ];     /* sum and compensation, see lots_add() */
+	double       cost_basis[ 2 ];
+	double       realized_short_term;
+	double       realized_long_term;
+};
+
+/*
+ * Neumaier summation for the running totals. Tens of thousands of sales
+ * against a plain running sum drift far enough from what the lots hold
+ * that selling "everything" would leave dust behind.
+ */
+static inline void lots_add( double* total, double value )
+{
+	double sum = total[ 0 ] + value;
+
+	if( fabs( total[ 0 ] ) >= fabs( value ) )
+	{
+		total[ 1 ] += (total[ 0 ] - sum) + value;
+	}
+	else
+	{
+		total[ 1 ] += (value - sum) + total[ 0 ];
+	}
+
+	total[ 0 ] = sum;
+}
+
+static inline double lots_total( const double* total )
+{
+	return total[ 0 ] + total[ 1 ];
+}
+
+/* True when lot a is sold before lot b. */
+static inline bool lots_before( const lot_entry_t* lots, financial_lot_method_t method, uint32_t a, uint32_t b )
+{
+	const lot_entry_t* left  = &lots[ a ];
+	const lot_entry_t* right = &lots[ b ];
+	bool older = left->acquired != right->acquired ? left->acquired < right->acquired : a < b;
+
+	switch( method )
+	{
+		case FL_FIFO:
+			return older;
+		case FL_LIFO:
+			return !older;
+		case FL_HIFO:
+			return left->unit_cost != right->unit_cost ? left->unit_cost > right->unit_cost : older;
+		default:
+			assert( false );
+			return false;
+	}
+}
+
+static void lots_sift_up( const lot_entry_t* lots, financial_lot_method_t method, uint32_t* heap, size_t i )
+{
+	uint32_t lot = heap[ i ];
+
+	while( i > 0 )
+	{
+		size_t parent = (i - 1) / 2;
+		if( !lots_before( lots, method, lot, heap[ parent ] ) )
+		{
+			break;
+		}
+		heap[ i ] = heap[ parent ];
+		i = parent;
+	}
+
+	heap[ i ] = lot;
+}
+
+static void lots_sift_down( const lot_entry_t* lots, financial_lot_method_t method, uint32_t* heap, size_t count, size_t i )
+{
+	uint32_t lot = heap[ i ];
+
+	for( size_t child = 2 * i + 1; child < count; child = 2 * i + 1 )
+	{
+		if( child + 1 < count && lots_before( lots, method, heap[ child + 1 ], heap[ child ] ) )
+		{
+			child += 1;
+		}
+		if( !lots_before( lots, method, heap[ child ], lot ) )
+		{
+			break;
+		}
+		heap[ i ] = heap[ child ];
+		i = child;
+	}
+
+	heap[ i ] = lot;
+}
+
+static void lots_heap_pop( const lot_entry_t* lots, financial_lot_method_t method, uint32_t* heap )
+{
+	size_t count = vector_size( heap ) - 1;
+
+	heap[ 0 ] = heap[ count ];
+	vector_pop( heap );
+	if( count > 0 )
+	{
+		lots_sift_down( lots, method, heap, count, 0 );
+	}
+}
+
+/* Rebuilds a heap from the open lots alone. */
+static void lots_heap_compact( const lot_entry_t* lots, financial_lot_method_t method, uint32_t* heap )
+{
+	size_t count = 0;
+
+	for( size_t i = 0; i < vector_size( heap ); i++ )
+	{
+		if( lots[ heap[ i ] ].quantity > 0 )
+		{
+			heap[ count++ ] = heap[ i ];
+		}
+	}
+
+	while( vector_size( heap ) > count )
+	{
+		vector_pop( heap );
+	}
+
+	for( size_t i = count / 2; i-- > 0; )
+	{
+		lots_sift_down( lots, method, heap, count, i );
+	}
+}
+
+/* The next open lot for the method, dropping closed lots on the way. */
+static bool lots_heap_top( financial_lot_book_t* book, financial_lot_method_t method, uint32_t* lot )
+{
+	uint32_t* heap = book->heaps[ method ];
+
+	while( vector_size( heap ) > 0 )
+	{
+		if( book->lots[ heap[ 0 ] ].quantity > 0 )
+		{
+			*lot = heap[ 0 ];
+			return true;
+		}
+		lots_heap_pop( book->lots, method, heap );
+	}
+
+	return false;
+}
+
+financial_lot_book_t* financial_lot_book_create( void )
+{
+	financial_lot_book_t* book = malloc( sizeof(financial_lot_book_t) );
+
+	if( book )
+	{
+		vector_create( book->lots, 16 );
+		for( size_t h = 0; h < LOTS_HEAPS; h++ )
+		{
+			vector_create( book->heaps[ h ], 16 );
+		}
+		financial_lot_book_clear( book );
+	}
+
+	return book;
+}
+
+void financial_lot_book_destroy( financial_lot_book_t** p_book )
+{
+	if( p_book && *p_book )
+	{
+		vector_destroy( (*p_book)->lots );
+		for( size_t h = 0; h < LOTS_HEAPS; h++ )
+		{
+			vector_destroy( (*p_book)->heaps[ h ] );
+		}
+		free( *p_book );
+		*p_book = NULL;
+	}
+}
+
+void financial_lot_book_clear( financial_lot_book_t* book )
+{
+	assert( book );
+	vector_clear( book->lots );
+	for( size_t h = 0; h < LOTS_HEAPS; h++ )
+	{
+		vector_clear( book->heaps[ h ] );
+	}
+	book->open_lots           = 0;
+	book->quantity[ 0 ]       = 0.0;
+	book->quantity[ 1 ]       = 0.0;
+	book->cost_basis[ 0 ]     = 0.0;
+	book->cost_basis[ 1 ]     = 0.0;
+	book->realized_short_term = 0.0;
+	book->realized_long_term  = 0.0;
+}
+
+financial_lot_id_t financial_lot_book_acquire( financial_lot_book_t* book, financial_date_t date, double quantity, double cost )
+{
+	assert( book );
+	size_t index = vector_size( book->lots );
+
+	if( !(quantity >= 0) || !(cost >= 0) || !financial_date_valid( date ) || index >= UINT32_MAX - 1 )
+	{
+		return FL_LOT_NONE;
+	}
+
+	lot_entry_t lot = {
+		.acquired   = financial_date_to_days( date ),
+		.long_term  = financial_date_to_days( financial_date_add_months( date, 12 ) ),
+		.quantity   = quantity,
+		.cost_basis = cost,
+		.unit_cost  = quantity > 0 ? cost / quantity : 0.0
+	};
+
+	vector_push( book->lots, lot );
+
+	/* An empty lot is recorded for its identifier but never sold from. */
+	if( quantity > 0 )
+	{
+		for( size_t h = 0; h < LOTS_HEAPS; h++ )
+		{
+			vector_push( book->heaps[ h ], (uint32_t) index );
+			lots_sift_up( book->lots, (financial_lot_method_t) h, book->heaps[ h ], vector_size( book->heaps[ h ] ) - 1 );
+		}
+
+		book->open_lots += 1;
+		lots_add( book->quantity, quantity );
+		lots_add( book->cost_basis, cost );
+	}
+
+	return (financial_lot_id_t) (index + 1);
+}
+
+/* Sells up to quantity shares from one lot and returns how many were sold. */
+static double lots_take( financial_lot_book_t* book, uint32_t index, int32_t date, double quantity, double proceeds, financial_lot_disposal_t* disposal )
+{
+	lot_entry_t* lot = &book->lots[ index ];
+	double basis;
+
+	if( quantity >= lot->quantity * (1 - LOTS_EPSILON) )
+	{
+		quantity = lot->quantity;
+		basis    = lot->cost_basis;
+		lot->quantity   = 0.0;
+		lot->cost_basis = 0.0;
+		book->open_lots -= 1;
+	}
+	else
+	{
+		basis = lot->cost_basis * (quantity / lot->quantity);
+		lot->quantity   -= quantity;
+		lot->cost_basis -= basis;
+	}
+
+	double gain = proceeds - basis;
+
+	if( date > lot->long_term )
+	{
+		book->realized_long_term += gain;
+		disposal->long_term_gain += gain;
+	}
+	else
+	{
+		book->realized_short_term += gain;
+		disposal->short_term_gain += gain;
+	}
+
+	disposal->quantity   += quantity;
+	disposal->proceeds   += proceeds;
+	disposal->cost_basis += basis;
+
+	return quantity;
+}
+
+bool financial_lot_book_dispose( financial_lot_book_t* book, financial_date_t date, double quantity, double proceeds,
+                                 financial_lot_method_t method, financial_lot_id_t lot, financial_lot_disposal_t* disposal )
+{
+	assert( book );
+	financial_lot_disposal_t sold = { 0 };
+
+	if( !(quantity >= 0) || !isfinite( proceeds ) || !financial_date_valid( date ) )
+	{
+		return false;
+	}
+
+	int32_t day = financial_date_to_days( date );
+
+	if( method == FL_SPECIFIC )
+	{
+		if( lot == FL_LOT_NONE || lot > vector_size( book->lots ) || quantity > book->lots[ lot - 1 ].quantity * (1 + LOTS_EPSILON) )
+		{
+			return false;
+		}
+		if( quantity > 0 )
+		{
+			lots_take( book, lot - 1, day, quantity, proceeds, &sold );
+		}
+	}
+	else
+	{
+		assert( method < LOTS_HEAPS );
+		uint32_t* heap;
+		uint32_t next;
+		double remaining = quantity;
+		double unit_proceeds = quantity > 0 ? proceeds / quantity : 0.0;
+
+		if( quantity > lots_total( book->quantity ) * (1 + LOTS_EPSILON) )
+		{
+			return false;
+		}
+
+		while( remaining > 0 && lots_heap_top( book, method, &next ) )
+		{
+			double available = book->lots[ next ].quantity;
+			bool last = remaining <= available * (1 + LOTS_EPSILON);
+			double share = last ? proceeds - sold.proceeds : available * unit_proceeds;
+
+			remaining -= lots_take( book, next, day, last ? remaining : available, share, &sold );
+		}
+
+		/* Closed lots are dropped from the other heaps as they surface. */
+		for( size_t h = 0; h < LOTS_HEAPS; h++ )
+		{
+			heap = book->heaps[ h ];
+			if( vector_size( heap ) - book->open_lots > LOTS_COMPACT_MIN &&
+			    vector_size( heap ) - book->open_lots > book->open_lots )
+			{
+				lots_heap_compact( book->lots, (financial_lot_method_t) h, heap );
+			}
+		}
+	}
+
+	if( book->open_lots == 0 )
+	{
+		book->quantity[ 0 ]   = 0.0;
+		book->quantity[ 1 ]   = 0.0;
+		book->cost_basis[ 0 ] = 0.0;
+		book->cost_basis[ 1 ] = 0.0;
+	}
+	else
+	{
+		lots_add( book->quantity, -sold.quantity );
+		lots_add( book->cost_basis, -sold.cost_basis );
+	}
+
+	if( disposal )
+	{
+		*disposal = sold;
+	}
+
+	return true;
+}
+
+bool financial_lot_book_lot( const financial_lot_book_t* book, financial_lot_id_t id, financial_lot_t* lot )
+{
+	assert( book );
+	assert( lot );
+
+	if( id == FL_LOT_NONE || id > vector_size( book->lots ) || !(book->lots[ id - 1 ].quantity > 0) )
+	{
+		return false;
+	}
+
+	const lot_entry_t* entry = &book->lots[ id - 1 ];
+	lot->id         = id;
+	lot->acquired   = financial_date_from_days( entry->acquired );
+	lot->quantity   = entry->quantity;
+	lot->cost_basis = entry->cost_basis;
+	return true;
+}
+
+void financial_lot_book_totals( const financial_lot_book_t* book, financial_lot_totals_t* totals )
+{
+	assert( book );
+	assert( totals );
+	totals->open_lots           = book->open_lots;
+	totals->quantity            = lots_total( book->quantity );
+	totals->cost_basis          = lots_total( book->cost_basis );
+	totals->realized_short_term = book->realized_short_term;
+	totals->realized_long_term  = book->realized_long_term;
+}
+
+double financial_lot_book_unrealized_gain( const financial_lot_book_t* book, double price )
+{
+	assert( book );
+	return lots_total( book->quantity ) * price - lots_total( book->cost_basis );
+}
+
+void financial_lot_book_mark_asset( const financial_lot_book_t* book, double price, financial_asset_t* asset )
+{
+	assert( book );
+	assert( asset );
+	financial_item_set_amount( (financial_item_t*) asset, value_from_double( lots_total( book->quantity ) * price ) );
+}
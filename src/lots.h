@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _WEALTH_LOTS_H_
+#define _WEALTH_LOTS_H_
+#include "wealth.h"
+#include "calendar.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Tax Lots
+ *
+ * A lot book tracks the lots behind one equity holding: when each was
+ * acquired, how many shares remain and what they cost in total. Selling
+ * takes shares from lots in the order the method picks:
+ *
+ *   FL_FIFO      oldest lot first
+ *   FL_LIFO      newest lot first
+ *   FL_HIFO      highest cost per share first (oldest first on ties)
+ *   FL_SPECIFIC  only the named lot
+ *
+ * Each sale is O(log n) in the number of lots, and the open quantity,
+ * cost basis and realized gains are kept as running totals, so books with
+ * many small dividend reinvestment lots stay cheap. A gain is long term
+ * when the shares were held for more than a year.
+ *
+ * Lot identifiers are handed out from one and stay valid for the life of
+ * the book; a lot that has been sold in full is closed, not reused.
+ */
+struct financial_lot_book;
+typedef struct financial_lot_book financial_lot_book_t;
+typedef uint32_t financial_lot_id_t;
+
+#define FL_LOT_NONE     ((financial_lot_id_t) 0)
+
+typedef enum financial_lot_method {
+	FL_FIFO = 0,
+	FL_LIFO,
+	FL_HIFO,
+	FL_SPECIFIC
+} financial_lot_method_t;
+
+typedef struct financial_lot {
+	financial_lot_id_t id;
+	financial_date_t   acquired;
+	double             quantity;     /* shares remaining */
+	double             cost_basis;   /* cost of the remaining shares */
+} financial_lot_t;
+
+typedef struct financial_lot_disposal {
+	double quantity;
+	double proceeds;
+	double cost_basis;
+	double short_term_gain;
+	double long_term_gain;
+} financial_lot_disposal_t;
+
+typedef struct financial_lot_totals {
+	size_t open_lots;
+	double quantity;
+	double cost_basis;
+	double realized_short_term;
+	double realized_long_term;
+} financial_lot_totals_t;
+
+financial_lot_book_t* financial_lot_book_create   ( void );
+void                  financial_lot_book_destroy  ( financial_lot_book_t** book );
+void                  financial_lot_book_clear    ( financial_lot_book_t* book );
+
+/* Returns FL_LOT_NONE if the quantity or cost is negative or the date is invalid. */
+financial_lot_id_t    financial_lot_book_acquire  ( financial_lot_book_t* book, financial_date_t date, double quantity, double cost );
+
+/*
+ * Sells quantity shares for proceeds in total, splitting the proceeds
+ * across lots by quantity. lot is only used by FL_SPECIFIC. Fails without
+ * changing the book if there are not enough shares (in the named lot for
+ * FL_SPECIFIC). disposal may be NULL.
+ */
+bool                  financial_lot_book_dispose  ( financial_lot_book_t* book, financial_date_t date, double quantity, double proceeds,
+                                                    financial_lot_method_t method, financial_lot_id_t lot, financial_lot_disposal_t* disposal );
+
+bool                  financial_lot_book_lot      ( const financial_lot_book_t* book, financial_lot_id_t id, financial_lot_t* lot );
+void                  financial_lot_book_totals   ( const financial_lot_book_t* book, financial_lot_totals_t* totals );
+double                financial_lot_book_unrealized_gain( const financial_lot_book_t* book, double price );
+
+/* Sets the asset's amount to the market value of the open shares. */
+void                  financial_lot_book_mark_asset( const financial_lot_book_t* book, double price, financial_asset_t* asset );
+
+#ifdef __cplusplus
+} /* extern C Linkage */
+#endif
+#endif /* _WEALTH_LOTS_H_ */
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _FINANCIAL_PARALLEL_H_
+#define _FINANCIAL_PARALLEL_H_
+
+typedef void (*financial_task_fxn_t)( size_t task, size_t worker, void* data );
+
+/*
+ * Runs task( 0 .. count-1 ) across at most financial_thread_count() threads,
+ * the calling thread included. Tasks are handed out dynamically, so a task
+ * must not depend on which worker runs it; `worker` (0 .. workers-1) is only
+ * meant for indexing per-thread scratch space.
+ */
+size_t __financial_serial_threshold ( void );
+size_t __financial_parallel_workers ( size_t count );
+void   __financial_parallel_for     ( size_t count, financial_task_fxn_t task, void* data );
+
+#endif /* _FINANCIAL_PARALLEL_H_ */
@@ -0,0 +1,420 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include "wealth.h"
+#include "payoff.h"
+
+#define PAYOFF_EPSILON      (0.005) /* balances under half a cent are paid */
+#define PAYOFF_MAX_PASSES   (100)
+
+/*
+ * Debts are kept as parallel arrays. A simulation first copies them into
+ * the work arrays in payment order, so the month loop walks memory
+ * front to back and the extra payment always goes to the first open debt.
+ */
+struct financial_payoff_plan {
+	size_t  count;
+	double* balance;
+	double* rate;
+	double* minimum;
+	double* work_balance;
+	double* work_rate;
+	double* work_minimum;
+	size_t* current;   /* search scratch */
+	size_t* candidate;
+	size_t* counters;
+};
+
+typedef enum financial_payoff_outcome {
+	PAYOFF_INFEASIBLE = 0,
+	PAYOFF_FINISHED,
+	PAYOFF_PRUNED
+} financial_payoff_outcome_t;
+
+
+static financial_payoff_plan_t* financial_payoff_plan_alloc( size_t count )
+{
+	financial_payoff_plan_t* plan = malloc( sizeof(financial_payoff_plan_t) );
+
+	if( plan )
+	{
+		size_t n = count ? count : 1;
+		double* values  = malloc( 6 * n * sizeof(double) );
+		size_t* indices = malloc( 3 * n * sizeof(size_t) );
+
+		if( !values || !indices )
+		{
+			free( values );
+			free( indices );
+			free( plan );
+			return NULL;
+		}
+
+		plan->count        = count;
+		plan->balance      = values;
+		plan->rate         = values + n;
+		plan->minimum      = values + 2 * n;
+		plan->work_balance = values + 3 * n;
+		plan->work_rate    = values + 4 * n;
+		plan->work_minimum = values + 5 * n;
+		plan->current      = indices;
+		plan->candidate    = indices + n;
+		plan->counters     = indices + 2 * n;
+	}
+
+	return plan;
+}
+
+financial_payoff_plan_t* financial_payoff_plan_create( const financial_debt_t* debts, size_t count )
+{
+	assert( debts || count == 0 );
+	financial_payoff_plan_t* plan = financial_payoff_plan_alloc( count );
+
+	if( plan )
+	{
+		for( size_t i = 0; i < count; i++ )
+		{
+			plan->balance[ i ] = debts[ i ].balance;
+			plan->rate[ i ]    = debts[ i ].rate;
+			plan->minimum[ i ] = debts[ i ].minimum;
+		}
+	}
+
+	return plan;
+}
+
+financial_payoff_plan_t* financial_payoff_plan_from_profile( const financial_profile_t* profile, const double* rates, const double* minimums )
+{
+	assert( profile );
+	size_t count = financial_profile_item_count( profile, FI_LIABILITY );
+	assert( rates || count == 0 );
+	assert( minimums || count == 0 );
+	financial_payoff_plan_t* plan = financial_payoff_plan_alloc( count );
+
+	if( plan )
+	{
+		financial_item_const_span_t span;
+		financial_currency_t currency = FC_NONE;
+		double fx = 1.0;
+
+		for( size_t first = 0; first < count; first += span.count )
+		{
+			span = financial_profile_item_const_span( profile, FI_LIABILITY, first );
+
+			for( size_t i = 0; i < span.count; i++ )
+			{
+				const financial_item_t* item = financial_item_const_span_at( span, i );
+
+				/* Balances are paid from a budget in the profile's currency; one without a rate counts as it. */
+				if( financial_item_currency( item ) != currency )
+				{
+					currency = financial_item_currency( item );
+					if( !financial_profile_fx_rate( profile, currency, &fx ) )
+					{
+						fx = 1.0;
+					}
+				}
+
+				plan->balance[ first + i ] = value_to_double( financial_item_amount( item ) ) * fx;
+				plan->rate[ first + i ]    = rates[ first + i ];
+				plan->minimum[ first + i ] = minimums[ first + i ];
+			}
+		}
+	}
+
+	return plan;
+}
+
+void financial_payoff_plan_destroy( financial_payoff_plan_t** p_plan )
+{
+	if( p_plan && *p_plan )
+	{
+		free( (*p_plan)->balance );
+		free( (*p_plan)->current );
+		free( *p_plan );
+		*p_plan = NULL;
+	}
+}
+
+size_t financial_payoff_plan_count( const financial_payoff_plan_t* plan )
+{
+	assert( plan );
+	return plan->count;
+}
+
+static bool financial_payoff_precedes( const financial_payoff_plan_t* plan, financial_payoff_strategy_t strategy, size_t a, size_t b )
+{
+	if( strategy == FPS_AVALANCHE && plan->rate[ a ] != plan->rate[ b ] )
+	{
+		return plan->rate[ a ] > plan->rate[ b ];
+	}
+	else if( plan->balance[ a ] != plan->balance[ b ] )
+	{
+		return plan->balance[ a ] < plan->balance[ b ];
+	}
+
+	return a < b;
+}
+
+void financial_payoff_order( const financial_payoff_plan_t* plan, financial_payoff_strategy_t strategy, size_t* order )
+{
+	assert( plan );
+	assert( order || plan->count == 0 );
+
+	/* Insertion sort; plans hold a few dozen debts at most. */
+	for( size_t i = 0; i < plan->count; i++ )
+	{
+		size_t j = i;
+		while( j > 0 && financial_payoff_precedes( plan, strategy, i, order[ j - 1 ] ) )
+		{
+			order[ j ] = order[ j - 1 ];
+			j -= 1;
+		}
+		order[ j ] = i;
+	}
+}
+
+static financial_payoff_outcome_t financial_payoff_run( financial_payoff_plan_t* plan, const size_t* order, double budget, size_t max_months, double bound, financial_payoff_result_t* result, size_t* months_paid )
+{
+	const size_t n   = plan->count;
+	double* balance  = plan->work_balance;
+	double* rate     = plan->work_rate;
+	double* minimum  = plan->work_minimum;
+	double interest  = 0;
+	size_t open      = 0;
+	size_t first     = 0;
+	size_t month     = 0;
+
+	for( size_t k = 0; k < n; k++ )
+	{
+		size_t i = order[ k ];
+		balance[ k ] = plan->balance[ i ] > PAYOFF_EPSILON ? plan->balance[ i ] : 0;
+		rate[ k ]    = plan->rate[ i ];
+		minimum[ k ] = plan->minimum[ i ];
+		open += balance[ k ] > 0;
+		if( months_paid ) months_paid[ i ] = 0;
+	}
+
+	while( open > 0 && month < max_months )
+	{
+		double remaining = budget;
+		month += 1;
+
+		for( size_t k = first; k < n; k++ )
+		{
+			double b = balance[ k ];
+			if( b > 0 )
+			{
+				double accrued = b * rate[ k ];
+				double owed    = b + accrued;
+				double payment = minimum[ k ] < owed ? minimum[ k ] : owed;
+
+				interest    += accrued;
+				remaining   -= payment;
+				balance[ k ] = owed - payment;
+
+				if( balance[ k ] <= PAYOFF_EPSILON )
+				{
+					balance[ k ] = 0;
+					open -= 1;
+					if( months_paid ) months_paid[ order[ k ] ] = month;
+				}
+			}
+		}
+
+		if( remaining < -PAYOFF_EPSILON )
+		{
+			result->interest = interest;
+			result->months   = month;
+			result->paid_off = false;
+			return PAYOFF_INFEASIBLE;
+		}
+
+		for( size_t k = first; k < n && remaining > PAYOFF_EPSILON; k++ )
+		{
+			double b = balance[ k ];
+			if( b > 0 )
+			{
+				double payment = remaining < b ? remaining : b;
+				remaining   -= payment;
+				balance[ k ] = b - payment;
+
+				if( balance[ k ] <= PAYOFF_EPSILON )
+				{
+					balance[ k ] = 0;
+					open -= 1;
+					if( months_paid ) months_paid[ order[ k ] ] = month;
+				}
+			}
+		}
+
+		while( first < n && balance[ first ] == 0 )
+		{
+			first += 1;
+		}
+
+		if( interest > bound )
+		{
+			result->interest = interest;
+			result->months   = month;
+			result->paid_off = false;
+			return PAYOFF_PRUNED;
+		}
+	}
+
+	result->interest = interest;
+	result->months   = month;
+	result->paid_off = open == 0;
+	return PAYOFF_FINISHED;
+}
+
+bool financial_payoff_simulate( financial_payoff_plan_t* plan, const size_t* order, double budget, size_t max_months, financial_payoff_result_t* result, size_t* months_paid )
+{
+	assert( plan );
+	assert( order || plan->count == 0 );
+	assert( result );
+	return financial_payoff_run( plan, order, budget, max_months, INFINITY, result, months_paid ) != PAYOFF_INFEASIBLE;
+}
+
+static bool financial_payoff_better( const financial_payoff_result_t* a, const financial_payoff_result_t* b )
+{
+	if( a->paid_off != b->paid_off )
+	{
+		return a->paid_off;
+	}
+	else if( fabs( a->interest - b->interest ) > PAYOFF_EPSILON )
+	{
+		return a->interest < b->interest;
+	}
+
+	return a->months < b->months;
+}
+
+/* Simulates the candidate order and adopts it if it beats the best so far. */
+static bool financial_payoff_try( financial_payoff_plan_t* plan, const size_t* candidate, double budget, size_t max_months, size_t* best, financial_payoff_result_t* best_result )
+{
+	financial_payoff_result_t result;
+	double bound = best_result->paid_off ? best_result->interest + PAYOFF_EPSILON : INFINITY;
+
+	if( financial_payoff_run( plan, candidate, budget, max_months, bound, &result, NULL ) == PAYOFF_FINISHED &&
+	    financial_payoff_better( &result, best_result ) )
+	{
+		memcpy( best, candidate, plan->count * sizeof(size_t) );
+		*best_result = result;
+		return true;
+	}
+
+	return false;
+}
+
+bool financial_payoff_optimize( financial_payoff_plan_t* plan, double budget, size_t max_months, size_t* order, financial_payoff_result_t* result )
+{
+	assert( plan );
+	assert( order || plan->count == 0 );
+	assert( result );
+	const size_t n = plan->count;
+	size_t* candidate = plan->candidate;
+	financial_payoff_result_t avalanche;
+
+	financial_payoff_order( plan, FPS_SNOWBALL, order );
+	if( financial_payoff_run( plan, order, budget, max_months, INFINITY, result, NULL ) == PAYOFF_INFEASIBLE )
+	{
+		return false;
+	}
+
+	financial_payoff_order( plan, FPS_AVALANCHE, candidate );
+	financial_payoff_run( plan, candidate, budget, max_months, INFINITY, &avalanche, NULL );
+	if( financial_payoff_better( &avalanche, result ) )
+	{
+		memcpy( order, candidate, n * sizeof(size_t) );
+		*result = avalanche;
+	}
+
+	if( n <= FINANCIAL_PAYOFF_EXHAUSTIVE )
+	{
+		/* Heap's algorithm, starting from the best order so far. */
+		size_t* c = plan->counters;
+		memcpy( candidate, order, n * sizeof(size_t) );
+		memset( c, 0, n * sizeof(size_t) );
+
+		for( size_t i = 1; i < n; )
+		{
+			if( c[ i ] < i )
+			{
+				size_t j   = (i & 1) ? c[ i ] : 0;
+				size_t tmp = candidate[ j ];
+				candidate[ j ] = candidate[ i ];
+				candidate[ i ] = tmp;
+
+				financial_payoff_try( plan, candidate, budget, max_months, order, result );
+
+				c[ i ] += 1;
+				i = 1;
+			}
+			else
+			{
+				c[ i ] = 0;
+				i += 1;
+			}
+		}
+	}
+	else
+	{
+		/* Move one debt to another position while that improves the plan. */
+		size_t* current = plan->current;
+		bool improved = true;
+
+		for( size_t pass = 0; improved && pass < PAYOFF_MAX_PASSES; pass++ )
+		{
+			improved = false;
+			memcpy( current, order, n * sizeof(size_t) );
+
+			for( size_t from = 0; from < n; from++ )
+			{
+				for( size_t to = 0; to < n; to++ )
+				{
+					if( from == to ) continue;
+
+					size_t moved = current[ from ];
+					size_t k = 0;
+					for( size_t i = 0; i < n; i++ )
+					{
+						if( i == from ) continue;
+						if( k == to ) candidate[ k++ ] = moved;
+						candidate[ k++ ] = current[ i ];
+					}
+					if( k == to ) candidate[ k ] = moved;
+
+					if( financial_payoff_try( plan, candidate, budget, max_months, order, result ) )
+					{
+						improved = true;
+					}
+				}
+			}
+		}
+	}
+
+	return true;
+}
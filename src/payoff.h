@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _WEALTH_PAYOFF_H_
+#define _WEALTH_PAYOFF_H_
+#include "wealth.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Debt payoff planning
+ *
+ * A plan holds the debts being paid down. Every month each open debt accrues
+ * interest at its periodic rate and receives its minimum payment; whatever
+ * is left of the monthly budget goes to the debts in priority order. Money
+ * freed by a paid-off debt rolls into the next one.
+ *
+ * Liabilities do not record a rate or a minimum payment, so those are
+ * supplied alongside them, indexed like the profile's liabilities. Their
+ * balances are converted to the profile's currency, which the minimums and
+ * the budget are in too.
+ *
+ * A plan keeps its own scratch space, so one plan must not be simulated from
+ * several threads at once; create a plan per thread instead.
+ */
+typedef struct financial_debt {
+	double balance;
+	double rate;     /* periodic (monthly) interest rate */
+	double minimum;  /* minimum monthly payment */
+} financial_debt_t;
+
+typedef enum financial_payoff_strategy {
+	FPS_SNOWBALL = 0, /* smallest balance first */
+	FPS_AVALANCHE     /* highest rate first */
+} financial_payoff_strategy_t;
+
+typedef struct financial_payoff_result {
+	double interest;  /* total interest paid */
+	size_t months;    /* months until every debt is paid */
+	bool   paid_off;  /* false if the budget never clears the debts */
+} financial_payoff_result_t;
+
+struct financial_payoff_plan;
+typedef struct financial_payoff_plan financial_payoff_plan_t;
+
+financial_payoff_plan_t* financial_payoff_plan_create       ( const financial_debt_t* debts, size_t count );
+financial_payoff_plan_t* financial_payoff_plan_from_profile ( const financial_profile_t* profile, const double* rates, const double* minimums );
+void                     financial_payoff_plan_destroy      ( financial_payoff_plan_t** plan );
+size_t                   financial_payoff_plan_count        ( const financial_payoff_plan_t* plan );
+
+/*
+ * Fills order with the debt indices in the order the strategy pays them.
+ */
+void financial_payoff_order    ( const financial_payoff_plan_t* plan, financial_payoff_strategy_t strategy, size_t* order );
+
+/*
+ * Simulates paying the debts in the given order for at most max_months.
+ * months_paid, if not NULL, receives the month each debt was cleared (0 if
+ * it never was). Returns false if the budget does not cover the minimum
+ * payments.
+ */
+bool financial_payoff_simulate ( financial_payoff_plan_t* plan, const size_t* order, double budget, size_t max_months, financial_payoff_result_t* result, size_t* months_paid );
+
+/*
+ * Searches for the order that pays the least interest. Up to
+ * FINANCIAL_PAYOFF_EXHAUSTIVE debts every permutation is tried; beyond that
+ * the better of snowball and avalanche is improved by moving single debts
+ * until no move helps. Simulations that are already worse than the best
+ * order found are cut short.
+ */
+#define FINANCIAL_PAYOFF_EXHAUSTIVE  (8)
+
+bool financial_payoff_optimize ( financial_payoff_plan_t* plan, double budget, size_t max_months, size_t* order, financial_payoff_result_t* result );
+
+#ifdef __cplusplus
+} /* extern C Linkage */
+#endif
+#endif /* _WEALTH_PAYOFF_H_ */
@@ -0,0 +1,469 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <assert.h>
+#ifdef __ANDROID__
+#include <vector.h>
+#else
+#include <libcollections/vector.h>
+#endif
+#include "wealth.h"
+#include "prices.h"
+#include "item.h"
+#include "profile.h"
+#include "parallel.h"
+
+/* Profiles handed to a worker at a time by the batch revaluation. */
+#define PRICES_BLOCK          (16)
+
+/* Longest line accepted in a price file. */
+#define PRICES_LINE_SIZE      (256)
+
+typedef struct price_entry {
+	financial_symbol_t symbol;   /* zero padded; empty when the slot is free */
+	double             price;
+} price_entry_t;
+
+/* Open addressing with linear probing, kept at most 3/4 full. */
+struct financial_price_table {
+	price_entry_t* entries;
+	size_t         capacity;  /* a power of two */
+	size_t         count;
+};
+
+
+/* Copies a symbol into a zero padded key; fails if it is empty or too long. */
+static inline bool prices_key( const char* symbol, financial_symbol_t key )
+{
+	size_t length = 0;
+
+	while( length < FINANCIAL_SYMBOL_SIZE && symbol[ length ] )
+	{
+		length += 1;
+	}
+
+	if( length == 0 || length >= FINANCIAL_SYMBOL_SIZE )
+	{
+		return false;
+	}
+
+	memset( key, 0, FINANCIAL_SYMBOL_SIZE );
+	memcpy( key, symbol, length );
+	return true;
+}
+
+static inline size_t prices_hash( const financial_symbol_t key )
+{
+	uint64_t words[ 2 ];
+	memcpy( words, key, sizeof(words) );
+
+	uint64_t h = words[ 0 ] ^ (words[ 1 ] * 0x9e3779b97f4a7c15ULL);
+	h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ULL; /* splitmix64 finalizer */
+	h ^= h >> 27; h *= 0x94d049bb133111ebULL;
+	h ^= h >> 31;
+	return (size_t) h;
+}
+
+static price_entry_t* prices_find( const financial_price_table_t* table, const financial_symbol_t key )
+{
+	size_t mask = table->capacity - 1;
+
+	for( size_t slot = prices_hash( key ) & mask; ; slot = (slot + 1) & mask )
+	{
+		price_entry_t* entry = &table->entries[ slot ];
+
+		if( entry->symbol[ 0 ] == '\0' || memcmp( entry->symbol, key, FINANCIAL_SYMBOL_SIZE ) == 0 )
+		{
+			return entry;
+		}
+	}
+}
+
+static bool prices_grow( financial_price_table_t* table )
+{
+	size_t capacity = table->capacity * 2;
+	price_entry_t* entries = calloc( capacity, sizeof(price_entry_t) );
+
+	if( !entries )
+	{
+		return false;
+	}
+
+	price_entry_t* old = table->entries;
+	size_t old_capacity = table->capacity;
+
+	table->entries  = entries;
+	table->capacity = capacity;
+
+	for( size_t i = 0; i < old_capacity; i++ )
+	{
+		if( old[ i ].symbol[ 0 ] != '\0' )
+		{
+			*prices_find( table, old[ i ].symbol ) = old[ i ];
+		}
+	}
+
+	free( old );
+	return true;
+}
+
+financial_price_table_t* financial_price_table_create( size_t capacity )
+{
+	financial_price_table_t* table = malloc( sizeof(financial_price_table_t) );
+
+	if( table )
+	{
+		size_t slots = 16;
+
+		while( slots / 4 * 3 < capacity )
+		{
+			slots *= 2;
+		}
+
+		table->entries  = calloc( slots, sizeof(price_entry_t) );
+		table->capacity = slots;
+		table->count    = 0;
+
+		if( !table->entries )
+		{
+			free( table );
+			table = NULL;
+		}
+	}
+
+	return table;
+}
+
+void financial_price_table_destroy( financial_price_table_t** p_table )
+{
+	if( p_table && *p_table )
+	{
+		free( (*p_table)->entries );
+		free( *p_table );
+		*p_table = NULL;
+	}
+}
+
+size_t financial_price_table_count( const financial_price_table_t* table )
+{
+	assert( table );
+	return table->count;
+}
+
+bool financial_price_table_set( financial_price_table_t* table, const char* symbol, double price )
+{
+	assert( table );
+	assert( symbol );
+	financial_symbol_t key;
+
+	if( !prices_key( symbol, key ) )
+	{
+		return false;
+	}
+
+	if( (table->count + 1) > table->capacity / 4 * 3 && !prices_grow( table ) )
+	{
+		return false;
+	}
+
+	price_entry_t* entry = prices_find( table, key );
+
+	if( entry->symbol[ 0 ] == '\0' )
+	{
+		memcpy( entry->symbol, key, FINANCIAL_SYMBOL_SIZE );
+		table->count += 1;
+	}
+
+	entry->price = price;
+	return true;
+}
+
+bool financial_price_table_get( const financial_price_table_t* table, const char* symbol, double* price )
+{
+	assert( table );
+	assert( symbol );
+	financial_symbol_t key;
+
+	if( !prices_key( symbol, key ) )
+	{
+		return false;
+	}
+
+	const price_entry_t* entry = prices_find( table, key );
+
+	if( entry->symbol[ 0 ] == '\0' )
+	{
+		return false;
+	}
+
+	if( price ) *price = entry->price;
+	return true;
+}
+
+/* Splits a line into a symbol and a price; returns false if it is not one. */
+static bool prices_parse_line( char* line, const char** symbol, double* price )
+{
+	char* s = line;
+	char* end;
+
+	while( isspace( (unsigned char) *s ) ) s++;
+	*symbol = s;
+	while( *s && *s != ',' && !isspace( (unsigned char) *s ) ) s++;
+
+	if( *s == '\0' || s == *symbol )
+	{
+		return false;
+	}
+
+	*s++ = '\0';
+	while( isspace( (unsigned char) *s ) || *s == ',' ) s++;
+
+	*price = strtod( s, &end );
+	if( end == s || !isfinite( *price ) )
+	{
+		return false;
+	}
+
+	while( isspace( (unsigned char) *end ) ) end++;
+	return *end == '\0';
+}
+
+financial_price_table_t* financial_price_table_load( const char* filename )
+{
+	assert( filename );
+	financial_price_table_t* table = NULL;
+	FILE* file = fopen( filename, "r" );
+	char line[ PRICES_LINE_SIZE ];
+	size_t number = 0;
+
+	if( !file )
+	{
+		goto done;
+	}
+
+	table = financial_price_table_create( 0 );
+
+	while( table && fgets( line, sizeof(line), file ) )
+	{
+		const char* symbol;
+		double price;
+		size_t length = strlen( line );
+		const char* s = line;
+
+		number += 1;
+
+		if( length == sizeof(line) - 1 && line[ length - 1 ] != '\n' && !feof( file ) )
+		{
+			financial_price_table_destroy( &table );
+			break;
+		}
+
+		while( isspace( (unsigned char) *s ) ) s++;
+		if( *s == '\0' || *s == '#' )
+		{
+			continue;
+		}
+
+		if( !prices_parse_line( line, &symbol, &price ) )
+		{
+			/* The first line may be a header. */
+			if( number > 1 )
+			{
+				financial_price_table_destroy( &table );
+			}
+		}
+		else if( !financial_price_table_set( table, symbol, price ) )
+		{
+			financial_price_table_destroy( &table );
+		}
+	}
+
+	if( table && ferror( file ) )
+	{
+		financial_price_table_destroy( &table );
+	}
+
+	fclose( file );
+
+done:
+	return table;
+}
+
+/* Returns the positions priced; flags is set if any amount changed. */
+static size_t prices_revalue( financial_profile_t* profile, const financial_position_t* positions, size_t count, const financial_price_table_t* prices, flags_t* flags )
+{
+	value_t delta = 0;
+	size_t priced = 0;
+	bool changed  = false;
+
+	for( size_t i = 0; i < count; i++ )
+	{
+		const financial_position_t* position = &positions[ i ];
+		size_t index = financial_profile_item_handle_index( profile, FI_ASSET, position->asset );
+		double price;
+
+		if( index == SIZE_MAX || !financial_price_table_get( prices, position->symbol, &price ) )
+		{
+			continue;
+		}
+
+		value_t amount = value_from_double( position->quantity * price );
+
+		if( __financial_collection_at( &profile->items[ FI_ASSET ], index )->amount != amount )
+		{
+			/* Forks keep sharing a chunk of assets until an amount in it actually moves. */
+			financial_item_t* asset = __financial_collection_write( &profile->items[ FI_ASSET ], index );
+
+			if( !asset )
+			{
+				continue;
+			}
+
+			delta += amount - asset->amount;
+			asset->amount = amount;
+			changed = true;
+		}
+
+		priced += 1;
+	}
+
+	*flags = 0;
+
+	if( changed )
+	{
+		/*
+		 * A dirty collection is rescanned by the next refresh anyway, as
+		 * are assets converted per currency, whose subtotals moved.
+		 */
+		if( profile->rates )
+		{
+			profile->flags |= FP_FLAG_ASSETS_DIRTY;
+		}
+		else if( !(profile->flags & FP_FLAG_ASSETS_DIRTY) )
+		{
+			profile->total_assets += delta;
+
+			if( !(profile->flags & FP_FLAG_LIABILITIES_DIRTY) )
+			{
+				profile->net_worth = profile->total_assets - profile->total_liabilities;
+			}
+		}
+
+		*flags = FP_FLAG_ASSETS_DIRTY;
+	}
+
+	return priced;
+}
+
+size_t financial_profile_revalue( financial_profile_t* profile, const financial_position_t* positions, size_t count, const financial_price_table_t* prices )
+{
+	assert( profile );
+	assert( positions || count == 0 );
+	assert( prices );
+	flags_t flags;
+	size_t priced = prices_revalue( profile, positions, count, prices, &flags );
+
+	__financial_profile_updated( profile, flags );
+	return priced;
+}
+
+typedef struct prices_batch_job {
+	financial_profile_t* const* profiles;
+	const financial_position_t* const* positions;
+	const size_t* counts;
+	size_t profile_count;
+	const financial_price_table_t* prices;
+	flags_t* flags;   /* per profile */
+	size_t* priced;   /* per block */
+} prices_batch_job_t;
+
+static void prices_batch_task( size_t block, size_t worker, void* data )
+{
+	prices_batch_job_t* job = data;
+	size_t first = block * PRICES_BLOCK;
+	size_t last  = first + PRICES_BLOCK < job->profile_count ? first + PRICES_BLOCK : job->profile_count;
+	size_t priced = 0;
+
+	for( size_t i = first; i < last; i++ )
+	{
+		priced += prices_revalue( job->profiles[ i ], job->positions[ i ], job->counts[ i ], job->prices, &job->flags[ i ] );
+	}
+
+	job->priced[ block ] = priced;
+}
+
+size_t financial_profiles_revalue( financial_profile_t* const* profiles, const financial_position_t* const* positions, const size_t* counts,
+                                   size_t profile_count, const financial_price_table_t* prices )
+{
+	assert( profiles || profile_count == 0 );
+	assert( positions || profile_count == 0 );
+	assert( counts || profile_count == 0 );
+	assert( prices );
+	size_t blocks = (profile_count + PRICES_BLOCK - 1) / PRICES_BLOCK;
+	size_t priced = 0;
+	prices_batch_job_t job = {
+		.profiles      = profiles,
+		.positions     = positions,
+		.counts        = counts,
+		.profile_count = profile_count,
+		.prices        = prices,
+		.flags         = NULL,
+		.priced        = NULL
+	};
+
+	if( blocks > 1 && __financial_parallel_workers( blocks ) > 1 )
+	{
+		job.flags  = malloc( profile_count * sizeof(flags_t) );
+		job.priced = malloc( blocks * sizeof(size_t) );
+	}
+
+	if( job.flags && job.priced )
+	{
+		__financial_parallel_for( blocks, prices_batch_task, &job );
+
+		for( size_t b = 0; b < blocks; b++ )
+		{
+			priced += job.priced[ b ];
+		}
+
+		/* Listeners are only ever called from the calling thread. */
+		for( size_t i = 0; i < profile_count; i++ )
+		{
+			__financial_profile_updated( profiles[ i ], job.flags[ i ] );
+		}
+	}
+	else
+	{
+		for( size_t i = 0; i < profile_count; i++ )
+		{
+			priced += financial_profile_revalue( profiles[ i ], positions[ i ], counts[ i ], prices );
+		}
+	}
+
+	free( job.flags );
+	free( job.priced );
+	return priced;
+}
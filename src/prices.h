@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _WEALTH_PRICES_H_
+#define _WEALTH_PRICES_H_
+#include "wealth.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Price Tables
+ *
+ * A price table maps ticker symbols (up to 15 characters, case sensitive)
+ * to prices. financial_price_table_load() reads a text file with one
+ * symbol and price per line, separated by a comma or whitespace. Blank
+ * lines and lines starting with '#' are skipped, as is a header on the
+ * first line. Any other line that does not parse fails the load.
+ */
+#define FINANCIAL_SYMBOL_SIZE         (16)
+
+typedef char financial_symbol_t[ FINANCIAL_SYMBOL_SIZE ];
+
+struct financial_price_table;
+typedef struct financial_price_table financial_price_table_t;
+
+financial_price_table_t* financial_price_table_create ( size_t capacity );
+financial_price_table_t* financial_price_table_load   ( const char* filename );
+void                     financial_price_table_destroy( financial_price_table_t** table );
+size_t                   financial_price_table_count  ( const financial_price_table_t* table );
+bool                     financial_price_table_set    ( financial_price_table_t* table, const char* symbol, double price );
+bool                     financial_price_table_get    ( const financial_price_table_t* table, const char* symbol, double* price );
+
+/*
+ * Revaluation
+ *
+ * A position ties an asset (by its handle, see financial_profile_item_handle())
+ * to a quantity of a symbol. Revaluing sets each asset whose symbol has a
+ * price to quantity * price. Only amounts that change are written, and
+ * the profile's totals are adjusted once for the whole set instead of
+ * being rescanned. Positions whose handle is stale or whose symbol has no
+ * price are left alone. Both return the number of positions priced.
+ *
+ * financial_profiles_revalue() revalues many profiles on the library's
+ * worker threads (see financial_set_parallelism()), one positions array
+ * per profile. Update listeners are called on the calling thread after
+ * all profiles are done.
+ */
+typedef struct financial_position {
+	financial_item_handle_t asset;
+	financial_symbol_t      symbol;
+	double                  quantity;
+} financial_position_t;
+
+size_t financial_profile_revalue ( financial_profile_t* profile, const financial_position_t* positions, size_t count, const financial_price_table_t* prices );
+size_t financial_profiles_revalue( financial_profile_t* const* profiles, const financial_position_t* const* positions, const size_t* counts,
+                                   size_t profile_count, const financial_price_table_t* prices );
+
+#ifdef __cplusplus
+} /* extern C Linkage */
+#endif
+#endif /* _WEALTH_PRICES_H_ */
@@ -19,11 +19,13 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  * THE SOFTWARE.
  */
+#define _POSIX_C_SOURCE 200809L
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <time.h>
 #include <math.h>
+#include <assert.h>
 #define VECTOR_GROW_AMOUNT(array)      (1)
 #ifdef __ANDROID__
 #include <vector.h>
@@ -32,48 +34,33 @@
 #endif
 #include "wealth.h"
 #include "item.h"
+#include "stats.h"
+#include "events.h"
+#include "handle.h"
+#include "profile.h"
 
 
 
-static financial_item_t* __financial_profile_item_add ( financial_profile_t* profile, financial_item_type_t type );
-
-
-struct financial_profile {
-
-	financial_asset_t* assets;
-	financial_liability_t* liabilities;
-	financial_expense_t* expenses; /* monthly */
-
-	value_t  total_assets;
-	value_t  total_liabilities;
-	value_t  total_expenses;
-	value_t  monthly_income;
-	value_t  disposable_income;
-	value_t  net_worth;
-	value_t  goal;
-	flags_t  flags;
-	uint16_t credit_score;
-	uint32_t credit_score_updated;
-	uint32_t last_updated;
-
-	financial_profile_updated_fxn_t on_updated;
-	void* user_data;
-};
-
-
 financial_profile_t* financial_profile_create( void )
 {
 	financial_profile_t* profile = malloc( sizeof(financial_profile_t) );
 
 	if( profile )
 	{
-		vector_create( profile->assets, 10 );
-		vector_create( profile->liabilities, 10 );
-		vector_create( profile->expenses, 10 );
+		__financial_collection_init( &profile->items[ FI_ASSET ], sizeof(financial_asset_t) );
+		__financial_collection_init( &profile->items[ FI_LIABILITY ], sizeof(financial_liability_t) );
+		__financial_collection_init( &profile->items[ FI_MONTHLY_EXPENSE ], sizeof(financial_expense_t) );
+		profile->handles[ FI_ASSET ]           = NULL;
+		profile->handles[ FI_LIABILITY ]       = NULL;
+		profile->handles[ FI_MONTHLY_EXPENSE ] = NULL;
+		profile->rates                         = NULL;
 
 		financial_profile_clear( profile );
-		profile->on_updated = NULL;
-		profile->user_data  = NULL;
+		profile->on_updated    = NULL;
+		profile->user_data     = NULL;
+		profile->subscriptions = NULL;
+		profile->batch_depth   = 0;
+		profile->batch_flags   = 0;
 	}
 
 	return profile;
@@ -85,17 +72,106 @@ void financial_profile_destroy( financial_profile_t** p_profile )
 	{
 		financial_profile_t* profile = *p_profile;
 
-		vector_destroy( profile->assets );
-		vector_destroy( profile->liabilities );
-		vector_destroy( profile->expenses );
+		__financial_collection_destroy( &profile->items[ FI_ASSET ] );
+		__financial_collection_destroy( &profile->items[ FI_LIABILITY ] );
+		__financial_collection_destroy( &profile->items[ FI_MONTHLY_EXPENSE ] );
+		__financial_handles_destroy( &profile->handles[ FI_ASSET ] );
+		__financial_handles_destroy( &profile->handles[ FI_LIABILITY ] );
+		__financial_handles_destroy( &profile->handles[ FI_MONTHLY_EXPENSE ] );
+		__financial_subscriptions_destroy( &profile->subscriptions );
+		__financial_currency_copy( profile, NULL );
 
 		free( profile );
 		*p_profile = NULL;
 	}
 }
 
+/*
+ * A fork shares every chunk of its parent's items (see item.h), and each
+ * side copies a chunk the first time it writes to it.
+ */
+financial_profile_t* financial_profile_fork( financial_profile_t* parent )
+{
+	assert( parent );
+	financial_profile_t* profile = malloc( sizeof(financial_profile_t) );
 
-static const uint8_t IDENTIFIER[] = { 'F', 'P', '\0', '\0' };
+	if( profile )
+	{
+		*profile = *parent;
+
+		for( int type = FI_ASSET; type <= FI_MONTHLY_EXPENSE; type++ )
+		{
+			if( !__financial_collection_share( &profile->items[ type ], &parent->items[ type ] ) )
+			{
+				while( --type >= FI_ASSET )
+				{
+					__financial_collection_destroy( &profile->items[ type ] );
+				}
+				goto failed;
+			}
+		}
+
+		profile->handles[ FI_ASSET ]           = NULL;
+		profile->handles[ FI_LIABILITY ]       = NULL;
+		profile->handles[ FI_MONTHLY_EXPENSE ] = NULL;
+		profile->rates                         = NULL;
+		__financial_currency_copy( profile, parent->rates );
+		profile->on_updated    = NULL;
+		profile->user_data     = NULL;
+		profile->subscriptions = NULL;
+		profile->batch_depth   = 0;
+		profile->batch_flags   = 0;
+	}
+
+	return profile;
+
+failed:
+	free( profile );
+	return NULL;
+}
+
+
+/*
+ * The third identifier byte records how amounts are stored. Double builds
+ * write the original format; fixed point builds mark the file and follow
+ * the header with the money scale. Either build converts on load.
+ *
+ * The fourth byte is the layout. Items written by layout 1 carry their
+ * currency, and the file ends with the profile's currency and rates.
+ * Layout 0 files from before currencies are still read.
+ */
+#define FP_LAYOUT                 (1)
+
+#ifdef WEALTH_FIXED_POINT
+static const uint8_t IDENTIFIER[] = { 'F', 'P', FP_ENCODING_FIXED, FP_LAYOUT };
+#else
+static const uint8_t IDENTIFIER[] = { 'F', 'P', FP_ENCODING_DOUBLE, FP_LAYOUT };
+#endif
+
+typedef struct financial_item_v0 {
+	desc_short_t description;
+	value_t      amount;
+} financial_item_v0_t;
+
+typedef struct financial_asset_v0 {
+	financial_item_v0_t     base;
+	financial_asset_class_t asset_class;
+} financial_asset_v0_t;
+
+typedef struct financial_liability_v0 {
+	financial_item_v0_t         base;
+	financial_liability_class_t liability_class;
+} financial_liability_v0_t;
+
+typedef struct financial_expense_v0 {
+	financial_item_v0_t base;
+} financial_expense_v0_t;
+
+static inline void __financial_item_from_v0( financial_item_t* item, const financial_item_v0_t* old )
+{
+	memcpy( item->description, old->description, sizeof(desc_short_t) );
+	item->amount = old->amount;
+}
 
 
 typedef struct financial_profile_header {
@@ -106,10 +182,54 @@ typedef struct financial_profile_header {
 } financial_profile_header_t;
 
 
+value_t __financial_profile_decode_amount( value_t raw, uint8_t encoding, uint32_t scale )
+{
+	double amount;
+
+	if( encoding == FP_ENCODING_FIXED )
+	{
+		int64_t minor;
+		memcpy( &minor, &raw, sizeof(minor) );
+#ifdef WEALTH_FIXED_POINT
+		if( scale == WEALTH_MONEY_SCALE )
+		{
+			return minor;
+		}
+#endif
+		amount = (double) minor / scale;
+	}
+	else
+	{
+		memcpy( &amount, &raw, sizeof(amount) );
+	}
+
+	return value_from_double( amount );
+}
+
+static financial_profile_t* financial_profile_load_compressed( FILE* file )
+{
+	financial_profile_t* profile = NULL;
+	long size;
+
+	if( fseek( file, 0, SEEK_END ) == 0 && (size = ftell( file )) > 0 && fseek( file, 0, SEEK_SET ) == 0 )
+	{
+		uint8_t* data = malloc( size );
+
+		if( data && fread( data, 1, size, file ) == (size_t) size )
+		{
+			profile = financial_profile_decode( data, size );
+		}
+
+		free( data );
+	}
+
+	return profile;
+}
 
 financial_profile_t* financial_profile_load( const char* filename )
 {
 	financial_profile_t* profile = NULL;
+	STATS_TIMER_BEGIN( timer );
 	FILE* file = fopen( filename, "rb" );
 
 #define check_read(X, Y) \
@@ -127,42 +247,97 @@ financial_profile_t* financial_profile_load( const char* filename )
 	{
 		financial_profile_header_t header;
 
-		size_t objs_read = fread( &header, sizeof(header), 1, file );
+		size_t objs_read = fread( header.identifier, sizeof(header.identifier), 1, file );
 		check_read( objs_read, 1 );
 
-		if( memcmp(header.identifier, IDENTIFIER, sizeof(header.identifier) ) != 0 )
+		uint8_t  encoding = header.identifier[ 2 ];
+		uint32_t scale    = 1;
+
+		if( memcmp(header.identifier, IDENTIFIER, 2 ) == 0 && encoding == FP_ENCODING_COMPRESSED )
 		{
+			profile = financial_profile_load_compressed( file );
 			goto done;
 		}
-		else
+
+		objs_read = fread( &header.asset_count, sizeof(header) - sizeof(header.identifier), 1, file );
+		check_read( objs_read, 1 );
+
+		uint8_t layout = header.identifier[ 3 ];
+
+		if( memcmp(header.identifier, IDENTIFIER, 2 ) != 0 || layout > FP_LAYOUT ||
+		    (encoding != FP_ENCODING_DOUBLE && encoding != FP_ENCODING_FIXED) )
 		{
-			profile = financial_profile_create( );
+			goto done;
 		}
 
-		if( profile )
+		if( encoding == FP_ENCODING_FIXED )
 		{
-			vector_reserve( profile->assets, header.asset_count );
-			vector_reserve( profile->liabilities, header.liability_count );
-			vector_reserve( profile->expenses, header.expense_count );
+			objs_read = fread( &scale, sizeof(scale), 1, file );
+			check_read( objs_read, 1 );
 
+			if( scale == 0 )
+			{
+				goto done;
+			}
+		}
+
+		profile = financial_profile_create( );
+
+		if( profile )
+		{
 			for( size_t i = 0; i < header.asset_count; i++ )
 			{
 				financial_asset_t* item = (financial_asset_t*) __financial_profile_item_add( profile, FI_ASSET );
-				objs_read = fread( item, sizeof(*item), 1, file );
+				objs_read = item ? 1 : 0;
+				check_read( objs_read, 1 );
+				if( layout == 0 )
+				{
+					financial_asset_v0_t old;
+					objs_read = fread( &old, sizeof(old), 1, file );
+					__financial_item_from_v0( &item->base, &old.base );
+					item->asset_class = old.asset_class;
+				}
+				else
+				{
+					objs_read = fread( item, sizeof(*item), 1, file );
+				}
 				check_read( objs_read, 1 );
 			}
 
 			for( size_t i = 0; i < header.liability_count; i++ )
 			{
 				financial_liability_t* item = (financial_liability_t*) __financial_profile_item_add( profile, FI_LIABILITY );
-				objs_read = fread( item, sizeof(*item), 1, file );
+				objs_read = item ? 1 : 0;
+				check_read( objs_read, 1 );
+				if( layout == 0 )
+				{
+					financial_liability_v0_t old;
+					objs_read = fread( &old, sizeof(old), 1, file );
+					__financial_item_from_v0( &item->base, &old.base );
+					item->liability_class = old.liability_class;
+				}
+				else
+				{
+					objs_read = fread( item, sizeof(*item), 1, file );
+				}
 				check_read( objs_read, 1 );
 			}
 
 			for( size_t i = 0; i < header.expense_count; i++ )
 			{
 				financial_expense_t* item = (financial_expense_t*) __financial_profile_item_add( profile, FI_MONTHLY_EXPENSE );
-				objs_read = fread( item, sizeof(*item), 1, file );
+				objs_read = item ? 1 : 0;
+				check_read( objs_read, 1 );
+				if( layout == 0 )
+				{
+					financial_expense_v0_t old;
+					objs_read = fread( &old, sizeof(old), 1, file );
+					__financial_item_from_v0( &item->base, &old.base );
+				}
+				else
+				{
+					objs_read = fread( item, sizeof(*item), 1, file );
+				}
 				check_read( objs_read, 1 );
 			}
 
@@ -189,17 +364,69 @@ financial_profile_t* financial_profile_load( const char* filename )
 			check_read( objs_read, 1 );
 			objs_read = fread( &profile->last_updated, sizeof(profile->last_updated), 1, file );
 			check_read( objs_read, 1 );
+
+			if( layout > 0 )
+			{
+				uint32_t rate_count;
+				objs_read = fread( &profile->currency, sizeof(profile->currency), 1, file );
+				check_read( objs_read, 1 );
+				objs_read = fread( &rate_count, sizeof(rate_count), 1, file );
+				check_read( objs_read, 1 );
+
+				/* Subtotals are not stored, so setting the rates leaves every collection dirty. */
+				for( uint32_t i = 0; i < rate_count; i++ )
+				{
+					financial_currency_t currency;
+					double rate;
+					objs_read = fread( &currency, sizeof(currency), 1, file );
+					check_read( objs_read, 1 );
+					objs_read = fread( &rate, sizeof(rate), 1, file );
+					check_read( objs_read, 1 );
+					check_read( financial_profile_set_fx_rate( profile, currency, rate ), true );
+				}
+			}
+
+#ifdef WEALTH_FIXED_POINT
+			bool native = encoding == FP_ENCODING_FIXED && scale == WEALTH_MONEY_SCALE;
+#else
+			bool native = encoding == FP_ENCODING_DOUBLE;
+#endif
+			if( !native )
+			{
+				for( int type = FI_ASSET; type <= FI_MONTHLY_EXPENSE; type++ )
+				{
+					for( size_t i = 0; i < profile->items[ type ].count; i++ )
+					{
+						financial_item_t* item = __financial_collection_at( &profile->items[ type ], i );
+						item->amount = __financial_profile_decode_amount( item->amount, encoding, scale );
+					}
+				}
+
+				profile->total_assets      = __financial_profile_decode_amount( profile->total_assets, encoding, scale );
+				profile->total_liabilities = __financial_profile_decode_amount( profile->total_liabilities, encoding, scale );
+				profile->total_expenses    = __financial_profile_decode_amount( profile->total_expenses, encoding, scale );
+				profile->monthly_income    = __financial_profile_decode_amount( profile->monthly_income, encoding, scale );
+				profile->disposable_income = __financial_profile_decode_amount( profile->disposable_income, encoding, scale );
+				profile->net_worth         = __financial_profile_decode_amount( profile->net_worth, encoding, scale );
+				profile->goal              = __financial_profile_decode_amount( profile->goal, encoding, scale );
+			}
 		}
 	}
 
 done:
-	if( file ) fclose( file );
+	if( file )
+	{
+		STATS_COUNT( FS_BYTES_LOADED, profile ? (uint64_t) ftell( file ) : 0 );
+		fclose( file );
+	}
+	STATS_TIMER_END( FS_OP_LOAD, timer );
 	return profile;
 }
 
 bool financial_profile_save( const financial_profile_t* profile, const char* filename )
 {
 	bool result = false;
+	STATS_TIMER_BEGIN( timer );
 	FILE* file = fopen( filename, "wb" );
 
 #define check_write(X, Y) \
@@ -210,10 +437,13 @@ bool financial_profile_save( const financial_profile_t* profile, const char* fil
 
 	if( file && profile )
 	{
+		/* Items are written a chunk at a time, so the buffer is made to hold several. */
+		setvbuf( file, NULL, _IOFBF, 1 << 16 );
+
 		financial_profile_header_t header = {
-			.asset_count           = vector_size(profile->assets),
-			.liability_count       = vector_size(profile->liabilities),
-			.expense_count = vector_size(profile->expenses)
+			.asset_count           = profile->items[ FI_ASSET ].count,
+			.liability_count       = profile->items[ FI_LIABILITY ].count,
+			.expense_count = profile->items[ FI_MONTHLY_EXPENSE ].count
 		};
 
 		memcpy( &header.identifier, IDENTIFIER, sizeof(IDENTIFIER) );
@@ -221,25 +451,22 @@ bool financial_profile_save( const financial_profile_t* profile, const char* fil
 		size_t objs_written = fwrite( &header, sizeof(header), 1, file );
 		check_write( objs_written, 1 );
 
-		for( size_t i = 0; i < header.asset_count; i++ )
-		{
-			const financial_asset_t* item = (const financial_asset_t*) financial_profile_item_get( profile, FI_ASSET, i );
-			objs_written = fwrite( item, sizeof(financial_asset_t), 1, file );
-			check_write( objs_written, 1 );
-		}
+#ifdef WEALTH_FIXED_POINT
+		uint32_t scale = WEALTH_MONEY_SCALE;
+		objs_written = fwrite( &scale, sizeof(scale), 1, file );
+		check_write( objs_written, 1 );
+#endif
 
-		for( size_t i = 0; i < header.liability_count; i++ )
+		for( int type = FI_ASSET; type <= FI_MONTHLY_EXPENSE; type++ )
 		{
-			const financial_liability_t* item = (const financial_liability_t*) financial_profile_item_get( profile, FI_LIABILITY, i );
-			objs_written = fwrite( item, sizeof(financial_liability_t), 1, file );
-			check_write( objs_written, 1 );
-		}
+			financial_item_span_t span;
 
-		for( size_t i = 0; i < header.expense_count; i++ )
-		{
-			const financial_expense_t* item = (const financial_expense_t*) financial_profile_item_get( profile, FI_MONTHLY_EXPENSE, i );
-			objs_written = fwrite( item, sizeof(financial_expense_t), 1, file );
-			check_write( objs_written, 1 );
+			for( size_t first = 0; first < profile->items[ type ].count; first += span.count )
+			{
+				span = __financial_collection_span( &profile->items[ type ], first );
+				objs_written = fwrite( span.base, span.stride, span.count, file );
+				check_write( objs_written, span.count );
+			}
 		}
 
 		objs_written = fwrite( &profile->total_assets, sizeof(profile->total_assets), 1, file );
@@ -265,11 +492,27 @@ bool financial_profile_save( const financial_profile_t* profile, const char* fil
 		objs_written = fwrite( &profile->last_updated, sizeof(profile->last_updated), 1, file );
 		check_write( objs_written, 1 );
 
+		uint32_t rate_count = profile->rates ? (uint32_t) vector_size( profile->rates ) - 1 : 0;
+		objs_written = fwrite( &profile->currency, sizeof(profile->currency), 1, file );
+		check_write( objs_written, 1 );
+		objs_written = fwrite( &rate_count, sizeof(rate_count), 1, file );
+		check_write( objs_written, 1 );
+
+		for( uint32_t i = 1; i <= rate_count; i++ )
+		{
+			objs_written = fwrite( &profile->rates[ i ].currency, sizeof(financial_currency_t), 1, file );
+			check_write( objs_written, 1 );
+			objs_written = fwrite( &profile->rates[ i ].rate, sizeof(double), 1, file );
+			check_write( objs_written, 1 );
+		}
+
+		STATS_COUNT( FS_BYTES_SAVED, (uint64_t) ftell( file ) );
 		result = true;
 	}
 
 done:
 	if( file ) fclose( file );
+	STATS_TIMER_END( FS_OP_SAVE, timer );
 	return result;
 }
 
@@ -278,48 +521,50 @@ done:
 financial_item_t* financial_profile_item_add( financial_profile_t* profile, financial_item_type_t type, const char* description, value_t amount )
 {
 	assert( profile );
+	STATS_TIMER_BEGIN( timer );
 
 	financial_item_t* item = __financial_profile_item_add( profile, type );
-	financial_item_set_description( item, description );
-	financial_item_set_amount( item, amount );
 
+	if( item )
+	{
+		financial_item_set_description( item, description );
+		financial_item_set_amount( item, amount );
+	}
+
+	STATS_COUNT( FS_ITEMS_ADDED, item ? 1 : 0 );
+	STATS_TIMER_END( FS_OP_ITEM_ADD, timer );
 	return item;
 }
 
+static const flags_t __financial_profile_dirty_flags[ 3 ] = {
+	FP_FLAG_ASSETS_DIRTY,
+	FP_FLAG_LIABILITIES_DIRTY,
+	FP_FLAG_MONTHLY_EXPENSES_DIRTY
+};
+
+/* Returns NULL for an unknown type or when a chunk could not be allocated. */
 financial_item_t* __financial_profile_item_add( financial_profile_t* profile, financial_item_type_t type )
 {
 	assert( profile );
 	financial_item_t* result = NULL;
 
-	switch( type )
+	if( type <= FI_MONTHLY_EXPENSE )
 	{
-		case FI_ASSET:
-		{
-			vector_push_emplace( profile->assets );
-			financial_asset_t* asset = &vector_last( profile->assets );
-			asset->asset_class = FA_UNSPECIFIED;
-			result = (financial_item_t*) asset;
-			profile->flags |= FP_FLAG_ASSETS_DIRTY;
-			break;
-		}
-		case FI_LIABILITY:
-		{
-			vector_push_emplace( profile->liabilities );
-			financial_liability_t* liability = &vector_last( profile->liabilities );
-			liability->liability_class = FL_UNSPECIFIED;
-			result = (financial_item_t*) liability;
-			profile->flags |= FP_FLAG_LIABILITIES_DIRTY;
-			break;
-		}
-		case FI_MONTHLY_EXPENSE:
+		financial_collection_t* items = &profile->items[ type ];
+		STATS_COUNT( FS_REALLOCS, (items->count & (FINANCIAL_ITEM_CHUNK - 1)) == 0 );
+
+		/* New items are zeroed, so classes start out unspecified and currencies FC_NONE. */
+		result = __financial_collection_push( items );
+
+		if( result )
 		{
-			vector_push_emplace( profile->expenses );
-			result = (financial_item_t*) &vector_last( profile->expenses );
-			profile->flags |= FP_FLAG_MONTHLY_EXPENSES_DIRTY;;
-			break;
+			profile->flags |= __financial_profile_dirty_flags[ type ];
+
+			if( profile->handles[ type ] )
+			{
+				__financial_handles_push( profile->handles[ type ] );
+			}
 		}
-		default:
-			break;
 	}
 
 	return result;
@@ -328,183 +573,438 @@ financial_item_t* __financial_profile_item_add( financial_profile_t* profile, fi
 bool financial_profile_item_remove( financial_profile_t* profile, financial_item_type_t type, size_t index )
 {
 	bool result = false;
-	switch( type )
+	STATS_TIMER_BEGIN( timer );
+
+	if( type <= FI_MONTHLY_EXPENSE && index < profile->items[ type ].count )
 	{
-		case FI_ASSET:
-		{
-			size_t count = vector_size( profile->assets );
-			if( index < count )
-			{
-				financial_asset_t last_item = vector_last( profile->assets );
-				profile->assets[ index ] = last_item;
-				vector_pop( profile->assets );
-				result = true;
-			}
-		}
-		case FI_LIABILITY:
+		financial_collection_t* items = &profile->items[ type ];
+		size_t last = items->count - 1;
+		financial_item_t* hole = index != last ? __financial_collection_write( items, index ) : NULL;
+
+		if( hole || index == last )
 		{
-			size_t count = vector_size( profile->liabilities );
-			if( index < count )
+			if( hole )
 			{
-				financial_liability_t last_item = vector_last( profile->liabilities );
-				profile->liabilities[ index ] = last_item;
-				vector_pop( profile->liabilities );
-				result = true;
+				memcpy( hole, __financial_collection_at( items, last ), items->stride );
 			}
-		}
-		case FI_MONTHLY_EXPENSE:
-		{
-			size_t count = vector_size( profile->expenses );
-			if( index < count )
+			__financial_collection_pop( items, 1 );
+			if( profile->handles[ type ] )
 			{
-				financial_expense_t last_item = vector_last( profile->expenses );
-				profile->expenses[ index ] = last_item;
-				vector_pop( profile->expenses );
-				result = true;
+				__financial_handles_remove( profile->handles[ type ], index );
 			}
+			profile->flags |= __financial_profile_dirty_flags[ type ];
+			result = true;
 		}
-		default:
-			break;
 	}
 
+	STATS_COUNT( FS_ITEMS_REMOVED, result ? 1 : 0 );
+	STATS_TIMER_END( FS_OP_ITEM_REMOVE, timer );
 	return result;
 }
 
-size_t financial_profile_item_index( const financial_profile_t* profile, financial_item_type_t type, const financial_item_t* item )
+/*
+ * Batch removals finish here: the collection shrinks by removed items and
+ * a clean total is adjusted by the amount removed rather than rescanned.
+ */
+static void __financial_profile_removed( financial_profile_t* profile, financial_item_type_t type, size_t removed, value_t amount )
 {
-	assert( profile );
+	flags_t flag = __financial_profile_dirty_flags[ type ];
+	value_t* total;
+
 	switch( type )
 	{
 		case FI_ASSET:
-			return (financial_asset_t*)item - profile->assets;
+			total = &profile->total_assets;
+			break;
 		case FI_LIABILITY:
-			return (financial_liability_t*)item - profile->liabilities;
-		case FI_MONTHLY_EXPENSE:
-			return (financial_expense_t*)item - profile->expenses;
+			total = &profile->total_liabilities;
+			break;
 		default:
-			return 0;
+			total = &profile->total_expenses;
+			break;
+	}
+
+	__financial_collection_pop( &profile->items[ type ], removed );
+
+	STATS_COUNT( FS_ITEMS_REMOVED, removed );
+
+	/* A dirty collection is rescanned by the next refresh anyway. */
+	if( removed == 0 || (profile->flags & flag) )
+	{
+		return;
+	}
+
+	/* Amounts in several currencies are regrouped by the next refresh. */
+	if( profile->rates )
+	{
+		profile->flags |= flag;
+		return;
+	}
+
+	*total -= amount;
+
+	if( !(profile->flags & (FP_FLAG_ASSETS_DIRTY | FP_FLAG_LIABILITIES_DIRTY)) )
+	{
+		profile->net_worth = profile->total_assets - profile->total_liabilities;
+	}
+
+	if( !(profile->flags & (FP_FLAG_INCOME_DIRTY | FP_FLAG_MONTHLY_EXPENSES_DIRTY)) )
+	{
+		profile->disposable_income = (profile->monthly_income > profile->total_expenses) ?
+		                             (profile->monthly_income - profile->total_expenses) : 0;
 	}
+
+	__financial_profile_updated( profile, flag );
 }
 
-financial_item_t* financial_profile_item_get( const financial_profile_t* profile, financial_item_type_t type, size_t index )
+/*
+ * Removals copy a chunk still shared with a fork before the first write to
+ * it. If that copy fails, whatever was removed so far stays removed.
+ */
+size_t financial_profile_item_remove_if( financial_profile_t* profile, financial_item_type_t type, financial_item_predicate_fxn_t predicate, void* data, bool keep_order )
 {
 	assert( profile );
-	financial_item_t* result = NULL;
+	assert( predicate );
+	STATS_TIMER_BEGIN( timer );
+	size_t removed = 0;
 
-	switch( type )
+	if( type > FI_MONTHLY_EXPENSE )
 	{
-		case FI_ASSET:
+		goto done;
+	}
+
+	financial_collection_t* items = &profile->items[ type ];
+	financial_handle_table_t* handles = profile->handles[ type ];
+	size_t count = items->count;
+	value_t amount = 0;
+
+	if( keep_order )
+	{
+		size_t write = 0;
+
+		for( size_t read = 0; read < count; read++ )
 		{
-			size_t count = vector_size( profile->assets );
-			if( index < count )
+			const financial_item_t* item = __financial_collection_at( items, read );
+
+			if( predicate( item, data ) )
 			{
-				result = (financial_item_t*) &profile->assets[ index ];
+				/* Everything from the first hole on moves, so it is made private at once. */
+				if( removed == 0 && !__financial_collection_unshare( items, read, count - read ) )
+				{
+					break;
+				}
+				amount += item->amount;
+				if( handles ) __financial_handles_release( handles, read );
+				removed += 1;
+			}
+			else
+			{
+				if( write != read ) memcpy( __financial_collection_at( items, write ), item, items->stride );
+				write += 1;
 			}
-			break;
 		}
-		case FI_LIABILITY:
+
+		if( handles && removed > 0 ) __financial_handles_compact( handles );
+	}
+	else
+	{
+		/* Each removal moves the last item into the hole, which is tested next. */
+		for( size_t i = 0; i < count; )
 		{
-			size_t count = vector_size( profile->liabilities );
-			if( index < count )
+			const financial_item_t* item = __financial_collection_at( items, i );
+
+			if( predicate( item, data ) )
 			{
-				result = (financial_item_t*) &profile->liabilities[ index ];
+				financial_item_t* hole = i != count - 1 ? __financial_collection_write( items, i ) : NULL;
+
+				if( !hole && i != count - 1 )
+				{
+					break;
+				}
+				amount += item->amount;
+				if( handles ) __financial_handles_remove( handles, i );
+				count -= 1;
+				if( hole ) memcpy( hole, __financial_collection_at( items, count ), items->stride );
+				removed += 1;
+			}
+			else
+			{
+				i += 1;
 			}
-			break;
 		}
-		case FI_MONTHLY_EXPENSE:
+	}
+
+	__financial_profile_removed( profile, type, removed, amount );
+
+done:
+	STATS_TIMER_END( FS_OP_ITEM_REMOVE, timer );
+	return removed;
+}
+
+size_t financial_profile_item_remove_indices( financial_profile_t* profile, financial_item_type_t type, const size_t* indices, size_t index_count, bool keep_order )
+{
+	assert( profile );
+	assert( indices || index_count == 0 );
+	STATS_TIMER_BEGIN( timer );
+	size_t count = financial_profile_item_count( profile, type );
+	size_t removed = 0;
+	value_t amount = 0;
+
+	/* Nothing is removed unless every index is in range and the list ascends. */
+	for( size_t k = 0; k < index_count; k++ )
+	{
+		if( indices[ k ] >= count || (k > 0 && indices[ k ] <= indices[ k - 1 ]) )
+		{
+			goto done;
+		}
+	}
+
+	if( index_count == 0 )
+	{
+		goto done;
+	}
+
+	financial_collection_t* items = &profile->items[ type ];
+	financial_handle_table_t* handles = profile->handles[ type ];
+
+	/* Every chunk written to is made private first, so nothing is removed if that fails. */
+	if( keep_order )
+	{
+		if( !__financial_collection_unshare( items, indices[ 0 ], count - indices[ 0 ] ) )
 		{
-			size_t count = vector_size( profile->expenses );
-			if( index < count )
+			goto done;
+		}
+	}
+	else
+	{
+		for( size_t k = 0; k < index_count; k++ )
+		{
+			if( !__financial_collection_unshare( items, indices[ k ], 1 ) )
 			{
-				result = (financial_item_t*) &profile->expenses[ index ];
+				goto done;
 			}
-			break;
 		}
-		default:
-			break;
+	}
+
+	if( keep_order )
+	{
+		size_t write = indices[ 0 ];
+
+		for( size_t read = indices[ 0 ], k = 0; read < count; read++ )
+		{
+			const financial_item_t* item = __financial_collection_at( items, read );
+
+			if( k < index_count && indices[ k ] == read )
+			{
+				amount += item->amount;
+				if( handles ) __financial_handles_release( handles, read );
+				k += 1;
+			}
+			else
+			{
+				memcpy( __financial_collection_at( items, write ), item, items->stride );
+				write += 1;
+			}
+		}
+
+		if( handles ) __financial_handles_compact( handles );
+	}
+	else
+	{
+		/* Highest first, so the last item is never one still to be removed. */
+		for( size_t k = index_count; k > 0; k-- )
+		{
+			size_t index = indices[ k - 1 ];
+			financial_item_t* hole = __financial_collection_at( items, index );
+			amount += hole->amount;
+			if( handles ) __financial_handles_remove( handles, index );
+			count -= 1;
+			if( index != count ) memcpy( hole, __financial_collection_at( items, count ), items->stride );
+		}
+	}
+
+	removed = index_count;
+	__financial_profile_removed( profile, type, removed, amount );
+
+done:
+	STATS_TIMER_END( FS_OP_ITEM_REMOVE, timer );
+	return removed;
+}
+
+/* Returns SIZE_MAX for an item that is not in the collection. */
+size_t financial_profile_item_index( const financial_profile_t* profile, financial_item_type_t type, const financial_item_t* item )
+{
+	assert( profile );
+	return type <= FI_MONTHLY_EXPENSE ? __financial_collection_index( &profile->items[ type ], item ) : SIZE_MAX;
+}
+
+/*
+ * Items handed out by item_get and item_span may be written to, so the
+ * chunk holding them is copied first if it is still shared with a fork.
+ * item_at and item_const_span only read, and leave it shared.
+ */
+financial_item_t* financial_profile_item_get( financial_profile_t* profile, financial_item_type_t type, size_t index )
+{
+	assert( profile );
+	financial_item_t* result = NULL;
+
+	if( type <= FI_MONTHLY_EXPENSE && index < profile->items[ type ].count )
+	{
+		result = __financial_collection_write( &profile->items[ type ], index );
 	}
 
 	return result;
 }
 
-size_t financial_profile_item_count( const financial_profile_t* profile, financial_item_type_t type )
+const financial_item_t* financial_profile_item_at( const financial_profile_t* profile, financial_item_type_t type, size_t index )
 {
 	assert( profile );
-	size_t result = 0;
+	const financial_item_t* result = NULL;
 
-	switch( type )
+	if( type <= FI_MONTHLY_EXPENSE && index < profile->items[ type ].count )
 	{
-		case FI_ASSET:
-			result = vector_size( profile->assets );
-			break;
-		case FI_LIABILITY:
-			result = vector_size( profile->liabilities );
-			break;
-		case FI_MONTHLY_EXPENSE:
-			result = vector_size( profile->expenses );
-			break;
-		default:
-			break;
+		result = __financial_collection_at( &profile->items[ type ], index );
 	}
 
 	return result;
 }
 
-void financial_profile_item_clear( financial_profile_t* profile, financial_item_type_t type )
+financial_item_span_t financial_profile_item_span( financial_profile_t* profile, financial_item_type_t type, size_t first )
 {
 	assert( profile );
+	financial_item_span_t span = { .base = NULL, .stride = 0, .count = 0 };
 
-	switch( type )
+	if( type <= FI_MONTHLY_EXPENSE )
 	{
-		case FI_ASSET:
-			vector_clear( profile->assets );
-			break;
-		case FI_LIABILITY:
-			vector_clear( profile->liabilities );
-			break;
-		case FI_MONTHLY_EXPENSE:
-			vector_clear( profile->expenses );
-			break;
-		default:
-			break;
+		financial_collection_t* items = &profile->items[ type ];
+		span = __financial_collection_span( items, first );
+
+		/* Copying a shared chunk moves it, so the base is taken afterwards. */
+		if( span.count > 0 )
+		{
+			span.base  = __financial_collection_write( items, first );
+			span.count = span.base ? span.count : 0;
+		}
 	}
+
+	return span;
 }
 
+financial_item_const_span_t financial_profile_item_const_span( const financial_profile_t* profile, financial_item_type_t type, size_t first )
+{
+	assert( profile );
+	financial_item_const_span_t items = { .base = NULL, .stride = 0, .count = 0 };
+
+	if( type <= FI_MONTHLY_EXPENSE )
+	{
+		financial_item_span_t span = __financial_collection_span( &profile->items[ type ], first );
+		items.base   = span.base;
+		items.stride = span.stride;
+		items.count  = span.count;
+	}
 
+	return items;
+}
 
-void financial_profile_sort( financial_profile_t* profile, financial_item_sort_method_t method )
+const size_t* financial_profile_item_version( const financial_profile_t* profile, financial_item_type_t type )
 {
-	financial_item_collection_sort( profile->assets, sizeof(*profile->assets), method );
-	financial_item_collection_sort( profile->liabilities, sizeof(*profile->liabilities), method );
-	financial_item_collection_sort( profile->expenses, sizeof(*profile->expenses), method );
+	assert( profile );
+	assert( type <= FI_MONTHLY_EXPENSE );
+	return &profile->items[ type ].version;
 }
 
-void financial_profile_sort_items( financial_profile_t* profile, financial_item_type_t type, financial_item_sort_method_t method )
+bool financial_profile_foreach( const financial_profile_t* profile, financial_item_type_t type, size_t batch_size, financial_item_visit_fxn_t visit, void* data )
 {
 	assert( profile );
+	assert( visit );
 
-	switch( type )
+	if( type > FI_MONTHLY_EXPENSE )
 	{
-		case FI_ASSET:
-		{
-			financial_item_collection_sort( profile->assets, sizeof(*profile->assets), method );
-			break;
-		}
-		case FI_LIABILITY:
-		{
-			financial_item_collection_sort( profile->liabilities, sizeof(*profile->liabilities), method );
-			break;
-		}
-		case FI_MONTHLY_EXPENSE:
+		return true;
+	}
+
+	/* Visitors only read, so chunks shared with a fork stay shared. */
+	const financial_collection_t* items = &profile->items[ type ];
+	financial_item_span_t batch;
+
+	for( size_t first = 0; first < items->count; first += batch.count )
+	{
+		batch = __financial_collection_span( items, first );
+
+		if( batch_size > 0 && batch.count > batch_size )
 		{
-			financial_item_collection_sort( profile->expenses, sizeof(*profile->expenses), method );
-			break;
+			batch.count = batch_size;
 		}
-		default:
+
+		if( !visit( batch, first, data ) )
 		{
-			break;
+			return false;
 		}
 	}
+
+	return true;
+}
+
+size_t financial_profile_item_count( const financial_profile_t* profile, financial_item_type_t type )
+{
+	assert( profile );
+	return type <= FI_MONTHLY_EXPENSE ? profile->items[ type ].count : 0;
+}
+
+void financial_profile_item_clear( financial_profile_t* profile, financial_item_type_t type )
+{
+	assert( profile );
+
+	if( type > FI_MONTHLY_EXPENSE )
+	{
+		return;
+	}
+
+	/* Shared chunks are dropped rather than copied just to be emptied. */
+	__financial_collection_destroy( &profile->items[ type ] );
+
+	if( profile->handles[ type ] )
+	{
+		__financial_handles_clear( profile->handles[ type ] );
+	}
+}
+
+
+
+static void __financial_profile_sort_collection( financial_profile_t* profile, financial_item_type_t type, financial_item_sort_method_t method )
+{
+	if( type > FI_MONTHLY_EXPENSE )
+	{
+		return;
+	}
+
+	/* Handles follow their items through the permutation. */
+	financial_handle_table_t* handles = profile->handles[ type ];
+	uint32_t* tags = handles ? handles->items : NULL;
+
+	__financial_collection_sort( &profile->items[ type ], method, tags );
+
+	if( handles )
+	{
+		__financial_handles_reindex( handles );
+	}
+}
+
+void financial_profile_sort( financial_profile_t* profile, financial_item_sort_method_t method )
+{
+	STATS_TIMER_BEGIN( timer );
+	__financial_profile_sort_collection( profile, FI_ASSET, method );
+	__financial_profile_sort_collection( profile, FI_LIABILITY, method );
+	__financial_profile_sort_collection( profile, FI_MONTHLY_EXPENSE, method );
+	STATS_TIMER_END( FS_OP_SORT, timer );
+}
+
+void financial_profile_sort_items( financial_profile_t* profile, financial_item_type_t type, financial_item_sort_method_t method )
+{
+	assert( profile );
+	STATS_TIMER_BEGIN( timer );
+	__financial_profile_sort_collection( profile, type, method );
+	STATS_TIMER_END( FS_OP_SORT, timer );
 }
 
 void financial_profile_set_updated_callback( financial_profile_t* profile, const financial_profile_updated_fxn_t callback )
@@ -513,6 +1013,47 @@ void financial_profile_set_updated_callback( financial_profile_t* profile, const
 	profile->on_updated = callback;
 }
 
+financial_subscription_t* financial_profile_subscribe( financial_profile_t* profile, flags_t mask, financial_profile_updated_fxn_t callback, void* data, financial_event_queue_t* queue )
+{
+	assert( profile );
+	return __financial_subscriptions_add( &profile->subscriptions, profile, mask, callback, data, queue );
+}
+
+void financial_profile_unsubscribe( financial_profile_t* profile, financial_subscription_t* subscription )
+{
+	assert( profile );
+	__financial_subscriptions_remove( profile->subscriptions, subscription );
+}
+
+static void financial_profile_notify( financial_profile_t* profile, flags_t flags )
+{
+	if( profile->on_updated )
+	{
+		profile->on_updated( profile, flags, profile->user_data );
+	}
+
+	__financial_subscriptions_notify( profile->subscriptions, flags );
+}
+
+void financial_profile_begin_updates( financial_profile_t* profile )
+{
+	assert( profile );
+	profile->batch_depth += 1;
+}
+
+void financial_profile_end_updates( financial_profile_t* profile )
+{
+	assert( profile );
+	assert( profile->batch_depth > 0 );
+
+	if( profile->batch_depth > 0 && --profile->batch_depth == 0 && profile->batch_flags )
+	{
+		flags_t flags = profile->batch_flags;
+		profile->batch_flags = 0;
+		financial_profile_notify( profile, flags );
+	}
+}
+
 void financial_profile_set_user_data( financial_profile_t* profile, void* data )
 {
 	assert( profile );
@@ -533,44 +1074,59 @@ void financial_profile_clear( financial_profile_t* profile )
 	financial_profile_item_clear( profile, FI_LIABILITY );
 	financial_profile_item_clear( profile, FI_MONTHLY_EXPENSE );
 
-	profile->total_assets           = 0.0;
-	profile->total_liabilities      = 0.0;
-	profile->total_expenses         = 0.0;
-	profile->monthly_income         = 0.0;
-	profile->disposable_income      = 0.0;
-	profile->net_worth              = 0.0;
-	profile->goal                   = 0.0;
+	profile->total_assets           = 0;
+	profile->total_liabilities      = 0;
+	profile->total_expenses         = 0;
+	profile->monthly_income         = 0;
+	profile->disposable_income      = 0;
+	profile->net_worth              = 0;
+	profile->goal                   = 0;
 	profile->flags                  = 0;
 	profile->credit_score           = 0;
 	profile->credit_score_updated   = now;
 	profile->last_updated           = now;
+	profile->currency               = FC_NONE;
+	__financial_currency_copy( profile, NULL );
 }
 
 
 void financial_profile_refresh( financial_profile_t* profile )
 {
 	assert( profile );
+	STATS_TIMER_BEGIN( timer );
 	time_t now = time( NULL );
 
+	STATS_COUNT( FS_REFRESH_CALLS, 1 );
+	STATS_COUNT( FS_REFRESH_CLEAN, (profile->flags & (FP_FLAG_INCOME_DIRTY | FP_FLAG_ASSETS_DIRTY | FP_FLAG_LIABILITIES_DIRTY | FP_FLAG_MONTHLY_EXPENSES_DIRTY)) ? 0 : 1 );
+
 	if( profile->flags & FP_FLAG_ASSETS_DIRTY )
 	{
-		profile->total_assets = financial_asset_collection_sum( profile->assets );
+		profile->total_assets = profile->rates ? __financial_currency_sum( profile, FI_ASSET )
+		                                       : __financial_collection_sum( &profile->items[ FI_ASSET ] );
+		STATS_COUNT( FS_REFRESH_RESCANS, 1 );
+		STATS_COUNT( FS_REFRESH_ITEMS_SCANNED, profile->items[ FI_ASSET ].count );
 	}
 
 	if( profile->flags & FP_FLAG_LIABILITIES_DIRTY )
 	{
-		profile->total_liabilities = financial_liability_collection_sum( profile->liabilities );
+		profile->total_liabilities = profile->rates ? __financial_currency_sum( profile, FI_LIABILITY )
+		                                            : __financial_collection_sum( &profile->items[ FI_LIABILITY ] );
+		STATS_COUNT( FS_REFRESH_RESCANS, 1 );
+		STATS_COUNT( FS_REFRESH_ITEMS_SCANNED, profile->items[ FI_LIABILITY ].count );
 	}
 
 	if( profile->flags & FP_FLAG_MONTHLY_EXPENSES_DIRTY )
 	{
-		profile->total_expenses = financial_expense_collection_sum( profile->expenses );
+		profile->total_expenses = profile->rates ? __financial_currency_sum( profile, FI_MONTHLY_EXPENSE )
+		                                         : __financial_collection_sum( &profile->items[ FI_MONTHLY_EXPENSE ] );
+		STATS_COUNT( FS_REFRESH_RESCANS, 1 );
+		STATS_COUNT( FS_REFRESH_ITEMS_SCANNED, profile->items[ FI_MONTHLY_EXPENSE ].count );
 	}
 
 	if( profile->flags & (FP_FLAG_INCOME_DIRTY | FP_FLAG_MONTHLY_EXPENSES_DIRTY) )
 	{
 		profile->disposable_income = (profile->monthly_income > profile->total_expenses) ?
-	                                 (profile->monthly_income - profile->total_expenses) : 0.0;
+	                                 (profile->monthly_income - profile->total_expenses) : 0;
 	}
 
 	if( profile->flags & (FP_FLAG_ASSETS_DIRTY | FP_FLAG_LIABILITIES_DIRTY) )
@@ -578,17 +1134,31 @@ void financial_profile_refresh( financial_profile_t* profile )
 		profile->net_worth = profile->total_assets - profile->total_liabilities;
 	}
 
-	flags_t flags = profile->flags;
+	flags_t flags = profile->flags & FP_FLAG_ALL;
 
 	/* Clear dirty flags */
-	profile->flags &= ~(FP_FLAG_INCOME_DIRTY | FP_FLAG_ASSETS_DIRTY |
-	                    FP_FLAG_LIABILITIES_DIRTY | FP_FLAG_MONTHLY_EXPENSES_DIRTY);
+	profile->flags &= ~FP_FLAG_ALL;
 
 	profile->last_updated = now;
 
-	if( profile->on_updated )
+	__financial_profile_updated( profile, flags );
+
+	STATS_TIMER_END( FS_OP_REFRESH, timer );
+}
+
+void __financial_profile_updated( financial_profile_t* profile, flags_t flags )
+{
+	/* Listeners only hear about updates that changed something. */
+	if( flags )
 	{
-		profile->on_updated( profile, flags, profile->user_data );
+		if( profile->batch_depth > 0 )
+		{
+			profile->batch_flags |= flags;
+		}
+		else
+		{
+			financial_profile_notify( profile, flags );
+		}
 	}
 }
 
@@ -632,7 +1202,7 @@ value_t financial_profile_salary( const financial_profile_t* profile )
 void financial_profile_set_salary( financial_profile_t* profile, value_t salary )
 {
 	assert( profile );
-	profile->monthly_income = salary / 12.0;
+	profile->monthly_income = value_from_double( value_to_double( salary ) / 12.0 );
 	profile->flags = FP_FLAG_INCOME_DIRTY;
 }
 
@@ -673,14 +1243,14 @@ value_t financial_profile_disposable_income( const financial_profile_t* profile
 	return profile->disposable_income;
 }
 
-value_t financial_profile_debt_to_income_ratio( const financial_profile_t* profile )
+double financial_profile_debt_to_income_ratio( const financial_profile_t* profile )
 {
 	assert( profile );
-	value_t result = 0.0;
+	double result = 0.0;
 
-	if( profile->monthly_income > 0.0 )
+	if( profile->monthly_income > 0 )
 	{
-		result = profile->total_liabilities / (profile->monthly_income * 12);
+		result = value_to_double( profile->total_liabilities ) / (value_to_double( profile->monthly_income ) * 12);
 	}
 
 	return result;
@@ -698,7 +1268,7 @@ float financial_profile_progress( const financial_profile_t* profile )
 
 	if( profile->goal > profile->net_worth )
 	{
-		result = (float) (profile->net_worth / profile->goal);
+		result = (float) (value_to_double( profile->net_worth ) / value_to_double( profile->goal ));
 	}
 
 	return result;
@@ -714,9 +1284,12 @@ static const char* percent_format( float p )
 
 void financial_profile_print( FILE* stream, const financial_profile_t* profile )
 {
-	size_t max_lines = financial_profile_item_count( profile, FI_ASSET );
-	max_lines = financial_profile_item_count( profile, FI_LIABILITY ) > max_lines ? financial_profile_item_count( profile, FI_LIABILITY ) : max_lines;
-	max_lines = financial_profile_item_count( profile, FI_MONTHLY_EXPENSE ) > max_lines ? financial_profile_item_count( profile, FI_MONTHLY_EXPENSE ) : max_lines;
+	size_t asset_count     = profile->items[ FI_ASSET ].count;
+	size_t liability_count = profile->items[ FI_LIABILITY ].count;
+	size_t expense_count   = profile->items[ FI_MONTHLY_EXPENSE ].count;
+	size_t max_lines = asset_count;
+	max_lines = liability_count > max_lines ? liability_count : max_lines;
+	max_lines = expense_count > max_lines ? expense_count : max_lines;
 
 
 	fprintf( stream, "+-------------------------------------------------"
@@ -729,14 +1302,14 @@ void financial_profile_print( FILE* stream, const financial_profile_t* profile )
 
 	for( size_t i = 0; i < max_lines; i++ )
 	{
-		financial_item_t* ass = financial_profile_item_get( profile, FI_ASSET, i );
-		financial_item_t* lia = financial_profile_item_get( profile, FI_LIABILITY, i );
-		financial_item_t* exp = financial_profile_item_get( profile, FI_MONTHLY_EXPENSE, i );
+		const financial_item_t* ass = i < asset_count ? __financial_collection_at( &profile->items[ FI_ASSET ], i ) : NULL;
+		const financial_item_t* lia = i < liability_count ? __financial_collection_at( &profile->items[ FI_LIABILITY ], i ) : NULL;
+		const financial_item_t* exp = i < expense_count ? __financial_collection_at( &profile->items[ FI_MONTHLY_EXPENSE ], i ) : NULL;
 
 
 		if( ass )
 		{
-			fprintf( stream, "| %34s: $%'-10.2f ", financial_item_description(ass), financial_item_amount(ass) );
+			fprintf( stream, "| %34s: $%'-10.2f ", financial_item_description(ass), value_to_double( financial_item_amount(ass) ) );
 		}
 		else
 		{
@@ -745,7 +1318,7 @@ void financial_profile_print( FILE* stream, const financial_profile_t* profile )
 
 		if( lia )
 		{
-			fprintf( stream, "| %34s: $%'-10.2f ", financial_item_description(lia), financial_item_amount(lia) );
+			fprintf( stream, "| %34s: $%'-10.2f ", financial_item_description(lia), value_to_double( financial_item_amount(lia) ) );
 		}
 		else
 		{
@@ -754,7 +1327,7 @@ void financial_profile_print( FILE* stream, const financial_profile_t* profile )
 
 		if( exp )
 		{
-			fprintf( stream, "| %34s: $%'-10.2f |", financial_item_description(exp), financial_item_amount(exp) );
+			fprintf( stream, "| %34s: $%'-10.2f |", financial_item_description(exp), value_to_double( financial_item_amount(exp) ) );
 		}
 		else
 		{
@@ -767,9 +1340,9 @@ void financial_profile_print( FILE* stream, const financial_profile_t* profile )
 	fprintf( stream, "+-------------------------------------------------"
 			"+-------------------------------------------------"
 			"+-------------------------------------------------+\n" );
-	fprintf( stream, "| %28s $%'-17d | %47s | %28s -$%'-16.2f |\n", "NET WORTH:", (int) round(financial_profile_net_worth(profile)), "", "TOTAL EXPENSES:", financial_profile_total_expenses(profile) );
-	fprintf( stream, "| %28s $%'-17d | %47s | %28s $%'-17.2f |\n", "GOAL:", (int) round(financial_profile_goal(profile)), "", "MONTHLY INCOME:", financial_profile_monthly_income(profile) );
-	fprintf( stream, "| %28s %-18s | %47s | %28s $%'-17.2f |\n", "PROGRESS:", percent_format(financial_profile_progress(profile)), "", "DISPOSABLE INCOME:", financial_profile_disposable_income(profile) );
+	fprintf( stream, "| %28s $%'-17d | %47s | %28s -$%'-16.2f |\n", "NET WORTH:", (int) round(value_to_double( financial_profile_net_worth(profile) )), "", "TOTAL EXPENSES:", value_to_double( financial_profile_total_expenses(profile) ) );
+	fprintf( stream, "| %28s $%'-17d | %47s | %28s $%'-17.2f |\n", "GOAL:", (int) round(value_to_double( financial_profile_goal(profile) )), "", "MONTHLY INCOME:", value_to_double( financial_profile_monthly_income(profile) ) );
+	fprintf( stream, "| %28s %-18s | %47s | %28s $%'-17.2f |\n", "PROGRESS:", percent_format(financial_profile_progress(profile)), "", "DISPOSABLE INCOME:", value_to_double( financial_profile_disposable_income(profile) ) );
 	fprintf( stream, "| %28s %-18s | %47s | %47s |\n", "DEBT TO INCOME RATIO:", percent_format(financial_profile_debt_to_income_ratio(profile)), "", "" );
 	fprintf( stream, "+-------------------------------------------------+ %47s +-------------------------------------------------+\n", "" );
 }
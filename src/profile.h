@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _FINANCIAL_PROFILE_H_
+#define _FINANCIAL_PROFILE_H_
+
+/* How amounts are stored in files and patches. */
+#define FP_ENCODING_DOUBLE        ('\0')
+#define FP_ENCODING_FIXED         ('I')
+#define FP_ENCODING_COMPRESSED    ('C') /* see encode.c */
+
+#ifdef WEALTH_FIXED_POINT
+# define FP_ENCODING_NATIVE       FP_ENCODING_FIXED
+#else
+# define FP_ENCODING_NATIVE       FP_ENCODING_DOUBLE
+#endif
+
+/* Minor units per unit when amounts are written as integers. */
+#ifdef WEALTH_FIXED_POINT
+# define FP_MINOR_SCALE           (WEALTH_MONEY_SCALE)
+#else
+# define FP_MINOR_SCALE           (100)
+#endif
+
+static inline bool __financial_amount_to_minor( value_t amount, int64_t* minor )
+{
+#ifdef WEALTH_FIXED_POINT
+	*minor = amount;
+	return true;
+#else
+	double scaled = amount * FP_MINOR_SCALE;
+	if( !(fabs( scaled ) < 4e15) )
+	{
+		return false;
+	}
+	*minor = llround( scaled );
+	return (double) *minor / FP_MINOR_SCALE == amount;
+#endif
+}
+
+/* One foreign currency of a profile; see currency.c. */
+typedef struct financial_fx_rate {
+	financial_currency_t currency;
+	double               rate;
+	value_t              subtotals[ 3 ];  /* by item type, in the currency itself */
+} financial_fx_rate_t;
+
+struct financial_profile {
+
+	/* Assets, liabilities and monthly expenses by item type; see item.h. */
+	financial_collection_t items[ 3 ];
+
+	value_t  total_assets;
+	value_t  total_liabilities;
+	value_t  total_expenses;
+	value_t  monthly_income;
+	value_t  disposable_income;
+	value_t  net_worth;
+	value_t  goal;
+	flags_t  flags;
+	uint16_t credit_score;
+	uint32_t credit_score_updated;
+	uint32_t last_updated;
+
+	financial_profile_updated_fxn_t on_updated;
+	void* user_data;
+
+	/* Item handle slot tables by item type; NULL until a handle is taken. */
+	struct financial_handle_table* handles[ 3 ];
+
+	/*
+	 * The profile's own currency and its rates to others. rates is NULL
+	 * until the first rate is set; entry zero is then the profile's own
+	 * currency at a rate of one. Subtotals are current for clean collections.
+	 */
+	financial_currency_t currency;
+	financial_fx_rate_t* rates;
+
+	financial_subscription_t* subscriptions;
+	uint32_t batch_depth;
+	flags_t  batch_flags; /* updates coalesced while batching */
+};
+
+financial_item_t* __financial_profile_item_add ( financial_profile_t* profile, financial_item_type_t type );
+void              __financial_profile_updated  ( financial_profile_t* profile, flags_t flags );
+value_t           __financial_profile_decode_amount( value_t raw, uint8_t encoding, uint32_t scale );
+value_t           __financial_currency_sum     ( financial_profile_t* profile, financial_item_type_t type );
+void              __financial_currency_copy    ( financial_profile_t* profile, const financial_fx_rate_t* rates );
+/* Asset values per class in the profile's currency, one per financial_asset_class_t. */
+void              __financial_profile_class_totals( const financial_profile_t* profile, double* totals );
+
+#endif /* _FINANCIAL_PROFILE_H_ */
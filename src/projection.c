@@ -0,0 +1,357 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include "wealth.h"
+#include "projection.h"
+
+/* Rate sets up to this size keep their state on the stack. */
+#define PROJECTION_STACK_RATES      (32)
+#define PROJECTION_BINARY_VERSION   (1)
+
+bool financial_projection_run( const financial_schedule_t* schedule, double present, const double* rates, size_t rate_count, size_t periods, const financial_projection_sink_t* sink )
+{
+	assert( schedule );
+	assert( rates || rate_count == 0 );
+	assert( sink );
+	double stack[ 2 * PROJECTION_STACK_RATES ];
+	double* state = stack;
+	bool result = false;
+
+	if( schedule->periods_per_year == 0 )
+	{
+		return false;
+	}
+
+	if( rate_count > PROJECTION_STACK_RATES )
+	{
+		state = malloc( 2 * rate_count * sizeof(double) );
+		if( !state )
+		{
+			return false;
+		}
+	}
+
+	double* balances = state;
+	double* growth   = state + rate_count;
+
+	for( size_t r = 0; r < rate_count; r++ )
+	{
+		balances[ r ] = present;
+		growth[ r ]   = 1 + rates[ r ] / schedule->periods_per_year;
+	}
+
+	if( sink->begin && !sink->begin( sink->context, rates, rate_count, periods ) )
+	{
+		goto done;
+	}
+
+	for( size_t n = 0; n < periods; n++ )
+	{
+		double deposit = n < schedule->deposit_count ? schedule->deposits[ n ] : schedule->deposit;
+		double before  = schedule->deposit_at_start ? deposit : 0.0;
+		double after   = deposit - before;
+
+		for( size_t r = 0; r < rate_count; r++ )
+		{
+			balances[ r ] = (balances[ r ] + before) * growth[ r ] + after;
+		}
+
+		if( sink->row && !sink->row( sink->context, n + 1, deposit, balances, rate_count ) )
+		{
+			goto done;
+		}
+	}
+
+	result = !sink->end || sink->end( sink->context );
+
+done:
+	if( state != stack ) free( state );
+	return result;
+}
+
+
+static bool projection_buffer_row( void* context, size_t period, double deposit, const double* balances, size_t rate_count )
+{
+	financial_projection_buffer_t* buffer = context;
+	(void) period;
+	(void) deposit;
+
+	if( buffer->rows >= buffer->capacity )
+	{
+		return false;
+	}
+
+	memcpy( &buffer->balances[ buffer->rows * rate_count ], balances, rate_count * sizeof(double) );
+	buffer->rows += 1;
+	return true;
+}
+
+financial_projection_sink_t financial_projection_buffer_sink( financial_projection_buffer_t* buffer, double* balances, size_t capacity )
+{
+	assert( buffer );
+	financial_projection_sink_t sink = { NULL, projection_buffer_row, NULL, buffer };
+	buffer->balances = balances;
+	buffer->capacity = capacity;
+	buffer->rows     = 0;
+	return sink;
+}
+
+
+static bool writer_flush( financial_projection_writer_t* writer )
+{
+	bool result = writer->used == 0 || writer->write( writer->buffer, writer->used, writer->context ) == writer->used;
+	writer->used = 0;
+	return result;
+}
+
+/* Makes room for size more bytes, flushing if needed. */
+static inline bool writer_reserve( financial_projection_writer_t* writer, size_t size )
+{
+	return writer->used + size <= sizeof(writer->buffer) || writer_flush( writer );
+}
+
+static inline void writer_put( financial_projection_writer_t* writer, const void* data, size_t size )
+{
+	memcpy( writer->buffer + writer->used, data, size );
+	writer->used += size;
+}
+
+/* Longest field the CSV sink writes: sign, 20 digits, point, 2 decimals, separator. */
+#define CSV_FIELD_MAX       (32)
+
+/* Writes an unsigned integer, returning the number of characters. */
+static size_t csv_format_integer( char* out, uint64_t value )
+{
+	char digits[ 20 ];
+	size_t n = 0;
+
+	do
+	{
+		digits[ n++ ] = (char) ('0' + value % 10);
+		value /= 10;
+	} while( value > 0 );
+
+	for( size_t i = 0; i < n; i++ )
+	{
+		out[ i ] = digits[ n - 1 - i ];
+	}
+
+	return n;
+}
+
+/* Writes an amount rounded to two decimals. */
+static size_t csv_format_amount( char* out, double amount )
+{
+	size_t n = 0;
+
+	if( !(fabs( amount ) < 9e16) )
+	{
+		const char* text = isnan( amount ) ? "nan" : (amount > 0 ? "inf" : "-inf");
+		n = strlen( text );
+		memcpy( out, text, n );
+		return n;
+	}
+
+	int64_t cents = llround( amount * 100 );
+	if( cents < 0 )
+	{
+		out[ n++ ] = '-';
+		cents = -cents;
+	}
+
+	n += csv_format_integer( out + n, (uint64_t) cents / 100 );
+	out[ n++ ] = '.';
+	out[ n++ ] = (char) ('0' + (cents / 10) % 10);
+	out[ n++ ] = (char) ('0' + cents % 10);
+	return n;
+}
+
+static bool projection_csv_begin( void* context, const double* rates, size_t rate_count, size_t periods )
+{
+	financial_projection_writer_t* writer = context;
+	static const char header[] = "period,deposit";
+	(void) periods;
+
+	if( !writer_reserve( writer, sizeof(header) ) )
+	{
+		return false;
+	}
+	writer_put( writer, header, sizeof(header) - 1 );
+
+	for( size_t r = 0; r < rate_count; r++ )
+	{
+		char field[ CSV_FIELD_MAX ];
+		size_t n = 0;
+
+		field[ n++ ] = ',';
+		n += csv_format_amount( field + n, 100 * rates[ r ] );
+		field[ n++ ] = '%';
+
+		if( !writer_reserve( writer, n ) )
+		{
+			return false;
+		}
+		writer_put( writer, field, n );
+	}
+
+	if( !writer_reserve( writer, 1 ) )
+	{
+		return false;
+	}
+	writer_put( writer, "\n", 1 );
+	return true;
+}
+
+static bool projection_csv_row( void* context, size_t period, double deposit, const double* balances, size_t rate_count )
+{
+	financial_projection_writer_t* writer = context;
+	char field[ CSV_FIELD_MAX ];
+	size_t n;
+
+	n = csv_format_integer( field, period );
+	field[ n++ ] = ',';
+	n += csv_format_amount( field + n, deposit );
+
+	if( !writer_reserve( writer, n ) )
+	{
+		return false;
+	}
+	writer_put( writer, field, n );
+
+	for( size_t r = 0; r < rate_count; r++ )
+	{
+		n = 0;
+		field[ n++ ] = ',';
+		n += csv_format_amount( field + n, balances[ r ] );
+
+		if( !writer_reserve( writer, n ) )
+		{
+			return false;
+		}
+		writer_put( writer, field, n );
+	}
+
+	if( !writer_reserve( writer, 1 ) )
+	{
+		return false;
+	}
+	writer_put( writer, "\n", 1 );
+	return true;
+}
+
+static bool projection_writer_end( void* context )
+{
+	return writer_flush( context );
+}
+
+financial_projection_sink_t financial_projection_csv_sink( financial_projection_writer_t* writer, financial_write_fxn_t write, void* context )
+{
+	assert( writer );
+	assert( write );
+	financial_projection_sink_t sink = { projection_csv_begin, projection_csv_row, projection_writer_end, writer };
+	writer->write   = write;
+	writer->context = context;
+	writer->used    = 0;
+	return sink;
+}
+
+
+static inline void binary_put_u64( financial_projection_writer_t* writer, uint64_t value )
+{
+	uint8_t bytes[ 8 ];
+	for( int i = 0; i < 8; i++ )
+	{
+		bytes[ i ] = (uint8_t) (value >> (8 * i));
+	}
+	writer_put( writer, bytes, sizeof(bytes) );
+}
+
+static inline void binary_put_double( financial_projection_writer_t* writer, double value )
+{
+	uint64_t bits;
+	memcpy( &bits, &value, sizeof(bits) );
+	binary_put_u64( writer, bits );
+}
+
+static bool projection_binary_begin( void* context, const double* rates, size_t rate_count, size_t periods )
+{
+	financial_projection_writer_t* writer = context;
+	const uint8_t header[] = {
+		'F', 'P', 'J', PROJECTION_BINARY_VERSION,
+		(uint8_t) rate_count, (uint8_t) (rate_count >> 8), (uint8_t) (rate_count >> 16), (uint8_t) (rate_count >> 24)
+	};
+
+	if( rate_count > UINT32_MAX || !writer_reserve( writer, sizeof(header) + 8 ) )
+	{
+		return false;
+	}
+	writer_put( writer, header, sizeof(header) );
+	binary_put_u64( writer, periods );
+
+	for( size_t r = 0; r < rate_count; r++ )
+	{
+		if( !writer_reserve( writer, 8 ) )
+		{
+			return false;
+		}
+		binary_put_double( writer, rates[ r ] );
+	}
+
+	return true;
+}
+
+static bool projection_binary_row( void* context, size_t period, double deposit, const double* balances, size_t rate_count )
+{
+	financial_projection_writer_t* writer = context;
+	(void) period;
+
+	if( !writer_reserve( writer, 8 ) )
+	{
+		return false;
+	}
+	binary_put_double( writer, deposit );
+
+	for( size_t r = 0; r < rate_count; r++ )
+	{
+		if( !writer_reserve( writer, 8 ) )
+		{
+			return false;
+		}
+		binary_put_double( writer, balances[ r ] );
+	}
+
+	return true;
+}
+
+financial_projection_sink_t financial_projection_binary_sink( financial_projection_writer_t* writer, financial_write_fxn_t write, void* context )
+{
+	assert( writer );
+	assert( write );
+	financial_projection_sink_t sink = { projection_binary_begin, projection_binary_row, projection_writer_end, writer };
+	writer->write   = write;
+	writer->context = context;
+	writer->used    = 0;
+	return sink;
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _WEALTH_PROJECTION_H_
+#define _WEALTH_PROJECTION_H_
+#include "wealth.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Savings projection
+ *
+ * A projection grows one balance per rate over a number of periods. Every
+ * period each balance earns its annual rate divided by periods_per_year
+ * and receives the period's deposit, at the end of the period or, for an
+ * annuity due, at the start. After every period the balances are handed
+ * to a sink as one row. Balances are carried forward, not recomputed per
+ * period, and nothing is allocated per row.
+ *
+ * A schedule deposits the same amount every period unless deposits is
+ * given, in which case period n (counting from zero) deposits
+ * deposits[ n ] while n < deposit_count and the fixed deposit after that.
+ * Amounts are plain doubles, as in the batch solvers.
+ */
+typedef struct financial_schedule {
+	uint32_t      periods_per_year;
+	bool          deposit_at_start;
+	double        deposit;
+	const double* deposits;
+	size_t        deposit_count;
+} financial_schedule_t;
+
+static inline financial_schedule_t financial_schedule_monthly( double deposit )
+{
+	financial_schedule_t schedule = { 12, false, deposit, NULL, 0 };
+	return schedule;
+}
+
+static inline financial_schedule_t financial_schedule_semi_monthly( double deposit )
+{
+	financial_schedule_t schedule = { 24, false, deposit, NULL, 0 };
+	return schedule;
+}
+
+static inline financial_schedule_t financial_schedule_custom( uint32_t periods_per_year, const double* deposits, size_t deposit_count )
+{
+	financial_schedule_t schedule = { periods_per_year, false, 0.0, deposits, deposit_count };
+	return schedule;
+}
+
+/*
+ * A sink receives the rates once, then every row in order, then end. A
+ * callback may be NULL. Returning false from any of them stops the
+ * projection, which then returns false. Periods count from one.
+ */
+typedef struct financial_projection_sink {
+	bool (*begin)( void* context, const double* rates, size_t rate_count, size_t periods );
+	bool (*row)  ( void* context, size_t period, double deposit, const double* balances, size_t rate_count );
+	bool (*end)  ( void* context );
+	void* context;
+} financial_projection_sink_t;
+
+bool financial_projection_run( const financial_schedule_t* schedule, double present, const double* rates, size_t rate_count, size_t periods, const financial_projection_sink_t* sink );
+
+/*
+ * Buffer sink
+ *
+ * Stores the balances row-major, rate_count doubles per period, in a
+ * caller-owned array of capacity rows. Rows beyond capacity stop the
+ * projection.
+ */
+typedef struct financial_projection_buffer {
+	double* balances;
+	size_t  capacity;
+	size_t  rows;
+} financial_projection_buffer_t;
+
+financial_projection_sink_t financial_projection_buffer_sink( financial_projection_buffer_t* buffer, double* balances, size_t capacity );
+
+/*
+ * Stream sinks
+ *
+ * The CSV and binary sinks format rows into the writer's own buffer and
+ * pass it to write whenever it fills and at the end, so the output can go
+ * to a file, a socket or memory without the library touching stdio. write
+ * returns the number of bytes it took; anything short of size stops the
+ * projection.
+ *
+ * CSV has a header of period, deposit and one column per rate (as a
+ * percentage), then one line per period with amounts to two decimals.
+ *
+ * The binary format is little endian: 'F' 'P' 'J' version, uint32 rate
+ * count, uint64 periods, the rates as doubles, then per period the deposit
+ * and the balances as doubles.
+ */
+typedef size_t (*financial_write_fxn_t)( const void* data, size_t size, void* context );
+
+#define FINANCIAL_WRITER_BUFFER            (4096)
+
+typedef struct financial_projection_writer {
+	financial_write_fxn_t write;
+	void*                 context;
+	size_t                used;
+	char                  buffer[ FINANCIAL_WRITER_BUFFER ];
+} financial_projection_writer_t;
+
+financial_projection_sink_t financial_projection_csv_sink   ( financial_projection_writer_t* writer, financial_write_fxn_t write, void* context );
+financial_projection_sink_t financial_projection_binary_sink( financial_projection_writer_t* writer, financial_write_fxn_t write, void* context );
+
+#ifdef __cplusplus
+} /* extern C Linkage */
+#endif
+#endif /* _WEALTH_PROJECTION_H_ */
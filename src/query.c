@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#ifdef __ANDROID__
+#include <vector.h>
+#else
+#include <libcollections/vector.h>
+#endif
+#include "wealth.h"
+#include "query.h"
+#include "item.h"
+#include "profile.h"
+
+/* Items are filtered a block at a time out of small columnar copies. */
+#define QUERY_BLOCK     (256)
+
+typedef struct query_entry {
+	value_t amount;
+	size_t  index;
+} query_entry_t;
+
+/* True when a ranks below b: a smaller (or larger) amount, or a later index. */
+static inline bool query_worse( const query_entry_t* a, const query_entry_t* b, bool largest )
+{
+	if( a->amount != b->amount )
+	{
+		return largest ? a->amount < b->amount : a->amount > b->amount;
+	}
+	return a->index > b->index;
+}
+
+/* Sifts down a heap whose root is the worst entry kept so far. */
+static void query_sift_down( query_entry_t* heap, size_t count, size_t i, bool largest )
+{
+	query_entry_t entry = heap[ i ];
+
+	for( size_t child = 2 * i + 1; child < count; child = 2 * i + 1 )
+	{
+		if( child + 1 < count && query_worse( &heap[ child + 1 ], &heap[ child ], largest ) )
+		{
+			child += 1;
+		}
+		if( !query_worse( &heap[ child ], &entry, largest ) )
+		{
+			break;
+		}
+		heap[ i ] = heap[ child ];
+		i = child;
+	}
+
+	heap[ i ] = entry;
+}
+
+static void query_columns( const financial_profile_t* profile, financial_item_type_t type, size_t start, size_t n, value_t* amounts, uint32_t* classes )
+{
+	const financial_collection_t* items = &profile->items[ type ];
+
+	for( size_t i = 0; i < n; i++ )
+	{
+		const financial_item_t* item = __financial_collection_at( items, start + i );
+		amounts[ i ] = item->amount;
+
+		switch( type )
+		{
+			case FI_ASSET:
+				classes[ i ] = (uint32_t) ((const financial_asset_t*) item)->asset_class;
+				break;
+			case FI_LIABILITY:
+				classes[ i ] = (uint32_t) ((const financial_liability_t*) item)->liability_class;
+				break;
+			default:
+				classes[ i ] = 0;
+				break;
+		}
+	}
+}
+
+size_t financial_profile_top_items( const financial_profile_t* profile, financial_item_type_t type, size_t k, bool largest, size_t* indices )
+{
+	assert( profile );
+	assert( indices || k == 0 );
+	size_t count = financial_profile_item_count( profile, type );
+	value_t amounts[ QUERY_BLOCK ];
+	uint32_t classes[ QUERY_BLOCK ];
+
+	if( k > count )
+	{
+		k = count;
+	}
+	if( k == 0 )
+	{
+		return 0;
+	}
+
+	query_entry_t* heap = malloc( k * sizeof(query_entry_t) );
+	size_t size = 0;
+
+	if( !heap )
+	{
+		return 0;
+	}
+
+	for( size_t start = 0; start < count; start += QUERY_BLOCK )
+	{
+		size_t n = count - start < QUERY_BLOCK ? count - start : QUERY_BLOCK;
+		query_columns( profile, type, start, n, amounts, classes );
+
+		for( size_t i = 0; i < n; i++ )
+		{
+			query_entry_t entry = { .amount = amounts[ i ], .index = start + i };
+
+			if( size < k )
+			{
+				/* Sift up. */
+				size_t j = size++;
+				while( j > 0 && query_worse( &entry, &heap[ (j - 1) / 2 ], largest ) )
+				{
+					heap[ j ] = heap[ (j - 1) / 2 ];
+					j = (j - 1) / 2;
+				}
+				heap[ j ] = entry;
+			}
+			else if( query_worse( &heap[ 0 ], &entry, largest ) )
+			{
+				heap[ 0 ] = entry;
+				query_sift_down( heap, size, 0, largest );
+			}
+		}
+	}
+
+	/* Popping the worst entry each time fills the output from the back. */
+	for( size_t n = size; n > 0; n-- )
+	{
+		indices[ n - 1 ] = heap[ 0 ].index;
+		heap[ 0 ] = heap[ n - 1 ];
+		query_sift_down( heap, n - 1, 0, largest );
+	}
+
+	free( heap );
+	return size;
+}
+
+size_t financial_profile_filter_items( const financial_profile_t* profile, financial_item_type_t type, const financial_item_filter_t* filter, size_t* indices, size_t capacity )
+{
+	assert( profile );
+	assert( filter );
+	assert( indices || capacity == 0 );
+	size_t count = financial_profile_item_count( profile, type );
+	uint32_t mask = filter->class_mask ? filter->class_mask : UINT32_MAX;
+	value_t min = filter->min_amount;
+	value_t max = filter->max_amount;
+	value_t amounts[ QUERY_BLOCK ];
+	uint32_t classes[ QUERY_BLOCK ];
+	uint8_t matches[ QUERY_BLOCK ];
+	size_t block[ QUERY_BLOCK ];
+	size_t total = 0;
+
+	for( size_t start = 0; start < count; start += QUERY_BLOCK )
+	{
+		size_t n = count - start < QUERY_BLOCK ? count - start : QUERY_BLOCK;
+		size_t found = 0;
+		query_columns( profile, type, start, n, amounts, classes );
+
+		/* No branches here, so the compiler can vectorise the predicate. */
+		for( size_t i = 0; i < n; i++ )
+		{
+			matches[ i ] = (uint8_t) (((mask >> (classes[ i ] & 31)) & 1) &
+			                          (amounts[ i ] >= min) & (amounts[ i ] <= max));
+		}
+
+		for( size_t i = 0; i < n; i++ )
+		{
+			block[ found ] = start + i;
+			found += matches[ i ];
+		}
+
+		if( total < capacity )
+		{
+			size_t room = capacity - total;
+			memcpy( &indices[ total ], block, (found < room ? found : room) * sizeof(size_t) );
+		}
+
+		total += found;
+	}
+
+	return total;
+}
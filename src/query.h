@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _WEALTH_QUERY_H_
+#define _WEALTH_QUERY_H_
+#include "wealth.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Item queries
+ *
+ * Queries answer with indices into a collection and leave its order alone,
+ * so they can run on a profile that is being displayed or shared with
+ * forks. The indices stay valid until items of that type are added,
+ * removed or sorted.
+ *
+ * financial_profile_top_items() writes the indices of the k largest (or
+ * smallest) amounts, best first, into indices[ 0 ... k - 1 ]. Equal amounts
+ * keep collection order. It runs in O(n log k) with a bounded heap and
+ * returns how many indices were written, which is less than k only when
+ * the collection is smaller.
+ */
+size_t financial_profile_top_items( const financial_profile_t* profile, financial_item_type_t type, size_t k, bool largest, size_t* indices );
+
+/*
+ * A filter matches items whose amount lies in [min_amount, max_amount] and
+ * whose class has its bit set in class_mask, e.g. (1 << FA_CASH) |
+ * (1 << FA_MONEY_MARKEY). A class_mask of zero matches every class.
+ * Expenses have no class and match as class zero.
+ *
+ * financial_profile_filter_items() writes the first capacity matches in
+ * collection order and returns the total number of matches, so it can be
+ * called with no buffer to size one.
+ */
+typedef struct financial_item_filter {
+	uint32_t class_mask;
+	value_t  min_amount;
+	value_t  max_amount;
+} financial_item_filter_t;
+
+static inline financial_item_filter_t financial_item_filter_all( void )
+{
+#ifdef WEALTH_FIXED_POINT
+	financial_item_filter_t filter = { 0, INT64_MIN, INT64_MAX };
+#else
+	financial_item_filter_t filter = { 0, -INFINITY, INFINITY };
+#endif
+	return filter;
+}
+
+size_t financial_profile_filter_items( const financial_profile_t* profile, financial_item_type_t type, const financial_item_filter_t* filter, size_t* indices, size_t capacity );
+
+#ifdef __cplusplus
+} /* extern C Linkage */
+#endif
+#endif /* _WEALTH_QUERY_H_ */
@@ -0,0 +1,311 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#ifdef __ANDROID__
+#include <vector.h>
+#else
+#include <libcollections/vector.h>
+#endif
+#include "wealth.h"
+#include "rebalance.h"
+#include "item.h"
+#include "profile.h"
+#include "parallel.h"
+
+/* Profiles handed to a worker at a time by the batch rebalance. */
+#define REBALANCE_BLOCK       (64)
+
+/* How far the target weights may sum away from one. */
+#define REBALANCE_EPSILON     (1e-9)
+
+static bool rebalance_target_valid( const financial_rebalance_target_t* target )
+{
+	double sum = 0.0;
+
+	if( !(target->tolerance >= 0) )
+	{
+		return false;
+	}
+
+	for( size_t i = 0; i < FINANCIAL_ASSET_CLASS_COUNT; i++ )
+	{
+		if( !(target->weights[ i ] >= 0) )
+		{
+			return false;
+		}
+		sum += target->weights[ i ];
+	}
+
+	return fabs( sum - 1.0 ) <= REBALANCE_EPSILON;
+}
+
+/*
+ * Moves `amount` (either sign) into the holdings, split in proportion to how
+ * far each class can still move in that direction before reaching `limits`.
+ * Returns what could not be placed.
+ */
+static double rebalance_spread( double* holdings, const double* limits, double amount )
+{
+	double room[ FINANCIAL_ASSET_CLASS_COUNT ];
+	double total = 0.0;
+
+	for( size_t i = 0; i < FINANCIAL_ASSET_CLASS_COUNT; i++ )
+	{
+		double r = amount > 0 ? limits[ i ] - holdings[ i ] : holdings[ i ] - limits[ i ];
+		room[ i ] = r > 0 ? r : 0.0;
+		total += room[ i ];
+	}
+
+	if( total <= 0 )
+	{
+		return amount;
+	}
+	else if( total <= fabs( amount ) )
+	{
+		for( size_t i = 0; i < FINANCIAL_ASSET_CLASS_COUNT; i++ )
+		{
+			holdings[ i ] = room[ i ] > 0 ? limits[ i ] : holdings[ i ];
+		}
+		return amount > 0 ? amount - total : amount + total;
+	}
+	else
+	{
+		double scale = amount / total;
+
+		for( size_t i = 0; i < FINANCIAL_ASSET_CLASS_COUNT; i++ )
+		{
+			holdings[ i ] += scale * room[ i ];
+		}
+		return 0.0;
+	}
+}
+
+bool financial_rebalance( const double* totals, double cash_flow, const financial_rebalance_target_t* target, financial_rebalance_mode_t mode, financial_rebalance_result_t* result )
+{
+	assert( totals );
+	assert( target );
+	assert( result );
+	double holdings[ FINANCIAL_ASSET_CLASS_COUNT ];
+	double goal[ FINANCIAL_ASSET_CLASS_COUNT ];
+	double current = 0.0;
+
+	for( size_t i = 0; i < FINANCIAL_ASSET_CLASS_COUNT; i++ )
+	{
+		current += totals[ i ];
+	}
+
+	double total = current + cash_flow;
+
+	if( !rebalance_target_valid( target ) || !(total >= 0) )
+	{
+		return false;
+	}
+
+	for( size_t i = 0; i < FINANCIAL_ASSET_CLASS_COUNT; i++ )
+	{
+		result->totals[ i ]  = totals[ i ];
+		result->weights[ i ] = current > 0 ? totals[ i ] / current : 0.0;
+		holdings[ i ] = totals[ i ];
+		goal[ i ]     = target->weights[ i ] * total;
+	}
+
+	if( mode == FR_CASH_FLOW )
+	{
+		/*
+		 * The gaps on the side of the cash flow always add up to at least
+		 * the cash flow, so it is placed entirely in moving towards target.
+		 */
+		double remaining = rebalance_spread( holdings, goal, cash_flow );
+		(void) remaining;
+		assert( fabs( remaining ) <= 1e-6 * (fabs( total ) + fabs( cash_flow ) + 1) );
+	}
+	else
+	{
+		double lower[ FINANCIAL_ASSET_CLASS_COUNT ];
+		double upper[ FINANCIAL_ASSET_CLASS_COUNT ];
+		double placed = 0.0;
+
+		for( size_t i = 0; i < FINANCIAL_ASSET_CLASS_COUNT; i++ )
+		{
+			double lo = (target->weights[ i ] - target->tolerance) * total;
+			double hi = (target->weights[ i ] + target->tolerance) * total;
+
+			lower[ i ] = lo > 0 ? lo : 0.0;
+			upper[ i ] = hi < total ? hi : total;
+
+			if( holdings[ i ] < lower[ i ] )      holdings[ i ] = lower[ i ];
+			else if( holdings[ i ] > upper[ i ] ) holdings[ i ] = upper[ i ];
+
+			placed += holdings[ i ];
+		}
+
+		/*
+		 * Bringing each class to its nearest band edge rarely balances, so
+		 * the difference is spread first towards the target weights and then
+		 * towards the band edges. Every class in the direction of the
+		 * difference is either untraded or trading the same way, so this
+		 * never adds turnover beyond what the difference itself requires.
+		 */
+		double remaining = total - placed;
+
+		if( remaining != 0 )
+		{
+			remaining = rebalance_spread( holdings, goal, remaining );
+			remaining = rebalance_spread( holdings, remaining > 0 ? upper : lower, remaining );
+		}
+	}
+
+	result->turnover = 0.0;
+	result->traded   = false;
+
+	for( size_t i = 0; i < FINANCIAL_ASSET_CLASS_COUNT; i++ )
+	{
+		double trade = holdings[ i ] - totals[ i ];
+
+		result->trades[ i ] = trade;
+		result->turnover   += fabs( trade );
+		result->traded      = result->traded || trade != 0;
+	}
+
+	return true;
+}
+
+void __financial_profile_class_totals( const financial_profile_t* profile, double* totals )
+{
+	const financial_collection_t* assets = &profile->items[ FI_ASSET ];
+
+	financial_currency_t currency = FC_NONE;
+	double rate = 1.0;
+
+	memset( totals, 0, FINANCIAL_ASSET_CLASS_COUNT * sizeof(double) );
+
+	for( size_t i = 0; i < assets->count; i++ )
+	{
+		const financial_asset_t* asset = (const financial_asset_t*) __financial_collection_at( assets, i );
+		size_t cls = (size_t) asset->asset_class;
+
+		/* Holdings are weighed in the profile's currency; one without a rate counts as it. */
+		if( asset->base.currency != currency )
+		{
+			currency = asset->base.currency;
+			if( !financial_profile_fx_rate( profile, currency, &rate ) )
+			{
+				rate = 1.0;
+			}
+		}
+
+		totals[ cls < FINANCIAL_ASSET_CLASS_COUNT ? cls : FA_UNSPECIFIED ] += value_to_double( asset->base.amount ) * rate;
+	}
+}
+
+bool financial_profile_rebalance( const financial_profile_t* profile, double cash_flow, const financial_rebalance_target_t* target, financial_rebalance_mode_t mode, financial_rebalance_result_t* result )
+{
+	assert( profile );
+	double totals[ FINANCIAL_ASSET_CLASS_COUNT ];
+
+	__financial_profile_class_totals( profile, totals );
+	return financial_rebalance( totals, cash_flow, target, mode, result );
+}
+
+typedef struct rebalance_batch_job {
+	const financial_profile_t* const* profiles;
+	const double* cash_flows;
+	size_t count;
+	const financial_rebalance_target_t* target;
+	financial_rebalance_mode_t mode;
+	financial_rebalance_result_t* results;
+	size_t* rebalanced; /* per block */
+} rebalance_batch_job_t;
+
+static size_t rebalance_batch_range( const rebalance_batch_job_t* job, size_t first, size_t last )
+{
+	size_t rebalanced = 0;
+
+	for( size_t i = first; i < last; i++ )
+	{
+		double cash_flow = job->cash_flows ? job->cash_flows[ i ] : 0.0;
+
+		if( financial_profile_rebalance( job->profiles[ i ], cash_flow, job->target, job->mode, &job->results[ i ] ) )
+		{
+			rebalanced += 1;
+		}
+		else
+		{
+			memset( &job->results[ i ], 0, sizeof(financial_rebalance_result_t) );
+		}
+	}
+
+	return rebalanced;
+}
+
+static void rebalance_batch_task( size_t block, size_t worker, void* data )
+{
+	rebalance_batch_job_t* job = data;
+	size_t first = block * REBALANCE_BLOCK;
+	size_t last  = first + REBALANCE_BLOCK < job->count ? first + REBALANCE_BLOCK : job->count;
+
+	job->rebalanced[ block ] = rebalance_batch_range( job, first, last );
+}
+
+size_t financial_profile_rebalance_batch( const financial_profile_t* const* profiles, const double* cash_flows, size_t count,
+                                          const financial_rebalance_target_t* target, financial_rebalance_mode_t mode, financial_rebalance_result_t* results )
+{
+	assert( profiles || count == 0 );
+	assert( target );
+	assert( results || count == 0 );
+	size_t blocks = (count + REBALANCE_BLOCK - 1) / REBALANCE_BLOCK;
+	size_t rebalanced = 0;
+	rebalance_batch_job_t job = {
+		.profiles   = profiles,
+		.cash_flows = cash_flows,
+		.count      = count,
+		.target     = target,
+		.mode       = mode,
+		.results    = results,
+		.rebalanced = NULL
+	};
+
+	if( blocks > 1 && __financial_parallel_workers( blocks ) > 1 )
+	{
+		job.rebalanced = malloc( blocks * sizeof(size_t) );
+	}
+
+	if( job.rebalanced )
+	{
+		__financial_parallel_for( blocks, rebalance_batch_task, &job );
+
+		for( size_t b = 0; b < blocks; b++ )
+		{
+			rebalanced += job.rebalanced[ b ];
+		}
+		free( job.rebalanced );
+	}
+	else
+	{
+		rebalanced = rebalance_batch_range( &job, 0, count );
+	}
+
+	return rebalanced;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _WEALTH_REBALANCE_H_
+#define _WEALTH_REBALANCE_H_
+#include "wealth.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Rebalancing
+ *
+ * Targets give a weight per asset class (indexed by financial_asset_class_t,
+ * summing to one) and an absolute tolerance band around each, so a target
+ * of 0.60 with a tolerance of 0.05 accepts anything from 55% to 65%.
+ *
+ * FR_FULL trades the smallest amount that brings every class inside its
+ * band after the cash flow (positive to invest, negative to withdraw):
+ * classes outside their band go to the nearest edge, and whatever that
+ * leaves over is spread towards the classes furthest from target. When
+ * everything is already inside its band and there is no cash flow, no
+ * trades are made.
+ *
+ * FR_CASH_FLOW never sells to buy. A contribution only buys and a
+ * withdrawal only sells, steered towards the classes furthest from target;
+ * bands are not enforced.
+ *
+ * Trades are positive to buy and negative to sell. A rebalance fails if
+ * the weights are negative or do not sum to one, or if a withdrawal is
+ * larger than the assets.
+ */
+#define FINANCIAL_ASSET_CLASS_COUNT        (FA_COMMODITIES + 1)
+
+typedef enum financial_rebalance_mode {
+	FR_FULL = 0,
+	FR_CASH_FLOW
+} financial_rebalance_mode_t;
+
+typedef struct financial_rebalance_target {
+	double weights[ FINANCIAL_ASSET_CLASS_COUNT ];
+	double tolerance;
+} financial_rebalance_target_t;
+
+typedef struct financial_rebalance_result {
+	double totals[ FINANCIAL_ASSET_CLASS_COUNT ];   /* value per class before trading */
+	double weights[ FINANCIAL_ASSET_CLASS_COUNT ];  /* weight per class before trading */
+	double trades[ FINANCIAL_ASSET_CLASS_COUNT ];
+	double turnover;                                /* total bought plus total sold */
+	bool   traded;                                  /* false if no trade was needed */
+} financial_rebalance_result_t;
+
+bool   financial_rebalance                ( const double* totals, double cash_flow, const financial_rebalance_target_t* target, financial_rebalance_mode_t mode, financial_rebalance_result_t* result );
+bool   financial_profile_rebalance        ( const financial_profile_t* profile, double cash_flow, const financial_rebalance_target_t* target, financial_rebalance_mode_t mode, financial_rebalance_result_t* result );
+
+/*
+ * Rebalances many profiles against one target on the library's worker
+ * threads (see financial_set_parallelism()). cash_flows may be NULL for no
+ * cash flow. Profiles must not be modified while the batch runs. Returns
+ * the number of profiles rebalanced; a profile that fails gets a result
+ * with no trades and traded set to false.
+ */
+size_t financial_profile_rebalance_batch  ( const financial_profile_t* const* profiles, const double* cash_flows, size_t count,
+                                            const financial_rebalance_target_t* target, financial_rebalance_mode_t mode, financial_rebalance_result_t* results );
+
+#ifdef __cplusplus
+} /* extern C Linkage */
+#endif
+#endif /* _WEALTH_REBALANCE_H_ */
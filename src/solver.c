@@ -0,0 +1,300 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+#include "wealth.h"
+#include "solver.h"
+
+#define SOLVER_MAX_ITERATIONS   (100)
+#define SOLVER_MAX_EXPANSIONS   (60)
+#define SOLVER_TOLERANCE        (1e-12)
+
+typedef void (*financial_solve_fxn_t)( double rate, const void* data, double* value, double* slope );
+
+
+static inline double financial_solve_deposit_d( double present, double goal, double rate, double periods )
+{
+	double growth  = pow( 1 + rate, periods );
+	double needed  = goal - present * growth;
+	double factor  = rate == 0 ? periods : (growth - 1) / rate;
+	double deposit = needed / factor;
+
+	/* With no periods left (factor 0) only a goal already met is reachable. */
+	return needed <= 0 ? 0 : (factor > 0 && isfinite( deposit ) ? deposit : INFINITY);
+}
+
+static inline double financial_solve_periods_d( double present, double goal, double deposit, double rate )
+{
+	double result;
+
+	if( present >= goal )
+	{
+		result = 0;
+	}
+	else if( rate == 0 )
+	{
+		result = deposit > 0 ? (goal - present) / deposit : INFINITY;
+	}
+	else
+	{
+		/* (1 + rate)^n = (goal * rate + deposit) / (present * rate + deposit) */
+		double growth = (goal * rate + deposit) / (present * rate + deposit);
+		result = growth > 0 ? log( growth ) / log1p( rate ) : INFINITY;
+		result = isfinite( result ) && result >= 0 ? result : INFINITY;
+	}
+
+	return result;
+}
+
+value_t financial_solve_deposit( value_t present, value_t goal, double rate, double periods )
+{
+	double deposit = financial_solve_deposit_d( value_to_double( present ), value_to_double( goal ), rate, periods );
+
+	/* Checked before converting: llround() of a value out of range is undefined. */
+	return deposit < value_to_double( FINANCIAL_DEPOSIT_UNREACHABLE ) ? value_from_double( deposit ) : FINANCIAL_DEPOSIT_UNREACHABLE;
+}
+
+double financial_solve_periods( value_t present, value_t goal, value_t deposit, double rate )
+{
+	return financial_solve_periods_d( value_to_double( present ), value_to_double( goal ), value_to_double( deposit ), rate );
+}
+
+value_t financial_profile_required_deposit( const financial_profile_t* profile, double rate, double periods )
+{
+	assert( profile );
+	return financial_solve_deposit( financial_profile_net_worth( profile ), financial_profile_goal( profile ), rate, periods );
+}
+
+double financial_profile_periods_to_goal( const financial_profile_t* profile, value_t deposit, double rate )
+{
+	assert( profile );
+	return financial_solve_periods( financial_profile_net_worth( profile ), financial_profile_goal( profile ), deposit, rate );
+}
+
+void financial_solve_deposit_batch( const double* present, const double* goal, const double* rate, const double* periods, double* deposit, size_t count )
+{
+	for( size_t i = 0; i < count; i++ )
+	{
+		deposit[ i ] = financial_solve_deposit_d( present[ i ], goal[ i ], rate[ i ], periods[ i ] );
+	}
+}
+
+void financial_solve_periods_batch( const double* present, const double* goal, const double* deposit, const double* rate, double* periods, size_t count )
+{
+	for( size_t i = 0; i < count; i++ )
+	{
+		periods[ i ] = financial_solve_periods_d( present[ i ], goal[ i ], deposit[ i ], rate[ i ] );
+	}
+}
+
+
+/*
+ * Walks outward from the guess, upward in doubling steps and downward
+ * geometrically toward -100%, until the function changes sign between two
+ * neighbouring samples.
+ */
+static bool financial_solve_bracket( financial_solve_fxn_t fxn, const void* data, double guess, double* lo, double* f_lo, double* hi, double* f_hi )
+{
+	double slope;
+	double up = guess, f_up;
+	double down = guess, f_down;
+
+	fxn( guess, data, &f_up, &slope );
+	if( !isfinite( f_up ) )
+	{
+		return false;
+	}
+	f_down = f_up;
+
+	for( int k = 0; k < SOLVER_MAX_EXPANSIONS; k++ )
+	{
+		double x = guess + 0.05 * ldexp( 1.0, k );
+		double f;
+
+		fxn( x, data, &f, &slope );
+		if( isfinite( f ) )
+		{
+			if( (f < 0) != (f_up < 0) || f == 0 )
+			{
+				*lo = up; *f_lo = f_up;
+				*hi = x;  *f_hi = f;
+				return true;
+			}
+			up = x; f_up = f;
+		}
+
+		x = -1 + (1 + guess) * ldexp( 1.0, -(k + 1) );
+		fxn( x, data, &f, &slope );
+		if( isfinite( f ) )
+		{
+			if( (f < 0) != (f_down < 0) || f == 0 )
+			{
+				*lo = x;    *f_lo = f;
+				*hi = down; *f_hi = f_down;
+				return true;
+			}
+			down = x; f_down = f;
+		}
+	}
+
+	return false;
+}
+
+static bool financial_solve_root( financial_solve_fxn_t fxn, const void* data, double guess, double* root )
+{
+	double lo, f_lo, hi, f_hi;
+
+	if( guess <= -1 || !isfinite( guess ) )
+	{
+		guess = 0.1;
+	}
+
+	if( !financial_solve_bracket( fxn, data, guess, &lo, &f_lo, &hi, &f_hi ) )
+	{
+		return false;
+	}
+
+	if( f_lo == 0 ) { *root = lo; return true; }
+	if( f_hi == 0 ) { *root = hi; return true; }
+
+	double x = 0.5 * (lo + hi);
+
+	for( int i = 0; i < SOLVER_MAX_ITERATIONS; i++ )
+	{
+		double f, slope;
+		fxn( x, data, &f, &slope );
+
+		if( f == 0 )
+		{
+			*root = x;
+			return true;
+		}
+
+		if( (f < 0) == (f_lo < 0) )
+		{
+			lo = x; f_lo = f;
+		}
+		else
+		{
+			hi = x;
+		}
+
+		/* Newton when it stays inside the bracket, bisection otherwise. */
+		double next = x - f / slope;
+		if( slope == 0 || !isfinite( next ) || next <= lo || next >= hi )
+		{
+			next = 0.5 * (lo + hi);
+		}
+
+		if( fabs( next - x ) <= SOLVER_TOLERANCE * (1 + fabs( x )) || hi - lo <= SOLVER_TOLERANCE * (1 + fabs( lo )) )
+		{
+			*root = next;
+			return true;
+		}
+
+		x = next;
+	}
+
+	return false;
+}
+
+
+typedef struct financial_solve_flows {
+	const double* flows;
+	const double* days;
+	size_t        count;
+} financial_solve_flows_t;
+
+/* Horner's rule in x = 1 / (1 + rate), carrying the derivative alongside. */
+static void financial_solve_npv( double rate, const void* data, double* value, double* slope )
+{
+	const financial_solve_flows_t* cf = data;
+	double x  = 1 / (1 + rate);
+	double p  = 0;
+	double dp = 0;
+
+	for( size_t i = cf->count; i > 0; i-- )
+	{
+		dp = dp * x + p;
+		p  = p * x + cf->flows[ i - 1 ];
+	}
+
+	*value = p;
+	*slope = -dp * x * x;
+}
+
+static void financial_solve_xnpv( double rate, const void* data, double* value, double* slope )
+{
+	const financial_solve_flows_t* cf = data;
+	double l  = log1p( rate );
+	double v  = 0;
+	double dv = 0;
+
+	for( size_t i = 0; i < cf->count; i++ )
+	{
+		double t = (cf->days[ i ] - cf->days[ 0 ]) / 365.0;
+		double d = cf->flows[ i ] * exp( -t * l );
+		v  += d;
+		dv -= t * d;
+	}
+
+	*value = v;
+	*slope = dv / (1 + rate);
+}
+
+bool financial_solve_irr( const double* flows, size_t count, double guess, double* rate )
+{
+	assert( flows || count == 0 );
+	assert( rate );
+	financial_solve_flows_t cf = { flows, NULL, count };
+	return count >= 2 && financial_solve_root( financial_solve_npv, &cf, guess, rate );
+}
+
+bool financial_solve_xirr( const double* flows, const double* days, size_t count, double guess, double* rate )
+{
+	assert( flows || count == 0 );
+	assert( days || count == 0 );
+	assert( rate );
+	financial_solve_flows_t cf = { flows, days, count };
+	return count >= 2 && financial_solve_root( financial_solve_xnpv, &cf, guess, rate );
+}
+
+size_t financial_solve_irr_batch( const double* flows, size_t stride, size_t flow_count, size_t count, double* rates )
+{
+	assert( stride >= flow_count );
+	size_t converged = 0;
+
+	for( size_t i = 0; i < count; i++ )
+	{
+		if( financial_solve_irr( flows + i * stride, flow_count, 0.1, &rates[ i ] ) )
+		{
+			converged += 1;
+		}
+		else
+		{
+			rates[ i ] = NAN;
+		}
+	}
+
+	return converged;
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _WEALTH_SOLVER_H_
+#define _WEALTH_SOLVER_H_
+#include <stdint.h>
+#include <math.h>
+#include "wealth.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Goal seeking
+ *
+ * A balance of present that earns rate per period and receives deposit at
+ * the end of every period grows to
+ *
+ *     present * (1 + rate)^n + deposit * ((1 + rate)^n - 1) / rate
+ *
+ * Both inverses of that are closed form: the deposit needed to reach goal
+ * within n periods, and the number of periods needed at a given deposit.
+ * A goal that is already met needs no deposit and zero periods; a goal
+ * that can never be reached reports INFINITY periods. A goal that no
+ * deposit can reach, such as one still unmet with no periods left, needs
+ * FINANCIAL_DEPOSIT_UNREACHABLE, which is also returned when the deposit
+ * is too large to represent as a value_t.
+ */
+#ifdef WEALTH_FIXED_POINT
+# define FINANCIAL_DEPOSIT_UNREACHABLE  ((value_t) INT64_MAX)
+#else
+# define FINANCIAL_DEPOSIT_UNREACHABLE  ((value_t) INFINITY)
+#endif
+
+value_t  financial_solve_deposit          ( value_t present, value_t goal, double rate, double periods );
+double   financial_solve_periods          ( value_t present, value_t goal, value_t deposit, double rate );
+
+value_t  financial_profile_required_deposit( const financial_profile_t* profile, double rate, double periods );
+double   financial_profile_periods_to_goal ( const financial_profile_t* profile, value_t deposit, double rate );
+
+/*
+ * Internal rate of return
+ *
+ * financial_solve_irr() finds the periodic rate at which the net present
+ * value of evenly spaced cash flows is zero; flows[ 0 ] is at time zero.
+ * financial_solve_xirr() does the same for flows on arbitrary days, using
+ * an annual rate and a 365 day year. Both run Newton's method inside a
+ * sign-changing bracket and fall back to bisection whenever a step leaves
+ * the bracket, so they converge whenever the bracket search succeeds.
+ * They return false if no root was found.
+ */
+bool     financial_solve_irr              ( const double* flows, size_t count, double guess, double* rate );
+bool     financial_solve_xirr             ( const double* flows, const double* days, size_t count, double guess, double* rate );
+
+/*
+ * Batch solvers
+ *
+ * Each problem is one index into a set of parallel arrays. Amounts are
+ * plain doubles here so the loops vectorise. Nothing is allocated.
+ *
+ * The deposit batch follows financial_solve_deposit() except that a goal
+ * no deposit can reach gets INFINITY, as unreachable goals do in the
+ * periods batch.
+ *
+ * For the IRR batch, problem i owns flows[ i * stride ... i * stride + count - 1 ].
+ * Problems that have no root get NAN. Returns the number that converged.
+ */
+void     financial_solve_deposit_batch    ( const double* present, const double* goal, const double* rate, const double* periods, double* deposit, size_t count );
+void     financial_solve_periods_batch    ( const double* present, const double* goal, const double* deposit, const double* rate, double* periods, size_t count );
+size_t   financial_solve_irr_batch        ( const double* flows, size_t stride, size_t flow_count, size_t count, double* rates );
+
+#ifdef __cplusplus
+} /* extern C Linkage */
+#endif
+#endif /* _WEALTH_SOLVER_H_ */
@@ -0,0 +1,311 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#ifdef WEALTH_STATS
+#include <pthread.h>
+#endif
+#include "wealth.h"
+#include "stats.h"
+
+static const char* financial_stats_op_names[] = {
+	"refresh",
+	"sort",
+	"item_add",
+	"item_remove",
+	"load",
+	"save",
+};
+
+static const char* financial_stats_counter_names[] = {
+	"refresh_calls",
+	"refresh_clean",
+	"refresh_rescans",
+	"refresh_items_scanned",
+	"items_added",
+	"items_removed",
+	"reallocs",
+	"bytes_loaded",
+	"bytes_saved",
+};
+
+#ifdef WEALTH_STATS
+__thread financial_stats_block_t* __financial_stats_tls = NULL;
+
+/*
+ * Every thread that touches the library owns one block. Live blocks are
+ * linked together so a snapshot can sum them; when a thread exits its block
+ * is folded into the retired totals. A reset records the current totals as
+ * a baseline instead of zeroing blocks that other threads are writing to.
+ * Maxima cannot be rebased, so a reset clears them in every block; a sample
+ * racing the reset may survive it.
+ */
+static pthread_mutex_t           financial_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t            financial_stats_once = PTHREAD_ONCE_INIT;
+static pthread_key_t             financial_stats_key;
+static financial_stats_block_t*  financial_stats_blocks = NULL;
+static financial_profile_stats_t financial_stats_retired;
+static financial_profile_stats_t financial_stats_baseline;
+
+static void financial_stats_accumulate( financial_profile_stats_t* dst, const financial_profile_stats_t* src )
+{
+	for( size_t i = 0; i < FS_COUNTER_COUNT; i++ )
+	{
+		dst->counters[ i ] += __atomic_load_n( &src->counters[ i ], __ATOMIC_RELAXED );
+	}
+
+	for( size_t op = 0; op < FS_OP_COUNT; op++ )
+	{
+		financial_stats_histogram_t* d       = &dst->latency[ op ];
+		const financial_stats_histogram_t* s = &src->latency[ op ];
+		uint64_t max_ns = __atomic_load_n( &s->max_ns, __ATOMIC_RELAXED );
+
+		d->count    += __atomic_load_n( &s->count, __ATOMIC_RELAXED );
+		d->total_ns += __atomic_load_n( &s->total_ns, __ATOMIC_RELAXED );
+		d->max_ns    = max_ns > d->max_ns ? max_ns : d->max_ns;
+
+		for( size_t b = 0; b < FS_HISTOGRAM_BUCKETS; b++ )
+		{
+			d->buckets[ b ] += __atomic_load_n( &s->buckets[ b ], __ATOMIC_RELAXED );
+		}
+	}
+}
+
+static void financial_stats_thread_exit( void* data )
+{
+	financial_stats_block_t* block = data;
+
+	pthread_mutex_lock( &financial_stats_lock );
+	financial_stats_block_t** p = &financial_stats_blocks;
+	while( *p && *p != block )
+	{
+		p = &(*p)->next;
+	}
+	if( *p )
+	{
+		*p = block->next;
+	}
+	financial_stats_accumulate( &financial_stats_retired, &block->stats );
+	pthread_mutex_unlock( &financial_stats_lock );
+
+	free( block );
+}
+
+static void financial_stats_init( void )
+{
+	pthread_key_create( &financial_stats_key, financial_stats_thread_exit );
+}
+
+financial_stats_block_t* __financial_stats_block_create( void )
+{
+	financial_stats_block_t* block = calloc( 1, sizeof(financial_stats_block_t) );
+
+	if( !block )
+	{
+		/* Out of memory; the caller drops its sample and the next one tries again. */
+		return NULL;
+	}
+
+	pthread_once( &financial_stats_once, financial_stats_init );
+	pthread_setspecific( financial_stats_key, block );
+
+	pthread_mutex_lock( &financial_stats_lock );
+	block->next = financial_stats_blocks;
+	financial_stats_blocks = block;
+	pthread_mutex_unlock( &financial_stats_lock );
+
+	__financial_stats_tls = block;
+	return block;
+}
+
+static void financial_stats_total( financial_profile_stats_t* stats )
+{
+	memset( stats, 0, sizeof(*stats) );
+	financial_stats_accumulate( stats, &financial_stats_retired );
+
+	for( financial_stats_block_t* block = financial_stats_blocks; block; block = block->next )
+	{
+		financial_stats_accumulate( stats, &block->stats );
+	}
+}
+
+bool financial_profile_stats_snapshot( financial_profile_stats_t* stats )
+{
+	assert( stats );
+
+	pthread_mutex_lock( &financial_stats_lock );
+	financial_stats_total( stats );
+
+	for( size_t i = 0; i < FS_COUNTER_COUNT; i++ )
+	{
+		stats->counters[ i ] -= financial_stats_baseline.counters[ i ];
+	}
+
+	for( size_t op = 0; op < FS_OP_COUNT; op++ )
+	{
+		financial_stats_histogram_t* h       = &stats->latency[ op ];
+		const financial_stats_histogram_t* b = &financial_stats_baseline.latency[ op ];
+
+		h->count    -= b->count;
+		h->total_ns -= b->total_ns;
+
+		for( size_t i = 0; i < FS_HISTOGRAM_BUCKETS; i++ )
+		{
+			h->buckets[ i ] -= b->buckets[ i ];
+		}
+	}
+	pthread_mutex_unlock( &financial_stats_lock );
+
+	return true;
+}
+
+static void financial_stats_clear_max( financial_profile_stats_t* stats )
+{
+	for( size_t op = 0; op < FS_OP_COUNT; op++ )
+	{
+		__atomic_store_n( &stats->latency[ op ].max_ns, 0, __ATOMIC_RELAXED );
+	}
+}
+
+void financial_profile_stats_reset( void )
+{
+	pthread_mutex_lock( &financial_stats_lock );
+	financial_stats_total( &financial_stats_baseline );
+	financial_stats_clear_max( &financial_stats_retired );
+
+	for( financial_stats_block_t* block = financial_stats_blocks; block; block = block->next )
+	{
+		financial_stats_clear_max( &block->stats );
+	}
+	pthread_mutex_unlock( &financial_stats_lock );
+}
+#else
+bool financial_profile_stats_snapshot( financial_profile_stats_t* stats )
+{
+	assert( stats );
+	memset( stats, 0, sizeof(*stats) );
+	return false;
+}
+
+void financial_profile_stats_reset( void )
+{
+}
+#endif
+
+static uint64_t financial_stats_bucket_lower_bound( size_t index )
+{
+	const size_t sub_buckets = 1u << FS_HISTOGRAM_SUB_BITS;
+
+	if( index < sub_buckets )
+	{
+		return index;
+	}
+	else
+	{
+		size_t magnitude = index >> FS_HISTOGRAM_SUB_BITS;
+		size_t sub       = index & (sub_buckets - 1);
+		return (uint64_t) (sub_buckets + sub) << (magnitude - 1);
+	}
+}
+
+uint64_t financial_profile_stats_percentile( const financial_profile_stats_t* stats, financial_stats_op_t op, double percentile )
+{
+	assert( stats );
+	assert( op < FS_OP_COUNT );
+	const financial_stats_histogram_t* h = &stats->latency[ op ];
+	uint64_t result = 0;
+
+	if( h->count > 0 )
+	{
+		uint64_t rank = (uint64_t) ceil( (percentile / 100.0) * h->count );
+		uint64_t seen = 0;
+
+		if( rank < 1 ) rank = 1;
+
+		for( size_t i = 0; i < FS_HISTOGRAM_BUCKETS; i++ )
+		{
+			seen += h->buckets[ i ];
+			if( seen >= rank )
+			{
+				result = financial_stats_bucket_lower_bound( i );
+				break;
+			}
+		}
+
+		result = result > h->max_ns && h->max_ns > 0 ? h->max_ns : result;
+	}
+
+	return result;
+}
+
+void financial_profile_stats_print( FILE* stream, const financial_profile_stats_t* stats, financial_stats_format_t format )
+{
+	assert( stream );
+	assert( stats );
+
+	if( format == FS_FORMAT_JSON )
+	{
+		fprintf( stream, "{\n  \"counters\": {" );
+		for( size_t i = 0; i < FS_COUNTER_COUNT; i++ )
+		{
+			fprintf( stream, "%s\n    \"%s\": %llu", i ? "," : "", financial_stats_counter_names[ i ], (unsigned long long) stats->counters[ i ] );
+		}
+		fprintf( stream, "\n  },\n  \"latency_ns\": {" );
+		for( size_t op = 0; op < FS_OP_COUNT; op++ )
+		{
+			const financial_stats_histogram_t* h = &stats->latency[ op ];
+			fprintf( stream, "%s\n    \"%s\": { \"count\": %llu, \"mean\": %.1f, \"p50\": %llu, \"p90\": %llu, \"p99\": %llu, \"max\": %llu }",
+			         op ? "," : "", financial_stats_op_names[ op ],
+			         (unsigned long long) h->count,
+			         h->count ? (double) h->total_ns / h->count : 0.0,
+			         (unsigned long long) financial_profile_stats_percentile( stats, op, 50.0 ),
+			         (unsigned long long) financial_profile_stats_percentile( stats, op, 90.0 ),
+			         (unsigned long long) financial_profile_stats_percentile( stats, op, 99.0 ),
+			         (unsigned long long) h->max_ns );
+		}
+		fprintf( stream, "\n  }\n}\n" );
+	}
+	else
+	{
+		for( size_t i = 0; i < FS_COUNTER_COUNT; i++ )
+		{
+			fprintf( stream, "%-24s %llu\n", financial_stats_counter_names[ i ], (unsigned long long) stats->counters[ i ] );
+		}
+
+		fprintf( stream, "\n%-12s %10s %12s %10s %10s %10s %12s\n", "latency(ns)", "count", "mean", "p50", "p90", "p99", "max" );
+		for( size_t op = 0; op < FS_OP_COUNT; op++ )
+		{
+			const financial_stats_histogram_t* h = &stats->latency[ op ];
+			fprintf( stream, "%-12s %10llu %12.1f %10llu %10llu %10llu %12llu\n",
+			         financial_stats_op_names[ op ],
+			         (unsigned long long) h->count,
+			         h->count ? (double) h->total_ns / h->count : 0.0,
+			         (unsigned long long) financial_profile_stats_percentile( stats, op, 50.0 ),
+			         (unsigned long long) financial_profile_stats_percentile( stats, op, 90.0 ),
+			         (unsigned long long) financial_profile_stats_percentile( stats, op, 99.0 ),
+			         (unsigned long long) h->max_ns );
+		}
+	}
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _FINANCIAL_STATS_H_
+#define _FINANCIAL_STATS_H_
+
+/*
+ * Internal instrumentation hooks. Everything here expands to nothing unless
+ * the library is built with WEALTH_STATS.
+ */
+#ifdef WEALTH_STATS
+#include <time.h>
+
+typedef struct financial_stats_block {
+	financial_profile_stats_t     stats;
+	struct financial_stats_block* next;
+} financial_stats_block_t;
+
+extern __thread financial_stats_block_t* __financial_stats_tls;
+
+financial_stats_block_t* __financial_stats_block_create ( void );
+
+static inline financial_stats_block_t* __financial_stats_block( void )
+{
+	financial_stats_block_t* block = __financial_stats_tls;
+	return block ? block : __financial_stats_block_create( );
+}
+
+/* Only the owning thread writes its block; snapshots read it concurrently. */
+static inline void __financial_stats_add( uint64_t* counter, uint64_t n )
+{
+	__atomic_store_n( counter, __atomic_load_n( counter, __ATOMIC_RELAXED ) + n, __ATOMIC_RELAXED );
+}
+
+static inline uint64_t __financial_stats_now( void )
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+static inline size_t __financial_stats_bucket( uint64_t ns )
+{
+	if( ns < (1u << FS_HISTOGRAM_SUB_BITS) )
+	{
+		return (size_t) ns;
+	}
+	else
+	{
+		unsigned msb   = 63 - __builtin_clzll( ns );
+		unsigned shift = msb - FS_HISTOGRAM_SUB_BITS;
+		size_t index   = ((size_t) (msb - FS_HISTOGRAM_SUB_BITS + 1) << FS_HISTOGRAM_SUB_BITS) +
+		                 (size_t) ((ns >> shift) & ((1u << FS_HISTOGRAM_SUB_BITS) - 1));
+		return index < FS_HISTOGRAM_BUCKETS ? index : FS_HISTOGRAM_BUCKETS - 1;
+	}
+}
+
+/* A thread without a block, because it could not be allocated, drops its samples. */
+static inline void __financial_stats_count( financial_stats_counter_t counter, uint64_t n )
+{
+	financial_stats_block_t* block = __financial_stats_block( );
+	if( block )
+	{
+		__financial_stats_add( &block->stats.counters[ counter ], n );
+	}
+}
+
+static inline void __financial_stats_record( financial_stats_op_t op, uint64_t ns )
+{
+	financial_stats_block_t* block = __financial_stats_block( );
+	if( block )
+	{
+		financial_stats_histogram_t* h = &block->stats.latency[ op ];
+		__financial_stats_add( &h->count, 1 );
+		__financial_stats_add( &h->total_ns, ns );
+		__financial_stats_add( &h->buckets[ __financial_stats_bucket( ns ) ], 1 );
+		if( ns > __atomic_load_n( &h->max_ns, __ATOMIC_RELAXED ) )
+		{
+			__atomic_store_n( &h->max_ns, ns, __ATOMIC_RELAXED );
+		}
+	}
+}
+
+# define STATS_COUNT(counter, n)        __financial_stats_count( (counter), (n) )
+# define STATS_TIMER_BEGIN(timer)       uint64_t timer = __financial_stats_now( )
+# define STATS_TIMER_END(op, timer)     __financial_stats_record( (op), __financial_stats_now( ) - (timer) )
+#else
+# define STATS_COUNT(counter, n)
+# define STATS_TIMER_BEGIN(timer)
+# define STATS_TIMER_END(op, timer)
+#endif
+
+#endif /* _FINANCIAL_STATS_H_ */
@@ -0,0 +1,674 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#include <sys/types.h>
+#include <unistd.h>
+#ifdef __ANDROID__
+#include <vector.h>
+#else
+#include <libcollections/vector.h>
+#endif
+#include "wealth.h"
+#include "store.h"
+#include "buffer.h"
+
+/*
+ * Store layout
+ *
+ * Page 0 holds the superblock. Every record starts on a page boundary with
+ * its ID and length, followed by the encoded profile, and owns whole pages.
+ * The index is a record of its own: the IDs in ascending order as varint
+ * gaps, each with its first page and page count. Free space is not stored;
+ * it is whatever the index and the records leave uncovered.
+ */
+#define STORE_PAGE_SIZE     (4096)
+#define STORE_VERSION       (1)
+#define STORE_EMPTY         (0)
+#define STORE_USED          (1)
+#define STORE_DELETED       (2)
+
+static const uint8_t STORE_IDENTIFIER[] = { 'F', 'P', 'S', '\0' };
+
+typedef struct financial_store_superblock {
+	uint8_t  identifier[ 4 ];
+	uint32_t version;
+	uint32_t page_size;
+	uint32_t codec;
+	uint64_t page_count;
+	uint64_t record_count;
+	uint64_t index_page;
+	uint64_t index_pages;
+	uint64_t index_length;
+} financial_store_superblock_t;
+
+typedef struct financial_store_record_header {
+	uint64_t id;
+	uint64_t length;
+} financial_store_record_header_t;
+
+typedef struct financial_store_entry {
+	uint64_t id;
+	uint64_t page;
+	uint32_t pages;
+	uint32_t state;
+} financial_store_entry_t;
+
+typedef struct financial_store_extent {
+	uint64_t page;
+	uint64_t pages;
+} financial_store_extent_t;
+
+struct financial_store {
+	FILE*                     file;
+	financial_profile_codec_t codec;
+	uint64_t                  page_count;
+	financial_store_extent_t  index;
+
+	financial_store_entry_t*  table;    /* open addressing, power of two */
+	size_t                    capacity;
+	size_t                    count;
+	size_t                    used;     /* count plus deleted slots */
+
+	financial_store_extent_t* free_space;  /* sorted by page, coalesced */
+	financial_store_extent_t* pending;     /* freed since the last sync */
+};
+
+
+static inline size_t store_hash( uint64_t id )
+{
+	id ^= id >> 30; id *= 0xbf58476d1ce4e5b9ULL; /* splitmix64 finalizer */
+	id ^= id >> 27; id *= 0x94d049bb133111ebULL;
+	id ^= id >> 31;
+	return (size_t) id;
+}
+
+static inline uint64_t store_pages( uint64_t bytes )
+{
+	return (bytes + STORE_PAGE_SIZE - 1) / STORE_PAGE_SIZE;
+}
+
+static size_t store_find( const financial_store_t* store, uint64_t id )
+{
+	size_t mask = store->capacity - 1;
+
+	for( size_t s = store_hash( id ) & mask; store->table[ s ].state != STORE_EMPTY; s = (s + 1) & mask )
+	{
+		if( store->table[ s ].state == STORE_USED && store->table[ s ].id == id )
+		{
+			return s;
+		}
+	}
+
+	return (size_t) -1;
+}
+
+static bool store_rehash( financial_store_t* store, size_t capacity )
+{
+	financial_store_entry_t* table = calloc( capacity, sizeof(financial_store_entry_t) );
+
+	if( !table )
+	{
+		return false;
+	}
+
+	for( size_t i = 0; i < store->capacity; i++ )
+	{
+		if( store->table[ i ].state == STORE_USED )
+		{
+			size_t s = store_hash( store->table[ i ].id ) & (capacity - 1);
+			while( table[ s ].state != STORE_EMPTY )
+			{
+				s = (s + 1) & (capacity - 1);
+			}
+			table[ s ] = store->table[ i ];
+		}
+	}
+
+	free( store->table );
+	store->table    = table;
+	store->capacity = capacity;
+	store->used     = store->count;
+	return true;
+}
+
+static bool store_insert( financial_store_t* store, uint64_t id, financial_store_extent_t extent )
+{
+	if( (store->used + 1) * 4 > store->capacity * 3 &&
+	    !store_rehash( store, store->count * 2 >= store->capacity / 2 ? store->capacity * 2 : store->capacity ) )
+	{
+		return false;
+	}
+
+	size_t s = store_hash( id ) & (store->capacity - 1);
+	while( store->table[ s ].state == STORE_USED )
+	{
+		s = (s + 1) & (store->capacity - 1);
+	}
+
+	store->used += store->table[ s ].state == STORE_EMPTY;
+	store->count += 1;
+	store->table[ s ].id    = id;
+	store->table[ s ].page  = extent.page;
+	store->table[ s ].pages = (uint32_t) extent.pages;
+	store->table[ s ].state = STORE_USED;
+	return true;
+}
+
+/* Adds an extent to a sorted list, merging it with adjacent ones. */
+static void store_extent_add( financial_store_extent_t** list, financial_store_extent_t extent )
+{
+	financial_store_extent_t* extents = *list;
+	size_t count = vector_size( extents );
+	size_t i = 0;
+
+	if( extent.pages == 0 )
+	{
+		return;
+	}
+
+	while( i < count && extents[ i ].page < extent.page )
+	{
+		i += 1;
+	}
+
+	if( i > 0 && extents[ i - 1 ].page + extents[ i - 1 ].pages == extent.page )
+	{
+		extents[ i - 1 ].pages += extent.pages;
+		if( i < count && extents[ i - 1 ].page + extents[ i - 1 ].pages == extents[ i ].page )
+		{
+			extents[ i - 1 ].pages += extents[ i ].pages;
+			memmove( &extents[ i ], &extents[ i + 1 ], (count - i - 1) * sizeof(*extents) );
+			vector_pop( extents );
+		}
+	}
+	else if( i < count && extent.page + extent.pages == extents[ i ].page )
+	{
+		extents[ i ].page   = extent.page;
+		extents[ i ].pages += extent.pages;
+	}
+	else
+	{
+		vector_push_emplace( extents );
+		memmove( &extents[ i + 1 ], &extents[ i ], (count - i) * sizeof(*extents) );
+		extents[ i ] = extent;
+	}
+
+	*list = extents;
+}
+
+/* First fit from the free space, or new pages at the end of the file. */
+static financial_store_extent_t store_allocate( financial_store_t* store, uint64_t pages )
+{
+	financial_store_extent_t result = { .page = store->page_count, .pages = pages };
+	size_t count = vector_size( store->free_space );
+
+	for( size_t i = 0; i < count; i++ )
+	{
+		financial_store_extent_t* extent = &store->free_space[ i ];
+
+		if( extent->pages >= pages )
+		{
+			result.page    = extent->page;
+			extent->page  += pages;
+			extent->pages -= pages;
+
+			if( extent->pages == 0 )
+			{
+				memmove( extent, extent + 1, (count - i - 1) * sizeof(*extent) );
+				vector_pop( store->free_space );
+			}
+			return result;
+		}
+	}
+
+	store->page_count += pages;
+	return result;
+}
+
+static bool store_write( financial_store_t* store, uint64_t page, const void* data, size_t size )
+{
+	return fseeko( store->file, (off_t) (page * STORE_PAGE_SIZE), SEEK_SET ) == 0 &&
+	       fwrite( data, 1, size, store->file ) == size;
+}
+
+static bool store_read( financial_store_t* store, uint64_t page, void* data, size_t size )
+{
+	return fseeko( store->file, (off_t) (page * STORE_PAGE_SIZE), SEEK_SET ) == 0 &&
+	       fread( data, 1, size, store->file ) == size;
+}
+
+static int store_entry_compare( const void* l, const void* r )
+{
+	const financial_store_entry_t* left  = l;
+	const financial_store_entry_t* right = r;
+	return (left->id > right->id) - (left->id < right->id);
+}
+
+static int store_extent_compare( const void* l, const void* r )
+{
+	const financial_store_extent_t* left  = l;
+	const financial_store_extent_t* right = r;
+	return (left->page > right->page) - (left->page < right->page);
+}
+
+/* Live entries, copied out of the table in ascending ID order. */
+static financial_store_entry_t* store_sorted_entries( const financial_store_t* store )
+{
+	financial_store_entry_t* entries = malloc( (store->count ? store->count : 1) * sizeof(financial_store_entry_t) );
+
+	if( entries )
+	{
+		size_t n = 0;
+		for( size_t i = 0; i < store->capacity; i++ )
+		{
+			if( store->table[ i ].state == STORE_USED )
+			{
+				entries[ n++ ] = store->table[ i ];
+			}
+		}
+		qsort( entries, n, sizeof(*entries), store_entry_compare );
+	}
+
+	return entries;
+}
+
+static bool store_load_index( financial_store_t* store, const financial_store_superblock_t* superblock )
+{
+	bool result = false;
+	uint8_t* data = NULL;
+	financial_store_extent_t* used = NULL;
+
+	/* The index must lie inside the file and its length inside its pages. */
+	if( superblock->index_pages > superblock->page_count ||
+	    superblock->index_page > superblock->page_count - superblock->index_pages ||
+	    (superblock->index_pages == 0 && superblock->index_length > 0) ||
+	    (superblock->index_length > 0 && (superblock->index_length - 1) / STORE_PAGE_SIZE >= superblock->index_pages) )
+	{
+		goto done;
+	}
+
+	if( superblock->index_pages > 0 )
+	{
+		data = malloc( superblock->index_length ? superblock->index_length : 1 );
+		if( !data || !store_read( store, superblock->index_page, data, superblock->index_length ) )
+		{
+			goto done;
+		}
+	}
+
+	financial_reader_t reader = { .p = data, .end = data + superblock->index_length, .ok = true };
+	uint64_t count = superblock->index_pages > 0 ? reader_get_varint( &reader ) : 0;
+
+	/* Every entry takes at least three bytes, so a larger count is corrupt. */
+	if( !reader.ok || count != superblock->record_count || count > (uint64_t) (reader.end - reader.p) / 3 )
+	{
+		goto done;
+	}
+
+	vector_create( used, count + 1 );
+	uint64_t id = 0;
+
+	for( uint64_t i = 0; i < count && reader.ok; i++ )
+	{
+		financial_store_extent_t extent;
+		id          += reader_get_varint( &reader ) + (i > 0);
+		extent.page  = reader_get_varint( &reader );
+		extent.pages = reader_get_varint( &reader );
+
+		if( extent.page == 0 || extent.pages == 0 || extent.page >= superblock->page_count ||
+		    extent.pages > superblock->page_count - extent.page ||
+		    !store_insert( store, id, extent ) )
+		{
+			goto done;
+		}
+
+		vector_push( used, extent );
+	}
+
+	if( !reader.ok || reader.p != reader.end )
+	{
+		goto done;
+	}
+
+	/* Whatever the records and the index do not cover is free. */
+	store->index.page  = superblock->index_page;
+	store->index.pages = superblock->index_pages;
+	if( store->index.pages > 0 )
+	{
+		vector_push( used, store->index );
+	}
+
+	qsort( used, vector_size( used ), sizeof(*used), store_extent_compare );
+
+	uint64_t next = 1;
+	for( size_t i = 0; i < vector_size( used ); i++ )
+	{
+		if( used[ i ].page < next )
+		{
+			goto done; /* overlapping records */
+		}
+
+		financial_store_extent_t gap = { .page = next, .pages = used[ i ].page - next };
+		store_extent_add( &store->free_space, gap );
+		next = used[ i ].page + used[ i ].pages;
+	}
+
+	financial_store_extent_t tail = { .page = next, .pages = superblock->page_count - next };
+	store_extent_add( &store->free_space, tail );
+	result = true;
+
+done:
+	if( used ) vector_destroy( used );
+	free( data );
+	return result;
+}
+
+
+financial_store_t* financial_store_open( const char* filename, financial_profile_codec_t codec )
+{
+	assert( filename );
+	financial_store_t* store = calloc( 1, sizeof(financial_store_t) );
+
+	if( !store )
+	{
+		return NULL;
+	}
+
+	store->codec    = codec;
+	store->capacity = 64;
+	store->table    = calloc( store->capacity, sizeof(financial_store_entry_t) );
+	vector_create( store->free_space, 16 );
+	vector_create( store->pending, 16 );
+	store->file = fopen( filename, "r+b" );
+
+	if( !store->table )
+	{
+		goto failed;
+	}
+
+	if( store->file )
+	{
+		financial_store_superblock_t superblock;
+
+		if( fread( &superblock, sizeof(superblock), 1, store->file ) != 1 ||
+		    memcmp( superblock.identifier, STORE_IDENTIFIER, sizeof(STORE_IDENTIFIER) ) != 0 ||
+		    superblock.version != STORE_VERSION || superblock.page_size != STORE_PAGE_SIZE ||
+		    superblock.page_count == 0 )
+		{
+			goto failed;
+		}
+
+		store->page_count = superblock.page_count;
+
+		if( !store_load_index( store, &superblock ) )
+		{
+			goto failed;
+		}
+	}
+	else
+	{
+		store->file = fopen( filename, "w+b" );
+		store->page_count = 1;
+
+		if( !store->file || !financial_store_sync( store ) )
+		{
+			goto failed;
+		}
+	}
+
+	return store;
+
+failed:
+	if( store->file ) fclose( store->file );
+	store->file = NULL;
+	financial_store_close( &store );
+	return NULL;
+}
+
+bool financial_store_close( financial_store_t** p_store )
+{
+	bool result = true;
+
+	if( p_store && *p_store )
+	{
+		financial_store_t* store = *p_store;
+
+		if( store->file )
+		{
+			result = financial_store_sync( store );
+			result = fclose( store->file ) == 0 && result;
+		}
+
+		free( store->table );
+		vector_destroy( store->free_space );
+		vector_destroy( store->pending );
+		free( store );
+		*p_store = NULL;
+	}
+
+	return result;
+}
+
+/*
+ * The new index goes into free space, then the superblock is rewritten to
+ * point at it. Only once that is on disk are the old index pages and the
+ * pages released since the last sync free to reuse.
+ */
+bool financial_store_sync( financial_store_t* store )
+{
+	assert( store );
+	financial_buffer_t index = { .data = NULL, .size = 0, .capacity = 0, .ok = true };
+	financial_store_entry_t* entries = store_sorted_entries( store );
+	financial_store_extent_t extent = { .page = 0, .pages = 0 };
+	bool result = false;
+
+	if( !entries )
+	{
+		goto done;
+	}
+
+	buffer_put_varint( &index, store->count );
+	for( size_t i = 0; i < store->count; i++ )
+	{
+		buffer_put_varint( &index, i > 0 ? entries[ i ].id - entries[ i - 1 ].id - 1 : entries[ i ].id );
+		buffer_put_varint( &index, entries[ i ].page );
+		buffer_put_varint( &index, entries[ i ].pages );
+	}
+
+	if( !index.ok )
+	{
+		goto done;
+	}
+
+	extent = store_allocate( store, store_pages( index.size ) );
+
+	financial_store_superblock_t superblock = {
+		.version      = STORE_VERSION,
+		.page_size    = STORE_PAGE_SIZE,
+		.codec        = (uint32_t) store->codec,
+		.page_count   = store->page_count,
+		.record_count = store->count,
+		.index_page   = extent.page,
+		.index_pages  = extent.pages,
+		.index_length = index.size
+	};
+	memcpy( superblock.identifier, STORE_IDENTIFIER, sizeof(STORE_IDENTIFIER) );
+
+	if( !store_write( store, extent.page, index.data, index.size ) || fflush( store->file ) != 0 ||
+	    !store_write( store, 0, &superblock, sizeof(superblock) ) || fflush( store->file ) != 0 ||
+	    fsync( fileno( store->file ) ) != 0 )
+	{
+		store_extent_add( &store->free_space, extent );
+		goto done;
+	}
+
+	store_extent_add( &store->free_space, store->index );
+	for( size_t i = 0; i < vector_size( store->pending ); i++ )
+	{
+		store_extent_add( &store->free_space, store->pending[ i ] );
+	}
+	vector_clear( store->pending );
+	store->index = extent;
+	result = true;
+
+done:
+	free( index.data );
+	free( entries );
+	return result;
+}
+
+size_t financial_store_count( const financial_store_t* store )
+{
+	assert( store );
+	return store->count;
+}
+
+bool financial_store_contains( const financial_store_t* store, uint64_t id )
+{
+	assert( store );
+	return store_find( store, id ) != (size_t) -1;
+}
+
+bool financial_store_put( financial_store_t* store, uint64_t id, const financial_profile_t* profile )
+{
+	assert( store );
+	assert( profile );
+	uint8_t* data = NULL;
+	size_t size = 0;
+	bool result = false;
+
+	if( !financial_profile_encode( profile, store->codec, &data, &size ) )
+	{
+		return false;
+	}
+
+	financial_store_record_header_t header = { .id = id, .length = size };
+	uint64_t pages = store_pages( sizeof(header) + size );
+	financial_store_extent_t extent = store_allocate( store, pages );
+
+	if( pages > UINT32_MAX ||
+	    !store_write( store, extent.page, &header, sizeof(header) ) ||
+	    fwrite( data, 1, size, store->file ) != size )
+	{
+		store_extent_add( &store->free_space, extent );
+		goto done;
+	}
+
+	size_t s = store_find( store, id );
+
+	if( s != (size_t) -1 )
+	{
+		financial_store_extent_t old = { .page = store->table[ s ].page, .pages = store->table[ s ].pages };
+		store_extent_add( &store->pending, old );
+		store->table[ s ].page  = extent.page;
+		store->table[ s ].pages = (uint32_t) extent.pages;
+		result = true;
+	}
+	else
+	{
+		result = store_insert( store, id, extent );
+		if( !result )
+		{
+			store_extent_add( &store->free_space, extent );
+		}
+	}
+
+done:
+	free( data );
+	return result;
+}
+
+financial_profile_t* financial_store_get( financial_store_t* store, uint64_t id )
+{
+	assert( store );
+	size_t s = store_find( store, id );
+	financial_profile_t* profile = NULL;
+	financial_store_record_header_t header;
+
+	if( s != (size_t) -1 &&
+	    store_read( store, store->table[ s ].page, &header, sizeof(header) ) &&
+	    header.id == id && sizeof(header) + header.length <= (uint64_t) store->table[ s ].pages * STORE_PAGE_SIZE )
+	{
+		uint8_t* data = malloc( header.length ? header.length : 1 );
+
+		if( data && fread( data, 1, header.length, store->file ) == header.length )
+		{
+			profile = financial_profile_decode( data, header.length );
+		}
+
+		free( data );
+	}
+
+	return profile;
+}
+
+bool financial_store_remove( financial_store_t* store, uint64_t id )
+{
+	assert( store );
+	size_t s = store_find( store, id );
+
+	if( s == (size_t) -1 )
+	{
+		return false;
+	}
+
+	financial_store_extent_t old = { .page = store->table[ s ].page, .pages = store->table[ s ].pages };
+	store_extent_add( &store->pending, old );
+	store->table[ s ].state = STORE_DELETED;
+	store->count -= 1;
+	return true;
+}
+
+bool financial_store_foreach( financial_store_t* store, financial_store_visit_fxn_t visit, void* data )
+{
+	assert( store );
+	assert( visit );
+	financial_store_entry_t* entries = store_sorted_entries( store );
+	size_t count = store->count;
+	bool result = entries != NULL;
+
+	for( size_t i = 0; result && i < count; i++ )
+	{
+		financial_profile_t* profile = financial_store_get( store, entries[ i ].id );
+
+		if( !profile )
+		{
+			result = false;
+			break;
+		}
+
+		bool more = visit( entries[ i ].id, profile, data );
+		financial_profile_destroy( &profile );
+
+		if( !more )
+		{
+			break;
+		}
+	}
+
+	free( entries );
+	return result;
+}
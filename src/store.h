@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _WEALTH_STORE_H_
+#define _WEALTH_STORE_H_
+#include "wealth.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Profile store
+ *
+ * Many profiles kept in one file, each under a 64-bit ID. Profiles are
+ * saved with the compressed encoding in page-aligned records, and space
+ * freed by replaced or removed profiles is reused. The ID index is held in
+ * a hash table in memory, so any profile is found without touching the
+ * others, and is written to the file by financial_store_sync() and
+ * financial_store_close().
+ *
+ * Until a sync the file still describes the previous state: space freed
+ * since then is not reused, so a crash loses unsynced changes but leaves
+ * the store readable. A store must not be used from several threads or
+ * opened by several processes at once.
+ */
+struct financial_store;
+typedef struct financial_store financial_store_t;
+
+typedef bool (*financial_store_visit_fxn_t)( uint64_t id, financial_profile_t* profile, void* data );
+
+financial_store_t*   financial_store_open     ( const char* filename, financial_profile_codec_t codec );
+bool                 financial_store_close    ( financial_store_t** store );
+bool                 financial_store_sync     ( financial_store_t* store );
+size_t               financial_store_count    ( const financial_store_t* store );
+bool                 financial_store_contains ( const financial_store_t* store, uint64_t id );
+bool                 financial_store_put      ( financial_store_t* store, uint64_t id, const financial_profile_t* profile );
+financial_profile_t* financial_store_get      ( financial_store_t* store, uint64_t id );
+bool                 financial_store_remove   ( financial_store_t* store, uint64_t id );
+
+/*
+ * Visits every profile in ascending ID order until the visitor returns
+ * false. Each profile is destroyed when its visitor returns. Returns false
+ * if a profile could not be read.
+ */
+bool                 financial_store_foreach  ( financial_store_t* store, financial_store_visit_fxn_t visit, void* data );
+
+#ifdef __cplusplus
+} /* extern C Linkage */
+#endif
+#endif /* _WEALTH_STORE_H_ */
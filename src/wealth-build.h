@@ -0,0 +1,20 @@
+/* src/wealth-build.h.  Generated from wealth-build.h.in by configure. */
+/*
+ * Installed next to wealth.h, so programs using the library see the
+ * value_t it was built with. The copy in the source tree is for builds
+ * without configure; define WEALTH_FIXED_POINT by hand in those.
+ */
+#ifndef _WEALTH_BUILD_H_
+#define _WEALTH_BUILD_H_
+
+/* Amounts are 64-bit integer minor units instead of doubles. */
+#ifndef WEALTH_FIXED_POINT
+/* #undef WEALTH_FIXED_POINT */
+#endif
+
+/* Minor units per currency unit in fixed point builds. */
+#ifndef WEALTH_MONEY_SCALE
+#define WEALTH_MONEY_SCALE  (100)
+#endif
+
+#endif /* _WEALTH_BUILD_H_ */
@@ -19,11 +19,112 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  * THE SOFTWARE.
  */
+#define _POSIX_C_SOURCE 200809L
 #include <stddef.h>
 #include <stdlib.h>
 #include <math.h>
 #include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
 #include "wealth.h"
+#include "parallel.h"
+
+#define FINANCIAL_DEFAULT_SERIAL_THRESHOLD     (1 << 16)
+#define FINANCIAL_MAX_THREADS                  (256)
+
+static size_t financial_threads          = 0; /* 0 means one per online CPU */
+static size_t financial_serial_threshold = FINANCIAL_DEFAULT_SERIAL_THRESHOLD;
+
+void financial_set_parallelism( size_t threads, size_t serial_threshold )
+{
+	financial_threads          = threads > FINANCIAL_MAX_THREADS ? FINANCIAL_MAX_THREADS : threads;
+	financial_serial_threshold = serial_threshold;
+}
+
+size_t financial_thread_count( void )
+{
+	size_t threads = financial_threads;
+
+	if( threads == 0 )
+	{
+		long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+		threads = cpus > 0 ? (size_t) cpus : 1;
+		threads = threads > FINANCIAL_MAX_THREADS ? FINANCIAL_MAX_THREADS : threads;
+	}
+
+	return threads;
+}
+
+size_t __financial_serial_threshold( void )
+{
+	return financial_serial_threshold;
+}
+
+
+typedef struct financial_parallel_job {
+	financial_task_fxn_t task;
+	void*                data;
+	size_t               count;
+	size_t               next; /* claimed atomically */
+} financial_parallel_job_t;
+
+typedef struct financial_parallel_worker {
+	financial_parallel_job_t* job;
+	size_t                    index;
+} financial_parallel_worker_t;
+
+static void financial_parallel_run( financial_parallel_job_t* job, size_t worker )
+{
+	size_t task;
+
+	while( (task = __atomic_fetch_add( &job->next, 1, __ATOMIC_RELAXED )) < job->count )
+	{
+		job->task( task, worker, job->data );
+	}
+}
+
+static void* financial_parallel_thread( void* data )
+{
+	financial_parallel_worker_t* worker = data;
+	financial_parallel_run( worker->job, worker->index );
+	return NULL;
+}
+
+size_t __financial_parallel_workers( size_t count )
+{
+	size_t threads = financial_thread_count( );
+	return count < threads ? (count ? count : 1) : threads;
+}
+
+void __financial_parallel_for( size_t count, financial_task_fxn_t task, void* data )
+{
+	financial_parallel_job_t job = { .task = task, .data = data, .count = count, .next = 0 };
+	size_t workers = __financial_parallel_workers( count );
+	pthread_t threads[ FINANCIAL_MAX_THREADS ];
+	financial_parallel_worker_t args[ FINANCIAL_MAX_THREADS ];
+	size_t started = 0;
+
+	for( size_t i = 1; i < workers; i++ )
+	{
+		args[ started ].job   = &job;
+		args[ started ].index = i;
+
+		if( pthread_create( &threads[ started ], NULL, financial_parallel_thread, &args[ started ] ) != 0 )
+		{
+			/* The threads we did get (and this one) pick up the slack. */
+			break;
+		}
+
+		started += 1;
+	}
+
+	financial_parallel_run( &job, 0 );
+
+	for( size_t i = 0; i < started; i++ )
+	{
+		pthread_join( threads[ i ], NULL );
+	}
+}
 
 
 
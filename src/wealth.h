@@ -24,7 +24,8 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <math.h>
-#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 199901L)
+#include "wealth-build.h"
+#if defined(__cplusplus) || (defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 199901L))
 # include <stdbool.h>
 # include <stdint.h>
 #else
@@ -32,21 +33,54 @@
   typedef unsigned char  uint8_t;
   typedef unsigned short uint16_t;
   typedef unsigned int   uint32_t;
+  typedef long long      int64_t;
+  typedef unsigned long long uint64_t;
 #endif
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/*
+ * Amounts are doubles by default. Building with WEALTH_FIXED_POINT
+ * (configure --enable-fixed-point) makes them 64-bit integers counting
+ * 1/WEALTH_MONEY_SCALE units (cents by default), which keeps sums exact.
+ * configure records both in wealth-build.h, so applications pick up the
+ * library's choice by including this header.
+ */
+#ifdef WEALTH_FIXED_POINT
+typedef int64_t value_t;
+#else
 typedef double value_t;
+#endif
 typedef uint16_t flags_t;
 typedef char desc_short_t[64];
 typedef char desc_medium_t[256];
 typedef char desc_long_t[1024];
 
+static inline value_t value_from_double( double amount )
+{
+#ifdef WEALTH_FIXED_POINT
+	return (value_t) llround( amount * WEALTH_MONEY_SCALE );
+#else
+	return amount;
+#endif
+}
+
+static inline double value_to_double( value_t amount )
+{
+#ifdef WEALTH_FIXED_POINT
+	return (double) amount / WEALTH_MONEY_SCALE;
+#else
+	return amount;
+#endif
+}
+
 #define FP_FLAG_ASSETS_DIRTY                (1 << 0)
 #define FP_FLAG_LIABILITIES_DIRTY           (1 << 1)
 #define FP_FLAG_MONTHLY_EXPENSES_DIRTY      (1 << 2)
 #define FP_FLAG_INCOME_DIRTY                (1 << 3)
+#define FP_FLAG_ALL                         (FP_FLAG_ASSETS_DIRTY | FP_FLAG_LIABILITIES_DIRTY | \
+                                             FP_FLAG_MONTHLY_EXPENSES_DIRTY | FP_FLAG_INCOME_DIRTY)
 
 
 struct financial_item;
@@ -122,9 +156,53 @@ typedef struct financial_profile financial_profile_t;
 
 financial_profile_t* financial_profile_create( void );
 void                 financial_profile_destroy( financial_profile_t** profile );
+/*
+ * A fork starts as a logically independent copy of its parent, totals
+ * included, that shares the parent's items chunk by chunk. Either side
+ * copies a chunk the first time it modifies an item in it or hands one out
+ * with item_get or item_span, so a fork only costs the chunks it touches.
+ * Forking invalidates the parent's item pointers and spans for writing:
+ * writes through them would reach the fork, so take them again.
+ * Listeners are not inherited.
+ */
+financial_profile_t* financial_profile_fork( financial_profile_t* parent );
 financial_profile_t* financial_profile_load( const char* filename );
 bool                 financial_profile_save( const financial_profile_t* profile, const char* filename );
 
+/*
+ * Compressed encoding
+ *
+ * Stores descriptions front coded, classes bit packed and amounts as delta
+ * or XOR columns instead of raw structs, optionally deflated as well when
+ * the library is built with zlib. financial_profile_load() recognises
+ * compressed files. Encoded buffers are released with free().
+ */
+typedef enum financial_profile_codec {
+	FP_CODEC_NONE = 0,
+	FP_CODEC_ZLIB
+} financial_profile_codec_t;
+
+bool                 financial_profile_encode          ( const financial_profile_t* profile, financial_profile_codec_t codec, uint8_t** data, size_t* size );
+financial_profile_t* financial_profile_decode          ( const uint8_t* data, size_t size );
+bool                 financial_profile_save_compressed ( const financial_profile_t* profile, const char* filename, financial_profile_codec_t codec );
+
+/*
+ * Patches
+ *
+ * financial_profile_diff() encodes what turns profile a into profile b:
+ * changed goal, income and credit score, and per item type the changed,
+ * removed and inserted items. Items are identified by type and description.
+ * The patch is returned in a buffer the caller releases with free().
+ *
+ * financial_profile_patch() applies a patch to a profile equal to a and
+ * leaves its items in b's order, so a sorted b sorts the patched profile
+ * too. Totals that were up to date are adjusted instead of rescanned.
+ * A malformed patch, or one made by a build with a different value_t, is
+ * rejected without modifying the profile.
+ */
+bool                 financial_profile_diff ( const financial_profile_t* a, const financial_profile_t* b, uint8_t** patch, size_t* size );
+bool                 financial_profile_patch( financial_profile_t* profile, const uint8_t* patch, size_t size );
+
 
 typedef enum financial_item_type {
 	FI_ASSET = 0,
@@ -132,12 +210,148 @@ typedef enum financial_item_type {
 	FI_MONTHLY_EXPENSE
 } financial_item_type_t;
 
-financial_item_t*  financial_profile_item_add    ( financial_profile_t* profile, financial_item_type_t type, const char* description, value_t amount );
-bool               financial_profile_item_remove ( financial_profile_t* profile, financial_item_type_t type, size_t index );
-size_t             financial_profile_item_index  ( const financial_profile_t* profile, financial_item_type_t type, const financial_item_t* item );
-financial_item_t*  financial_profile_item_get    ( const financial_profile_t* profile, financial_item_type_t type, size_t index );
-size_t             financial_profile_item_count  ( const financial_profile_t* profile, financial_item_type_t type );
-void               financial_profile_item_clear  ( financial_profile_t* profile, financial_item_type_t type );
+/*
+ * financial_profile_item_get() hands out an item that may be written to,
+ * so it first copies the item's chunk if it is still shared with a fork.
+ * That invalidates earlier pointers into the chunk, and item_get returns
+ * NULL if the copy cannot be made. item_add likewise copies a shared last
+ * chunk. financial_profile_item_at() only reads, and never copies. Both
+ * return NULL for an index out of range, and financial_profile_item_index()
+ * returns SIZE_MAX for an item that is not in the profile.
+ */
+financial_item_t*       financial_profile_item_add    ( financial_profile_t* profile, financial_item_type_t type, const char* description, value_t amount );
+bool                    financial_profile_item_remove ( financial_profile_t* profile, financial_item_type_t type, size_t index );
+size_t                  financial_profile_item_index  ( const financial_profile_t* profile, financial_item_type_t type, const financial_item_t* item );
+financial_item_t*       financial_profile_item_get    ( financial_profile_t* profile, financial_item_type_t type, size_t index );
+const financial_item_t* financial_profile_item_at     ( const financial_profile_t* profile, financial_item_type_t type, size_t index );
+size_t                  financial_profile_item_count  ( const financial_profile_t* profile, financial_item_type_t type );
+void                    financial_profile_item_clear  ( financial_profile_t* profile, financial_item_type_t type );
+
+/*
+ * Batch removal
+ *
+ * Both remove in one pass and return how many items went. With keep_order
+ * the remaining items keep their order; without it, each hole is filled
+ * with the last item, which moves less. The indices given to
+ * financial_profile_item_remove_indices() must be strictly ascending and in
+ * range, or nothing is removed. A clean total is adjusted once by the
+ * amount removed instead of being rescanned.
+ */
+typedef bool (*financial_item_predicate_fxn_t)( const financial_item_t* item, void* data );
+
+size_t             financial_profile_item_remove_if     ( financial_profile_t* profile, financial_item_type_t type, financial_item_predicate_fxn_t predicate, void* data, bool keep_order );
+size_t             financial_profile_item_remove_indices( financial_profile_t* profile, financial_item_type_t type, const size_t* indices, size_t count, bool keep_order );
+
+/*
+ * Items of one type are stored in fixed-size chunks, and a span exposes
+ * one chunk's items directly: the span from first holds items first to
+ * first + count - 1, item first + i living at base + i * stride. The next
+ * span starts where the last one ended, and count is zero past the last
+ * item:
+ *
+ *     for( size_t i = 0; i < n; i += span.count )
+ *         span = financial_profile_item_span( profile, type, i );
+ *
+ * Like item_get, item_span copies its chunk if it is shared with a fork,
+ * and returns an empty span if it cannot; item_const_span only reads.
+ * Spans are invalidated by anything that removes or reorders items of that
+ * type, and as item pointers are by forks and chunk copies.
+ */
+typedef struct financial_item_span {
+	financial_item_t* base;
+	size_t            stride;
+	size_t            count;
+} financial_item_span_t;
+
+typedef struct financial_item_const_span {
+	const financial_item_t* base;
+	size_t                  stride;
+	size_t                  count;
+} financial_item_const_span_t;
+
+financial_item_span_t       financial_profile_item_span       ( financial_profile_t* profile, financial_item_type_t type, size_t first );
+financial_item_const_span_t financial_profile_item_const_span ( const financial_profile_t* profile, financial_item_type_t type, size_t first );
+
+static inline financial_item_t* financial_item_span_at( financial_item_span_t span, size_t index )
+{
+	return (financial_item_t*) ((char*) span.base + index * span.stride);
+}
+
+static inline const financial_item_t* financial_item_const_span_at( financial_item_const_span_t span, size_t index )
+{
+	return (const financial_item_t*) ((const char*) span.base + index * span.stride);
+}
+
+/*
+ * The counter financial_profile_item_version() points to changes whenever
+ * items of that type move to new storage, as when item_get copies a chunk
+ * shared with a fork. Spans and item pointers taken while it held its
+ * current value still point at the profile's items. It lives as long as
+ * the profile.
+ */
+const size_t* financial_profile_item_version( const financial_profile_t* profile, financial_item_type_t type );
+
+/*
+ * financial_profile_foreach() walks the items of one type in batches of
+ * up to batch_size (zero means no limit), passing each batch as a span
+ * along with the index of its first item. A batch never crosses a chunk,
+ * so it may be shorter than batch_size. The visitor stops the walk by
+ * returning false, in which case foreach returns false. Items must not be
+ * modified or added through a visitor, and chunks shared with a fork stay
+ * shared; use financial_profile_item_span() to write in place.
+ */
+typedef bool (*financial_item_visit_fxn_t)( financial_item_span_t batch, size_t first, void* data );
+
+bool financial_profile_foreach( const financial_profile_t* profile, financial_item_type_t type, size_t batch_size, financial_item_visit_fxn_t visit, void* data );
+
+/*
+ * Item handles
+ *
+ * A handle names one item for as long as it exists, whatever is added,
+ * removed or sorted around it. Resolving a handle is O(1), and a handle
+ * whose item was removed stops resolving even after its slot is reused:
+ * financial_profile_item_handle_index() returns SIZE_MAX and
+ * financial_profile_item_resolve() returns NULL. Handles belong to one
+ * profile and item type and are not carried over to forks. The slot table
+ * behind them is only kept for a type once its first handle is taken.
+ */
+typedef uint64_t financial_item_handle_t;
+
+#define FI_HANDLE_NONE                      ((financial_item_handle_t) 0)
+
+financial_item_handle_t financial_profile_item_handle      ( financial_profile_t* profile, financial_item_type_t type, size_t index );
+size_t                  financial_profile_item_handle_index( const financial_profile_t* profile, financial_item_type_t type, financial_item_handle_t handle );
+financial_item_t*       financial_profile_item_resolve     ( financial_profile_t* profile, financial_item_type_t type, financial_item_handle_t handle );
+
+/*
+ * Currencies
+ *
+ * Items are in their profile's currency unless given another one, and
+ * totals are always in the profile's currency. Refresh sums a collection
+ * per currency and converts each subtotal once at the profile's rate for
+ * that currency (units of the profile's currency per unit of it), so a
+ * rate change re-prices clean totals from the kept subtotals without a
+ * rescan. Items can only be moved to a currency that has a rate; items
+ * loaded in a currency without one count as the profile's currency.
+ * Setting the profile's currency relabels its amounts without converting
+ * them, so it fails once any other currency has a rate.
+ * Codes are three letters packed by financial_currency( "EUR" ), and
+ * FC_NONE stands for the profile's currency.
+ */
+typedef uint32_t financial_currency_t;
+
+#define FC_NONE                             ((financial_currency_t) 0)
+
+financial_currency_t financial_currency                 ( const char* code );
+void                 financial_currency_code            ( financial_currency_t currency, char code[ 4 ] );
+financial_currency_t financial_item_currency            ( const financial_item_t* item );
+
+financial_currency_t financial_profile_currency         ( const financial_profile_t* profile );
+bool                 financial_profile_set_currency     ( financial_profile_t* profile, financial_currency_t currency );
+bool                 financial_profile_fx_rate          ( const financial_profile_t* profile, financial_currency_t currency, double* rate );
+bool                 financial_profile_set_fx_rate      ( financial_profile_t* profile, financial_currency_t currency, double rate );
+bool                 financial_profile_item_set_currency( financial_profile_t* profile, financial_item_type_t type, size_t index, financial_currency_t currency );
+bool                 financial_profile_currency_subtotal( const financial_profile_t* profile, financial_item_type_t type, financial_currency_t currency, value_t* subtotal );
 
 
 typedef enum financial_item_sort_method {
@@ -155,6 +369,37 @@ void     financial_profile_sort_items  ( financial_profile_t* profile, financial
  */
 typedef void (*financial_profile_updated_fxn_t)( const financial_profile_t* profile, flags_t flags, void* data );
 
+/*
+ * Update subscriptions
+ *
+ * Any number of listeners can subscribe to a profile with a mask of the
+ * FP_FLAG_* bits they care about. A listener is only notified when a
+ * refresh found one of those bits dirty. Refreshes made between
+ * financial_profile_begin_updates() and financial_profile_end_updates()
+ * are coalesced into a single notification when the outermost batch ends.
+ *
+ * Listeners subscribed with an event queue are not called from the refresh
+ * path. Their updates are posted to the queue and delivered when the host
+ * drains it; repeated updates for the same subscription are merged until
+ * then. A queue may be shared by profiles refreshed on different threads,
+ * but must be drained by one thread, and it must be drained before a
+ * profile with queued listeners is destroyed.
+ */
+struct financial_subscription;
+typedef struct financial_subscription financial_subscription_t;
+struct financial_event_queue;
+typedef struct financial_event_queue financial_event_queue_t;
+
+financial_event_queue_t*   financial_event_queue_create   ( size_t capacity );
+void                       financial_event_queue_destroy  ( financial_event_queue_t** queue );
+size_t                     financial_event_queue_drain    ( financial_event_queue_t* queue, size_t max_events );
+size_t                     financial_event_queue_dropped  ( const financial_event_queue_t* queue );
+
+financial_subscription_t*  financial_profile_subscribe    ( financial_profile_t* profile, flags_t mask, financial_profile_updated_fxn_t callback, void* data, financial_event_queue_t* queue );
+void                       financial_profile_unsubscribe  ( financial_profile_t* profile, financial_subscription_t* subscription );
+void                       financial_profile_begin_updates( financial_profile_t* profile );
+void                       financial_profile_end_updates  ( financial_profile_t* profile );
+
 void     financial_profile_set_updated_callback    ( financial_profile_t* profile, const financial_profile_updated_fxn_t callback );
 void     financial_profile_set_user_data           ( financial_profile_t* profile, void* data );
 flags_t  financial_profile_flags                   ( const financial_profile_t* profile );
@@ -173,47 +418,378 @@ value_t  financial_profile_total_assets            ( const financial_profile_t*
 value_t  financial_profile_total_liabilities       ( const financial_profile_t* profile );
 value_t  financial_profile_total_expenses          ( const financial_profile_t* profile );
 value_t  financial_profile_disposable_income       ( const financial_profile_t* profile );
-value_t  financial_profile_debt_to_income_ratio    ( const financial_profile_t* profile );
+double   financial_profile_debt_to_income_ratio    ( const financial_profile_t* profile );
 value_t  financial_profile_net_worth               ( const financial_profile_t* profile );
 float    financial_profile_progress                ( const financial_profile_t* profile );
 
 void financial_profile_print( FILE* stream, const financial_profile_t* profile );
 
-static inline value_t simple_interest( value_t principle, value_t rate, value_t time )
+/*
+ * Statistics
+ *
+ * When the library is built with WEALTH_STATS (configure --enable-stats)
+ * the hot paths keep per-thread counters and latency histograms. Without
+ * it the instrumentation is compiled out and financial_profile_stats_snapshot()
+ * returns false. financial_profile_stats_reset() starts the counters,
+ * histograms and maxima over for later snapshots.
+ */
+typedef enum financial_stats_op {
+	FS_OP_REFRESH = 0,
+	FS_OP_SORT,
+	FS_OP_ITEM_ADD,
+	FS_OP_ITEM_REMOVE,
+	FS_OP_LOAD,
+	FS_OP_SAVE,
+	FS_OP_COUNT
+} financial_stats_op_t;
+
+typedef enum financial_stats_counter {
+	FS_REFRESH_CALLS = 0,
+	FS_REFRESH_CLEAN,         /* refreshes where nothing was dirty */
+	FS_REFRESH_RESCANS,       /* collections summed from scratch */
+	FS_REFRESH_ITEMS_SCANNED,
+	FS_ITEMS_ADDED,
+	FS_ITEMS_REMOVED,
+	FS_REALLOCS,              /* item storage growth */
+	FS_BYTES_LOADED,
+	FS_BYTES_SAVED,
+	FS_COUNTER_COUNT
+} financial_stats_counter_t;
+
+/* Log-linear buckets: 8 sub-buckets per power of two up to 2^40 ns. */
+#define FS_HISTOGRAM_SUB_BITS        (3)
+#define FS_HISTOGRAM_BUCKETS         (304)
+
+typedef struct financial_stats_histogram {
+	uint64_t count;
+	uint64_t total_ns;
+	uint64_t max_ns;
+	uint64_t buckets[ FS_HISTOGRAM_BUCKETS ];
+} financial_stats_histogram_t;
+
+typedef struct financial_profile_stats {
+	uint64_t                    counters[ FS_COUNTER_COUNT ];
+	financial_stats_histogram_t latency[ FS_OP_COUNT ];
+} financial_profile_stats_t;
+
+typedef enum financial_stats_format {
+	FS_FORMAT_TEXT = 0,
+	FS_FORMAT_JSON
+} financial_stats_format_t;
+
+bool     financial_profile_stats_snapshot   ( financial_profile_stats_t* stats );
+void     financial_profile_stats_reset      ( void );
+uint64_t financial_profile_stats_percentile ( const financial_profile_stats_t* stats, financial_stats_op_t op, double percentile );
+void     financial_profile_stats_print      ( FILE* stream, const financial_profile_stats_t* stats, financial_stats_format_t format );
+
+/*
+ * Parallelism
+ *
+ * Collections with more than serial_threshold items are summed in fixed
+ * size blocks on up to `threads` threads (0 means one per online CPU).
+ * Block boundaries and the order blocks are combined in never depend on the
+ * thread count, so totals are bit-for-bit reproducible.
+ */
+void     financial_set_parallelism ( size_t threads, size_t serial_threshold );
+size_t   financial_thread_count    ( void );
+
+/*
+ * Interest and annuity helpers. Rates and times are always doubles; amounts
+ * are converted at the boundary so these work with either value_t.
+ */
+static inline value_t simple_interest( value_t principle, double rate, double time )
 {
-	return principle * (1 + rate * time );
+	return value_from_double( value_to_double( principle ) * (1 + rate * time ) );
 }
 
-static inline value_t compound_interest( value_t principle, value_t rate, value_t time )
+static inline value_t compound_interest( value_t principle, double rate, double time )
 {
-	return principle * pow(1 + rate, time );
+	return value_from_double( value_to_double( principle ) * pow(1 + rate, time ) );
 }
 
-static inline value_t annuity_present_value( value_t amount, value_t rate, value_t time )
+static inline value_t annuity_present_value( value_t amount, double rate, double time )
 {
-	value_t d = pow(1 + rate, time );
-	return (amount / rate) * (1 - (1/d));
+	double d = pow(1 + rate, time );
+	return value_from_double( (value_to_double( amount ) / rate) * (1 - (1/d)) );
 }
 
-static inline value_t annuity_due_present_value( value_t amount, value_t rate, value_t time )
+static inline value_t annuity_due_present_value( value_t amount, double rate, double time )
 {
-	value_t d = pow(1 + rate, time );
-	return (amount / rate) * (1 - (1/d)) * (1 + rate);
+	double d = pow(1 + rate, time );
+	return value_from_double( (value_to_double( amount ) / rate) * (1 - (1/d)) * (1 + rate) );
 }
 
-static inline value_t annuity_future_value( value_t amount, value_t rate, value_t time )
+static inline value_t annuity_future_value( value_t amount, double rate, double time )
 {
-	return (amount / rate) * (pow(1 + rate, time) - 1);
+	return value_from_double( (value_to_double( amount ) / rate) * (pow(1 + rate, time) - 1) );
 }
 
-static inline value_t annuity_due_future_value( value_t amount, value_t rate, value_t time )
+static inline value_t annuity_due_future_value( value_t amount, double rate, double time )
 {
-	return (amount / rate) * (pow(1 + rate, time) - 1) * (1 + rate);
+	return value_from_double( (value_to_double( amount ) / rate) * (pow(1 + rate, time) - 1) * (1 + rate) );
 }
 
 #ifdef __cplusplus
 } /* extern C Linkage */
+
+/*
+ * The wealth namespace needs C++11 for move-only profiles. Older compilers
+ * can still use the C API above by defining WEALTH_NO_CXX_API.
+ */
+#ifndef WEALTH_NO_CXX_API
+#if __cplusplus < 201103L
+# error "the wealth C++ API needs C++11; define WEALTH_NO_CXX_API to use only the C API"
+#endif
+#include <cstddef>
+#include <iterator>
+#include <utility>
 namespace wealth {
+
+/*
+ * Item type tags. Views and accessors are templated on these so the item
+ * type is fixed at compile time.
+ */
+struct Asset {
+	static const financial_item_type_t type = FI_ASSET;
+	typedef financial_asset_t          c_type;
+	typedef financial_asset_class_t    class_type;
+	static class_type item_class( const c_type* item ) { return financial_asset_class( item ); }
+	static void set_item_class( c_type* item, class_type cls ) { financial_asset_set_class( item, cls ); }
+};
+
+struct Liability {
+	static const financial_item_type_t   type = FI_LIABILITY;
+	typedef financial_liability_t        c_type;
+	typedef financial_liability_class_t  class_type;
+	static class_type item_class( const c_type* item ) { return financial_liability_class( item ); }
+	static void set_item_class( c_type* item, class_type cls ) { financial_liability_set_class( item, cls ); }
+};
+
+struct Expense {
+	static const financial_item_type_t type = FI_MONTHLY_EXPENSE;
+	typedef financial_expense_t        c_type;
+};
+
+/*
+ * A reference to one item; copying it does not copy the item. A reference
+ * from an ItemView reads the item in place and only calls
+ * financial_profile_item_get() to write, so a fork's items are copied one
+ * chunk at a time as they are written. Setters return false if that copy
+ * could not be made.
+ */
+template <class T>
+class ItemRefBase {
+  public:
+	typedef typename T::c_type c_type;
+
+	explicit ItemRefBase( financial_item_t* item ) : m_profile( NULL ), m_index( 0 ), m_item( item ) { }
+	ItemRefBase( financial_profile_t* profile, std::size_t index, const financial_item_t* item ) : m_profile( profile ), m_index( index ), m_item( item ) { }
+
+	const char* description( ) const                    { return financial_item_description( m_item ); }
+	bool        set_description( const char* text )
+	{
+		financial_item_t* item = writable( );
+		if( item ) financial_item_set_description( item, text );
+		return item != NULL;
+	}
+	value_t     amount( ) const                         { return financial_item_amount( m_item ); }
+	bool        set_amount( value_t amount )
+	{
+		financial_item_t* item = writable( );
+		if( item ) financial_item_set_amount( item, amount );
+		return item != NULL;
+	}
+	financial_currency_t currency( ) const              { return financial_item_currency( m_item ); }
+
+	const financial_item_t* item( ) const               { return m_item; }
+	const c_type*           c_item( ) const             { return reinterpret_cast<const c_type*>( m_item ); }
+
+  protected:
+	financial_item_t* writable( )
+	{
+		if( !m_profile )
+		{
+			return const_cast<financial_item_t*>( m_item );
+		}
+
+		financial_item_t* item = financial_profile_item_get( m_profile, T::type, m_index );
+		if( item )
+		{
+			m_item = item;
+		}
+		return item;
+	}
+
+  private:
+	financial_profile_t*    m_profile; /* NULL when m_item is writable */
+	std::size_t             m_index;
+	const financial_item_t* m_item;
+};
+
+template <class T>
+class ItemRef : public ItemRefBase<T> {
+  public:
+	explicit ItemRef( financial_item_t* item ) : ItemRefBase<T>( item ) { }
+	ItemRef( financial_profile_t* profile, std::size_t index, const financial_item_t* item ) : ItemRefBase<T>( profile, index, item ) { }
+
+	typename T::class_type item_class( ) const          { return T::item_class( this->c_item( ) ); }
+	bool set_item_class( typename T::class_type cls )
+	{
+		financial_item_t* item = this->writable( );
+		if( item ) T::set_item_class( reinterpret_cast<typename T::c_type*>( item ), cls );
+		return item != NULL;
+	}
+};
+
+/* Expenses do not store a class. */
+template <>
+class ItemRef<Expense> : public ItemRefBase<Expense> {
+  public:
+	explicit ItemRef( financial_item_t* item ) : ItemRefBase<Expense>( item ) { }
+	ItemRef( financial_profile_t* profile, std::size_t index, const financial_item_t* item ) : ItemRefBase<Expense>( profile, index, item ) { }
+};
+
+/*
+ * A view over every item of type T, in the spirit of std::span. Iterators
+ * read the items one span at a time by pointer arithmetic, with no
+ * per-element type dispatch or bounds check, and take the span again when
+ * they step out of it or financial_profile_item_version() says the items
+ * moved. Invalidated like financial_item_span_t by anything else.
+ */
+template <class T>
+class ItemView {
+  public:
+	class iterator {
+	  public:
+		typedef std::random_access_iterator_tag iterator_category;
+		typedef ItemRef<T>                      value_type;
+		typedef std::ptrdiff_t                  difference_type;
+		typedef ItemRef<T>                      reference;
+		typedef void                            pointer;
+
+		iterator( ) : m_profile( NULL ), m_version( NULL ), m_index( 0 ), m_first( 0 ), m_seen( 0 ) { m_span.count = 0; }
+		iterator( financial_profile_t* profile, std::size_t index )
+		 : m_profile( profile ), m_version( financial_profile_item_version( profile, T::type ) ), m_index( index ), m_first( 0 ), m_seen( 0 )
+		{
+			m_span.count = 0;
+		}
+
+		reference operator*( ) const
+		{
+			if( m_index - m_first >= m_span.count || *m_version != m_seen )
+			{
+				m_span  = financial_profile_item_const_span( m_profile, T::type, m_index );
+				m_first = m_index;
+				m_seen  = *m_version;
+			}
+			return ItemRef<T>( m_profile, m_index, financial_item_const_span_at( m_span, m_index - m_first ) );
+		}
+		reference operator[]( difference_type n ) const { return *(*this + n); }
+		iterator& operator++( )                         { ++m_index; return *this; }
+		iterator  operator++( int )                     { iterator t( *this ); ++*this; return t; }
+		iterator& operator--( )                         { --m_index; return *this; }
+		iterator  operator--( int )                     { iterator t( *this ); --*this; return t; }
+		iterator& operator+=( difference_type n )       { m_index += n; return *this; }
+		iterator& operator-=( difference_type n )       { m_index -= n; return *this; }
+		iterator  operator+( difference_type n ) const  { iterator t( *this ); return t += n; }
+		iterator  operator-( difference_type n ) const  { iterator t( *this ); return t -= n; }
+		difference_type operator-( const iterator& o ) const { return (difference_type) m_index - (difference_type) o.m_index; }
+		bool operator==( const iterator& o ) const      { return m_index == o.m_index; }
+		bool operator!=( const iterator& o ) const      { return m_index != o.m_index; }
+		bool operator<( const iterator& o ) const       { return m_index < o.m_index; }
+		bool operator>( const iterator& o ) const       { return m_index > o.m_index; }
+		bool operator<=( const iterator& o ) const      { return m_index <= o.m_index; }
+		bool operator>=( const iterator& o ) const      { return m_index >= o.m_index; }
+
+	  private:
+		financial_profile_t*                m_profile;
+		const std::size_t*                  m_version;
+		std::size_t                         m_index;
+		/* The span holding m_index, taken again when the iterator leaves it or the items move. */
+		mutable financial_item_const_span_t m_span;
+		mutable std::size_t                 m_first;
+		mutable std::size_t                 m_seen;
+	};
+
+	explicit ItemView( financial_profile_t* profile ) : m_profile( profile ), m_count( financial_profile_item_count( profile, T::type ) ) { }
+
+	std::size_t size( ) const                    { return m_count; }
+	bool        empty( ) const                   { return m_count == 0; }
+	ItemRef<T>  operator[]( std::size_t i ) const { return begin( )[ (std::ptrdiff_t) i ]; }
+	iterator    begin( ) const                   { return iterator( m_profile, 0 ); }
+	iterator    end( ) const                     { return iterator( m_profile, m_count ); }
+
+  private:
+	financial_profile_t* m_profile;
+	std::size_t          m_count;
+};
+
+/* Owns a financial_profile_t; move-only. */
+class Profile {
+  public:
+	Profile( ) : m_profile( financial_profile_create( ) ) { }
+	explicit Profile( financial_profile_t* profile ) : m_profile( profile ) { }
+	~Profile( ) { financial_profile_destroy( &m_profile ); }
+
+	Profile( Profile&& other ) noexcept : m_profile( other.release( ) ) { }
+	Profile& operator=( Profile&& other ) noexcept
+	{
+		if( this != &other )
+		{
+			financial_profile_destroy( &m_profile );
+			m_profile = other.release( );
+		}
+		return *this;
+	}
+	Profile( const Profile& ) = delete;
+	Profile& operator=( const Profile& ) = delete;
+	explicit operator bool( ) const                  { return m_profile != NULL; }
+
+	static Profile load( const char* filename )      { return Profile( financial_profile_load( filename ) ); }
+	Profile fork( )                                  { return Profile( financial_profile_fork( m_profile ) ); }
+	bool save( const char* filename ) const          { return financial_profile_save( m_profile, filename ); }
+
+	financial_profile_t* get( ) const                { return m_profile; }
+	financial_profile_t* release( )                  { financial_profile_t* p = m_profile; m_profile = NULL; return p; }
+
+	template <class T> ItemView<T> items( ) const    { return ItemView<T>( m_profile ); }
+	template <class T> std::size_t count( ) const    { return financial_profile_item_count( m_profile, T::type ); }
+	template <class T> ItemRef<T> add( const char* description, value_t amount )
+	{
+		return ItemRef<T>( financial_profile_item_add( m_profile, T::type, description, amount ) );
+	}
+	template <class T> bool remove( std::size_t index ) { return financial_profile_item_remove( m_profile, T::type, index ); }
+	template <class T> financial_item_handle_t handle( std::size_t index ) { return financial_profile_item_handle( m_profile, T::type, index ); }
+	template <class T> ItemRef<T> resolve( financial_item_handle_t handle ) const
+	{
+		return ItemRef<T>( financial_profile_item_resolve( m_profile, T::type, handle ) );
+	}
+	template <class T> void clear( )                  { financial_profile_item_clear( m_profile, T::type ); }
+	template <class T> void sort( financial_item_sort_method_t method ) { financial_profile_sort_items( m_profile, T::type, method ); }
+
+	void    refresh( )                               { financial_profile_refresh( m_profile ); }
+	value_t total_assets( ) const                    { return financial_profile_total_assets( m_profile ); }
+	value_t total_liabilities( ) const               { return financial_profile_total_liabilities( m_profile ); }
+	value_t total_expenses( ) const                  { return financial_profile_total_expenses( m_profile ); }
+	value_t net_worth( ) const                       { return financial_profile_net_worth( m_profile ); }
+	value_t goal( ) const                            { return financial_profile_goal( m_profile ); }
+	void    set_goal( value_t goal )                 { financial_profile_set_goal( m_profile, goal ); }
+	value_t monthly_income( ) const                  { return financial_profile_monthly_income( m_profile ); }
+	void    set_monthly_income( value_t income )     { financial_profile_set_monthly_income( m_profile, income ); }
+
+	financial_currency_t currency( ) const           { return financial_profile_currency( m_profile ); }
+	bool set_currency( financial_currency_t currency ) { return financial_profile_set_currency( m_profile, currency ); }
+	bool set_fx_rate( financial_currency_t currency, double rate ) { return financial_profile_set_fx_rate( m_profile, currency, rate ); }
+	template <class T> bool set_currency( std::size_t index, financial_currency_t currency )
+	{
+		return financial_profile_item_set_currency( m_profile, T::type, index, currency );
+	}
+
+  private:
+	financial_profile_t* m_profile;
+};
+
 } /* namespace wealth */
+#endif /* WEALTH_NO_CXX_API */
 #endif
 #endif /* _WEALTH_H_ */
@@ -0,0 +1,499 @@
+/*
+ * Copyright (C) 2015 Joseph A. Marrero.  http://www.manvscode.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#ifdef __ANDROID__
+#include <vector.h>
+#else
+#include <libcollections/vector.h>
+#endif
+#include "wealth.h"
+#include "item.h"
+
+/*
+ * Throughput benchmarks for the core library paths.
+ *
+ * Usage: bench [max-items] [output.json]
+ *
+ * Every benchmark runs at sizes 10, 100, ..., max-items (default 10^7) and
+ * the results are written as a single JSON document.  Each result reports
+ * the time per call (ns_per_op), the time per item touched (ns_per_item),
+ * items/s and, where meaningful, bytes/s.
+ */
+
+#define arr_len(arr)             (sizeof(arr) / sizeof(arr[0]))
+#define BENCH_MIN_SECONDS        (0.25)
+#define BENCH_MAX_REPETITIONS    (1000000)
+#define BENCH_FILENAME           ("./bench-profile.fp")
+
+typedef struct bench_result {
+	const char* name;
+	size_t      items;
+	size_t      repetitions;
+	double      seconds;
+	double      bytes;  /* bytes processed per repetition */
+} bench_result_t;
+
+static FILE* output = NULL;
+static bool first_result = true;
+
+static double now_seconds( void )
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint32_t rng_state = 0x9E3779B9u;
+
+static uint32_t rng_next( void )
+{
+	/* xorshift32, deterministic so runs are comparable. */
+	uint32_t x = rng_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	rng_state = x;
+	return x;
+}
+
+static value_t random_amount( void )
+{
+	return value_from_double( (rng_next( ) % 10000000u) / 100.0 );
+}
+
+static void random_description( char* buffer, size_t size )
+{
+	static const char* words[] = { "Checking", "Savings", "Fidelity", "Roth IRA", "Mortgage", "Car Loan", "Visa", "Brokerage", "Rent", "Groceries" };
+	snprintf( buffer, size, "%s %08x", words[ rng_next( ) % arr_len(words) ], rng_next( ) );
+}
+
+static void report( const bench_result_t* r )
+{
+	double per_op   = r->seconds / r->repetitions;
+	double ns_op    = 1e9 * per_op;
+	double ns_item  = r->items ? ns_op / r->items : ns_op;
+	double items_s  = r->items ? r->items / per_op : 1.0 / per_op;
+	double bytes_s  = r->bytes > 0.0 ? r->bytes / per_op : 0.0;
+
+	fprintf( output, "%s\n    { \"name\": \"%s\", \"items\": %zu, \"repetitions\": %zu, "
+	                 "\"ns_per_op\": %.3f, \"ns_per_item\": %.3f, \"items_per_sec\": %.1f, \"bytes_per_sec\": %.1f }",
+	         first_result ? "" : ",", r->name, r->items, r->repetitions,
+	         ns_op, ns_item, items_s, bytes_s );
+	first_result = false;
+	fflush( output );
+}
+
+static size_t repetitions_for( size_t items )
+{
+	size_t reps = items ? (10000000 / items) : BENCH_MAX_REPETITIONS;
+	return reps < 1 ? 1 : reps;
+}
+
+static financial_profile_t* make_profile( size_t n, char (*descriptions)[ sizeof(desc_short_t) ], const value_t* amounts )
+{
+	financial_profile_t* profile = financial_profile_create( );
+	financial_item_type_t types[] = { FI_ASSET, FI_LIABILITY, FI_MONTHLY_EXPENSE };
+
+	for( size_t t = 0; t < arr_len(types); t++ )
+	{
+		for( size_t i = 0; i < n; i++ )
+		{
+			financial_profile_item_add( profile, types[ t ], descriptions[ i ], amounts[ i ] );
+		}
+	}
+
+	financial_profile_refresh( profile );
+	return profile;
+}
+
+static void bench_item_add( size_t n, char (*descriptions)[ sizeof(desc_short_t) ], const value_t* amounts )
+{
+	bench_result_t r = { .name = "item_add", .items = n, .bytes = (double) n * sizeof(financial_asset_t) };
+	double elapsed = 0.0;
+
+	while( elapsed < BENCH_MIN_SECONDS || r.repetitions == 0 )
+	{
+		financial_profile_t* profile = financial_profile_create( );
+		double start = now_seconds( );
+		for( size_t i = 0; i < n; i++ )
+		{
+			financial_profile_item_add( profile, FI_ASSET, descriptions[ i ], amounts[ i ] );
+		}
+		elapsed += now_seconds( ) - start;
+		r.repetitions += 1;
+		financial_profile_destroy( &profile );
+	}
+
+	r.seconds = elapsed;
+	report( &r );
+}
+
+static void bench_collection_sums( size_t n, const value_t* amounts )
+{
+	financial_asset_t* assets;
+	financial_liability_t* liabilities;
+	financial_expense_t* expenses;
+	volatile value_t sink = 0;
+
+	vector_create( assets, n );
+	vector_create( liabilities, n );
+	vector_create( expenses, n );
+
+	for( size_t i = 0; i < n; i++ )
+	{
+		vector_push_emplace( assets );
+		vector_push_emplace( liabilities );
+		vector_push_emplace( expenses );
+		memset( &vector_last(assets), 0, sizeof(financial_asset_t) );
+		memset( &vector_last(liabilities), 0, sizeof(financial_liability_t) );
+		memset( &vector_last(expenses), 0, sizeof(financial_expense_t) );
+		vector_last(assets).base.amount      = amounts[ i ];
+		vector_last(liabilities).base.amount = amounts[ i ];
+		vector_last(expenses).base.amount    = amounts[ i ];
+	}
+
+	struct {
+		const char* name;
+		size_t item_size;
+	} sums[] = {
+		{ "asset_collection_sum", sizeof(financial_asset_t) },
+		{ "liability_collection_sum", sizeof(financial_liability_t) },
+		{ "expense_collection_sum", sizeof(financial_expense_t) },
+	};
+
+	for( size_t s = 0; s < arr_len(sums); s++ )
+	{
+		bench_result_t r = { .name = sums[ s ].name, .items = n, .bytes = (double) n * sums[ s ].item_size };
+		size_t reps = repetitions_for( n );
+		double start = now_seconds( );
+
+		do {
+			for( size_t k = 0; k < reps; k++ )
+			{
+				switch( s )
+				{
+					case 0: sink += financial_asset_collection_sum( assets ); break;
+					case 1: sink += financial_liability_collection_sum( liabilities ); break;
+					default: sink += financial_expense_collection_sum( expenses ); break;
+				}
+			}
+			r.repetitions += reps;
+			r.seconds = now_seconds( ) - start;
+		} while( r.seconds < BENCH_MIN_SECONDS );
+
+		report( &r );
+	}
+
+	(void) sink;
+	vector_destroy( assets );
+	vector_destroy( liabilities );
+	vector_destroy( expenses );
+}
+
+static void bench_refresh( size_t n, char (*descriptions)[ sizeof(desc_short_t) ], const value_t* amounts )
+{
+	financial_profile_t* profile = make_profile( n, descriptions, amounts );
+
+	/* Nothing dirty; measures the fast path. */
+	{
+		bench_result_t r = { .name = "profile_refresh_clean", .items = 3 * n };
+		size_t reps = BENCH_MAX_REPETITIONS / 10;
+		double start = now_seconds( );
+
+		do {
+			for( size_t k = 0; k < reps; k++ )
+			{
+				financial_profile_refresh( profile );
+			}
+			r.repetitions += reps;
+			r.seconds = now_seconds( ) - start;
+		} while( r.seconds < BENCH_MIN_SECONDS );
+
+		report( &r );
+	}
+
+	/* Adding an item dirties the assets and forces a full rescan; the item
+	 * is removed again so the collection does not grow. */
+	{
+		bench_result_t r = { .name = "profile_refresh_dirty", .items = n, .bytes = (double) n * sizeof(financial_asset_t) };
+		size_t reps = repetitions_for( n );
+		double start = now_seconds( );
+
+		do {
+			for( size_t k = 0; k < reps; k++ )
+			{
+				financial_profile_item_add( profile, FI_ASSET, "Bench", value_from_double( 1.0 ) );
+				financial_profile_refresh( profile );
+				financial_profile_item_remove( profile, FI_ASSET, n );
+			}
+			r.repetitions += reps;
+			r.seconds = now_seconds( ) - start;
+		} while( r.seconds < BENCH_MIN_SECONDS );
+
+		report( &r );
+	}
+
+	financial_profile_destroy( &profile );
+}
+
+static void restore_items( financial_profile_t* profile, size_t n, char (*descriptions)[ sizeof(desc_short_t) ], const value_t* amounts )
+{
+	for( size_t i = 0; i < n; i++ )
+	{
+		financial_item_t* item = financial_profile_item_get( profile, FI_ASSET, i );
+		financial_item_set_description( item, descriptions[ i ] );
+		financial_item_set_amount( item, amounts[ i ] );
+	}
+}
+
+static void bench_sort( size_t n, char (*descriptions)[ sizeof(desc_short_t) ], const value_t* amounts )
+{
+	static const struct {
+		const char* name;
+		financial_item_sort_method_t method;
+	} methods[] = {
+		{ "sort_description_asc", FI_SORT_DESCRIPTION_ASC },
+		{ "sort_description_des", FI_SORT_DESCRIPTION_DES },
+		{ "sort_amount_asc", FI_SORT_AMOUNT_ASC },
+		{ "sort_amount_des", FI_SORT_AMOUNT_DES },
+	};
+
+	financial_profile_t* profile = financial_profile_create( );
+	for( size_t i = 0; i < n; i++ )
+	{
+		financial_profile_item_add( profile, FI_ASSET, descriptions[ i ], amounts[ i ] );
+	}
+
+	for( size_t m = 0; m < arr_len(methods); m++ )
+	{
+		bench_result_t r = { .name = methods[ m ].name, .items = n, .bytes = (double) n * sizeof(financial_asset_t) };
+		double elapsed = 0.0;
+
+		while( elapsed < BENCH_MIN_SECONDS || r.repetitions == 0 )
+		{
+			restore_items( profile, n, descriptions, amounts );
+			double start = now_seconds( );
+			financial_profile_sort_items( profile, FI_ASSET, methods[ m ].method );
+			elapsed += now_seconds( ) - start;
+			r.repetitions += 1;
+		}
+
+		r.seconds = elapsed;
+		report( &r );
+	}
+
+	financial_profile_destroy( &profile );
+}
+
+static void bench_load_save( size_t n, char (*descriptions)[ sizeof(desc_short_t) ], const value_t* amounts )
+{
+	financial_profile_t* profile = make_profile( n, descriptions, amounts );
+	double bytes = 0.0;
+
+	{
+		bench_result_t r = { .name = "profile_save", .items = 3 * n };
+		double start = now_seconds( );
+
+		do {
+			financial_profile_save( profile, BENCH_FILENAME );
+			r.repetitions += 1;
+			r.seconds = now_seconds( ) - start;
+		} while( r.seconds < BENCH_MIN_SECONDS );
+
+		FILE* file = fopen( BENCH_FILENAME, "rb" );
+		if( file )
+		{
+			fseek( file, 0, SEEK_END );
+			bytes = (double) ftell( file );
+			fclose( file );
+		}
+
+		r.bytes = bytes;
+		report( &r );
+	}
+
+	{
+		bench_result_t r = { .name = "profile_load", .items = 3 * n, .bytes = bytes };
+		double start = now_seconds( );
+
+		do {
+			financial_profile_t* loaded = financial_profile_load( BENCH_FILENAME );
+			financial_profile_destroy( &loaded );
+			r.repetitions += 1;
+			r.seconds = now_seconds( ) - start;
+		} while( r.seconds < BENCH_MIN_SECONDS );
+
+		report( &r );
+	}
+
+	remove( BENCH_FILENAME );
+	financial_profile_destroy( &profile );
+}
+
+static void bench_print( size_t n, char (*descriptions)[ sizeof(desc_short_t) ], const value_t* amounts )
+{
+	financial_profile_t* profile = make_profile( n, descriptions, amounts );
+	FILE* stream = tmpfile( );
+
+	if( stream )
+	{
+		bench_result_t r = { .name = "profile_print", .items = 3 * n };
+		double start = now_seconds( );
+
+		do {
+			rewind( stream );
+			financial_profile_print( stream, profile );
+			r.repetitions += 1;
+			r.seconds = now_seconds( ) - start;
+		} while( r.seconds < BENCH_MIN_SECONDS );
+
+		r.bytes = (double) ftell( stream );
+		report( &r );
+		fclose( stream );
+	}
+
+	financial_profile_destroy( &profile );
+}
+
+static void bench_annuities( void )
+{
+	#define ANNUITY_SAMPLES   (4096)
+	static double rates[ ANNUITY_SAMPLES ];
+	static double times[ ANNUITY_SAMPLES ];
+	volatile value_t sink = 0;
+
+	for( size_t i = 0; i < ANNUITY_SAMPLES; i++ )
+	{
+		rates[ i ] = (1 + rng_next( ) % 2000) / 120000.0;
+		times[ i ] = 1 + rng_next( ) % 480;
+	}
+
+	static const char* names[] = {
+		"simple_interest",
+		"compound_interest",
+		"annuity_present_value",
+		"annuity_due_present_value",
+		"annuity_future_value",
+		"annuity_due_future_value",
+	};
+
+	for( size_t f = 0; f < arr_len(names); f++ )
+	{
+		bench_result_t r = { .name = names[ f ], .items = ANNUITY_SAMPLES };
+		size_t reps = 100;
+		double start = now_seconds( );
+
+		do {
+			for( size_t k = 0; k < reps; k++ )
+			{
+				value_t acc = 0;
+				for( size_t i = 0; i < ANNUITY_SAMPLES; i++ )
+				{
+					switch( f )
+					{
+						case 0: acc += simple_interest( value_from_double( 1000.0 ), rates[ i ], times[ i ] ); break;
+						case 1: acc += compound_interest( value_from_double( 1000.0 ), rates[ i ], times[ i ] ); break;
+						case 2: acc += annuity_present_value( value_from_double( 100.0 ), rates[ i ], times[ i ] ); break;
+						case 3: acc += annuity_due_present_value( value_from_double( 100.0 ), rates[ i ], times[ i ] ); break;
+						case 4: acc += annuity_future_value( value_from_double( 100.0 ), rates[ i ], times[ i ] ); break;
+						default: acc += annuity_due_future_value( value_from_double( 100.0 ), rates[ i ], times[ i ] ); break;
+					}
+				}
+				sink += acc;
+			}
+			r.repetitions += reps;
+			r.seconds = now_seconds( ) - start;
+		} while( r.seconds < BENCH_MIN_SECONDS );
+
+		report( &r );
+	}
+
+	(void) sink;
+	#undef ANNUITY_SAMPLES
+}
+
+int main( int argc, char *argv[] )
+{
+	size_t max_items = 10000000;
+	output = stdout;
+
+	if( argc >= 2 )
+	{
+		max_items = strtoul( argv[1], NULL, 10 );
+	}
+
+	if( argc >= 3 )
+	{
+		output = fopen( argv[2], "w" );
+		if( !output )
+		{
+			fprintf( stderr, "Unable to open %s\n", argv[2] );
+			return 1;
+		}
+	}
+
+	char (*descriptions)[ sizeof(desc_short_t) ] = malloc( max_items * sizeof(desc_short_t) );
+	value_t* amounts = malloc( max_items * sizeof(value_t) );
+
+	if( !descriptions || !amounts )
+	{
+		fprintf( stderr, "Unable to allocate %zu items\n", max_items );
+		return 1;
+	}
+
+	for( size_t i = 0; i < max_items; i++ )
+	{
+		random_description( descriptions[ i ], sizeof(desc_short_t) );
+		amounts[ i ] = random_amount( );
+	}
+
+	fprintf( output, "{\n  \"library\": \"libwealth\",\n" );
+#if defined(__OPTIMIZE__) && defined(NDEBUG)
+	fprintf( output, "  \"optimized\": true,\n" );
+#else
+	fprintf( output, "  \"optimized\": false,\n" );
+#endif
+	fprintf( output, "  \"results\": [" );
+
+	bench_annuities( );
+
+	for( size_t n = 10; n <= max_items; n *= 10 )
+	{
+		bench_item_add( n, descriptions, amounts );
+		bench_collection_sums( n, amounts );
+		bench_refresh( n, descriptions, amounts );
+		bench_sort( n, descriptions, amounts );
+		bench_load_save( n, descriptions, amounts );
+		bench_print( n, descriptions, amounts );
+	}
+
+	fprintf( output, "\n  ]\n}\n" );
+
+	free( descriptions );
+	free( amounts );
+	if( output != stdout ) fclose( output );
+	return 0;
+}
@@ -64,57 +64,57 @@ financial_profile_t* create_profile( void )
 	financial_profile_t* profile = financial_profile_create( );
 	financial_profile_set_updated_callback( profile, profile_updated_event );
 
-	//financial_profile_set_salary( profile, 114000.0 );
-	financial_profile_set_monthly_income( profile, 6400.0 );
-	financial_profile_set_goal( profile, 100000.0 );
+	//financial_profile_set_salary( profile, value_from_double( 114000.0 ) );
+	financial_profile_set_monthly_income( profile, value_from_double( 6400.0 ) );
+	financial_profile_set_goal( profile, value_from_double( 100000.0 ) );
 
 	// Assets
 	{
-		financial_profile_item_add( profile, FI_ASSET, "Chase Checking (885715037)", 0.0 );
-		financial_profile_item_add( profile, FI_ASSET, "Simple Account", 0.0 );
-		financial_profile_item_add( profile, FI_ASSET, "2005 Jeep Wrangler", 9271.0 );
-		financial_profile_item_add( profile, FI_ASSET, "Fidelity: Joe (X51799718)", 1000.1 );
-		financial_profile_item_add( profile, FI_ASSET, "Fidelity: Simple IRA (414155055)", 3964.57 );
-		financial_profile_item_add( profile, FI_ASSET, "TD Ameritrade", 0.0 );
-		financial_profile_item_add( profile, FI_ASSET, "7 Silver Coins", 140.0 );
-		financial_profile_item_add( profile, FI_ASSET, "Cash", 500.0 );
-		financial_profile_item_add( profile, FI_ASSET, "Gun: Glock 19C", 350.0 );
-		financial_profile_item_add( profile, FI_ASSET, "Gun: Sig Saur 250", 250.0 );
-		financial_profile_item_add( profile, FI_ASSET, "Gun: Sig Saur P226 MK25", 600.0 );
-		financial_profile_item_add( profile, FI_ASSET, "Gun: Mossberg 590A1", 350.0 );
-		financial_profile_item_add( profile, FI_ASSET, "Gun: Remington 700", 600.0 );
-		financial_profile_item_add( profile, FI_ASSET, "Gun: Smith & Wesson M&P15", 400.0 );
-		financial_profile_item_add( profile, FI_ASSET, "PayPal", 0.0 );
-		financial_profile_item_add( profile, FI_ASSET, "Fidelity: Roth IRA (211845892)", 968.70 );
-		financial_profile_item_add( profile, FI_ASSET, "Fidelity: Rollover IRA (218515595)", 2584.17 );
+		financial_profile_item_add( profile, FI_ASSET, "Chase Checking (885715037)", value_from_double( 0.0 ) );
+		financial_profile_item_add( profile, FI_ASSET, "Simple Account", value_from_double( 0.0 ) );
+		financial_profile_item_add( profile, FI_ASSET, "2005 Jeep Wrangler", value_from_double( 9271.0 ) );
+		financial_profile_item_add( profile, FI_ASSET, "Fidelity: Joe (X51799718)", value_from_double( 1000.1 ) );
+		financial_profile_item_add( profile, FI_ASSET, "Fidelity: Simple IRA (414155055)", value_from_double( 3964.57 ) );
+		financial_profile_item_add( profile, FI_ASSET, "TD Ameritrade", value_from_double( 0.0 ) );
+		financial_profile_item_add( profile, FI_ASSET, "7 Silver Coins", value_from_double( 140.0 ) );
+		financial_profile_item_add( profile, FI_ASSET, "Cash", value_from_double( 500.0 ) );
+		financial_profile_item_add( profile, FI_ASSET, "Gun: Glock 19C", value_from_double( 350.0 ) );
+		financial_profile_item_add( profile, FI_ASSET, "Gun: Sig Saur 250", value_from_double( 250.0 ) );
+		financial_profile_item_add( profile, FI_ASSET, "Gun: Sig Saur P226 MK25", value_from_double( 600.0 ) );
+		financial_profile_item_add( profile, FI_ASSET, "Gun: Mossberg 590A1", value_from_double( 350.0 ) );
+		financial_profile_item_add( profile, FI_ASSET, "Gun: Remington 700", value_from_double( 600.0 ) );
+		financial_profile_item_add( profile, FI_ASSET, "Gun: Smith & Wesson M&P15", value_from_double( 400.0 ) );
+		financial_profile_item_add( profile, FI_ASSET, "PayPal", value_from_double( 0.0 ) );
+		financial_profile_item_add( profile, FI_ASSET, "Fidelity: Roth IRA (211845892)", value_from_double( 968.70 ) );
+		financial_profile_item_add( profile, FI_ASSET, "Fidelity: Rollover IRA (218515595)", value_from_double( 2584.17 ) );
 	}
 
 	// Liabilities
 	{
-		financial_profile_item_add( profile, FI_LIABILITY, "Capital One Card (...9648)", 0.0 );
-		financial_profile_item_add( profile, FI_LIABILITY, "Chase Freedom Card (...4872)", 500.0 );
-		financial_profile_item_add( profile, FI_LIABILITY, "Fidelity AmEx Card (...3366)", 0.0 );
-		financial_profile_item_add( profile, FI_LIABILITY, "Home Mortgage", 1100.0 );
+		financial_profile_item_add( profile, FI_LIABILITY, "Capital One Card (...9648)", value_from_double( 0.0 ) );
+		financial_profile_item_add( profile, FI_LIABILITY, "Chase Freedom Card (...4872)", value_from_double( 500.0 ) );
+		financial_profile_item_add( profile, FI_LIABILITY, "Fidelity AmEx Card (...3366)", value_from_double( 0.0 ) );
+		financial_profile_item_add( profile, FI_LIABILITY, "Home Mortgage", value_from_double( 1100.0 ) );
 	}
 
 	// Expenses
 	{
-		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "FPL", 115.0 );
-		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Gym", 66.0 );
-		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Comcast", 65.0 );
-		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Progressive Auto Insurance", 160.0 );
-		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Rent", 995.0 );
-		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Amazon Prime", 8.0 );
-		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Amazon Web Services", 52.0 );
-		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Food (Groceries and fast food)", 400.0 );
-		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Entertainment", 400.0 );
-		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Tolls (Joe+Kat)", 150.0 );
-		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Gas/Fuel", 400.0 );
-		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Two Haircuts", 50.0 );
-		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Miscellaneous", 100.0 );
-		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Kat's + Joe T-Mobile Service", 100.0 );
-		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Kat's Gas/Fuel", 320.0 );
-		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Kat Stipend", 390.0 );
+		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "FPL", value_from_double( 115.0 ) );
+		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Gym", value_from_double( 66.0 ) );
+		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Comcast", value_from_double( 65.0 ) );
+		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Progressive Auto Insurance", value_from_double( 160.0 ) );
+		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Rent", value_from_double( 995.0 ) );
+		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Amazon Prime", value_from_double( 8.0 ) );
+		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Amazon Web Services", value_from_double( 52.0 ) );
+		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Food (Groceries and fast food)", value_from_double( 400.0 ) );
+		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Entertainment", value_from_double( 400.0 ) );
+		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Tolls (Joe+Kat)", value_from_double( 150.0 ) );
+		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Gas/Fuel", value_from_double( 400.0 ) );
+		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Two Haircuts", value_from_double( 50.0 ) );
+		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Miscellaneous", value_from_double( 100.0 ) );
+		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Kat's + Joe T-Mobile Service", value_from_double( 100.0 ) );
+		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Kat's Gas/Fuel", value_from_double( 320.0 ) );
+		financial_profile_item_add( profile, FI_MONTHLY_EXPENSE, "Kat Stipend", value_from_double( 390.0 ) );
 	}
 
 	financial_profile_refresh( profile );
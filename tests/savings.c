@@ -25,6 +25,7 @@
 #include <time.h>
 #include <locale.h>
 #include <wealth.h>
+#include <projection.h>
 
 static const char* months[] = {
 	"Jan",
@@ -54,6 +55,33 @@ static const double rates[] = {
 
 #define arr_len(arr) (sizeof(arr) / sizeof(arr[0]))
 
+typedef struct table_context {
+	int start_year;
+	int start_month;
+} table_context_t;
+
+/* Names the month a period ends in, e.g. "Jul 2015". */
+static void table_label( const table_context_t* table, size_t period, char* label, size_t size )
+{
+	int p = table->start_month + (int) period - 1;
+
+	snprintf( label, size, "%s %d", months[ p % 12 ], table->start_year + p / 12 );
+}
+
+static bool pretty_row( void* context, size_t period, double deposit, const double* balances, size_t rate_count )
+{
+	char label[ 32 ];
+
+	table_label( context, period, label, sizeof(label) );
+	printf( "%-8s   ", label );
+	for( size_t i = 0; i < rate_count; i++ )
+	{
+		printf( "$%'-13.2f ", balances[ i ] );
+	}
+	printf( "\n" );
+	return true;
+}
+
 void pretty_table( double monthly_deposit, int years, int start_year, int start_month )
 {
 	printf( "Monthly Deposit =  $%'.2f\n", monthly_deposit );
@@ -69,68 +97,46 @@ void pretty_table( double monthly_deposit, int years, int start_year, int start_
 
 	printf( "\n------------------------------------------------------------------------------------------------------------------------------\n" );
 
-	int end_month = start_month + 12 * years;
-	int year = start_year;
-	int period = 1;
+	financial_schedule_t schedule = financial_schedule_monthly( monthly_deposit );
+	table_context_t context = { .start_year = start_year, .start_month = start_month };
+	financial_projection_sink_t sink = { .begin = NULL, .row = pretty_row, .end = NULL, .context = &context };
 
-	for( int p = start_month; p < end_month; p++ )
-	{
-		int month = p % 12;
-
-		if( p != start_month && month == 0 )
-		{
-			year += 1;
-		}
-
-		printf( "%-3s %4d   ", months[month], year );
-		for( int i = 0; i < arr_len(rates); i++ )
-		{
-			double r = rates[ i ];
-			double t = annuity_future_value( monthly_deposit, r / 12, period );
-			printf( "$%'-13.2f ", t );
-		}
-
-		period += 1;
-		printf( "\n" );
-	}
+	financial_projection_run( &schedule, 0.0, rates, arr_len(rates), 12 * years, &sink );
 }
 
-void csv_table( double monthly_deposit, int years, int start_year, int start_month )
+static bool csv_header( void* context, const double* rates, size_t rate_count, size_t periods )
 {
 	printf( "Month" );
-	for( int i = 0; i < arr_len(rates); i++ )
+	for( size_t i = 0; i < rate_count; i++ )
 	{
-		double r = rates[ i ];
-		printf( ",%s (%d%%)", "Total", (int) (100 * r) );
+		printf( ",%s (%d%%)", "Total", (int) (100 * rates[ i ]) );
 	}
 	printf( "\n" );
+	return true;
+}
 
-	int end_month = start_month + 12 * years;
-	int year = start_year;
-	int period = 1;
+static bool csv_row( void* context, size_t period, double deposit, const double* balances, size_t rate_count )
+{
+	char label[ 32 ];
 
-	for( int p = start_month; p < end_month; p++ )
+	table_label( context, period, label, sizeof(label) );
+	printf( "%s", label );
+	for( size_t i = 0; i < rate_count; i++ )
 	{
-		int month = p % 12;
-
-		if( p != start_month && month == 0 )
-		{
-			year += 1;
-		}
-
-		printf( "%s %d", months[p % 12], year );
-		for( int i = 0; i < arr_len(rates); i++ )
-		{
-			double r = rates[ i ];
-			double t = annuity_future_value( monthly_deposit, r / 12, period );
-			printf( ",%.2f", t );
-		}
-
-		period += 1;
-		printf( "\n" );
+		printf( ",%.2f", balances[ i ] );
 	}
+	printf( "\n" );
+	return true;
 }
 
+void csv_table( double monthly_deposit, int years, int start_year, int start_month )
+{
+	financial_schedule_t schedule = financial_schedule_monthly( monthly_deposit );
+	table_context_t context = { .start_year = start_year, .start_month = start_month };
+	financial_projection_sink_t sink = { .begin = csv_header, .row = csv_row, .end = NULL, .context = &context };
+
+	financial_projection_run( &schedule, 0.0, rates, arr_len(rates), 12 * years, &sink );
+}
 
 int main( int argc, char *argv[] )
 {
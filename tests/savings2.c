@@ -25,9 +25,8 @@
 #include <time.h>
 #include <locale.h>
 #include <wealth.h>
-
-static bool is_leap( int year );
-static int get_last_day( int month, int year );
+#include <projection.h>
+#include <calendar.h>
 
 static const char* months[] = {
 	"Jan",
@@ -57,6 +56,35 @@ static const double rates[] = {
 
 #define arr_len(arr) (sizeof(arr) / sizeof(arr[0]))
 
+typedef struct table_context {
+	int start_year;
+	int start_month;
+} table_context_t;
+
+/* Names the day a half-month period ends on, e.g. "Jul 15 2015". */
+static void table_label( const table_context_t* table, size_t period, char* label, size_t size )
+{
+	int p = table->start_month + (int) (period - 1) / 2;
+	int month = p % 12;
+	int year = table->start_year + p / 12;
+
+	snprintf( label, size, "%s %d %d", months[month], period % 2 == 1 ? 15 : financial_date_days_in_month(year, month + 1), year );
+}
+
+static bool pretty_row( void* context, size_t period, double deposit, const double* balances, size_t rate_count )
+{
+	char label[ 32 ];
+
+	table_label( context, period, label, sizeof(label) );
+	printf( "%-11s   ", label );
+	for( size_t i = 0; i < rate_count; i++ )
+	{
+		printf( "$%'-13.2f ", balances[ i ] );
+	}
+	printf( "\n" );
+	return true;
+}
+
 void pretty_table( double monthly_deposit, int years, int start_year, int start_month )
 {
 	printf( "Monthly Deposit =  $%'.2f\n", monthly_deposit );
@@ -72,71 +100,46 @@ void pretty_table( double monthly_deposit, int years, int start_year, int start_
 
 	printf( "\n------------------------------------------------------------------------------------------------------------------------------\n" );
 
-	int end_month = start_month + 12 * years;
-	int year = start_year;
-	int period = 1;
+	financial_schedule_t schedule = financial_schedule_semi_monthly( monthly_deposit );
+	table_context_t context = { .start_year = start_year, .start_month = start_month };
+	financial_projection_sink_t sink = { .begin = NULL, .row = pretty_row, .end = NULL, .context = &context };
 
-	for( int p = start_month; p < end_month; p++ )
-	{
-		int month = p % 12;
-
-		if( p != start_month && month == 0 )
-		{
-			year += 1;
-		}
-
-		for(int q = 0; q < 2; q++ )
-		{
-			printf( "%-3s %d %4d   ", months[month], q == 0 ? 15 : get_last_day(month, year), year );
-			for( int i = 0; i < arr_len(rates); i++ )
-			{
-				double r = rates[ i ];
-				double t = annuity_future_value( monthly_deposit, r / 24, period );
-				printf( "$%'-13.2f ", t );
-			}
-
-			period += 1;
-			printf( "\n" );
-		}
-	}
+	financial_projection_run( &schedule, 0.0, rates, arr_len(rates), 24 * years, &sink );
 }
 
-void csv_table( double monthly_deposit, int years, int start_year, int start_month )
+static bool csv_header( void* context, const double* rates, size_t rate_count, size_t periods )
 {
 	printf( "Month" );
-	for( int i = 0; i < arr_len(rates); i++ )
+	for( size_t i = 0; i < rate_count; i++ )
 	{
-		double r = rates[ i ];
-		printf( ",%s (%d%%)", "Total", (int) (100 * r) );
+		printf( ",%s (%d%%)", "Total", (int) (100 * rates[ i ]) );
 	}
 	printf( "\n" );
+	return true;
+}
 
-	int end_month = start_month + 12 * years;
-	int year = start_year;
-	int period = 1;
+static bool csv_row( void* context, size_t period, double deposit, const double* balances, size_t rate_count )
+{
+	char label[ 32 ];
 
-	for( int p = start_month; p < end_month; p++ )
+	table_label( context, period, label, sizeof(label) );
+	printf( "%s", label );
+	for( size_t i = 0; i < rate_count; i++ )
 	{
-		int month = p % 12;
-
-		if( p != start_month && month == 0 )
-		{
-			year += 1;
-		}
-
-		printf( "%s %d", months[p % 12], year );
-		for( int i = 0; i < arr_len(rates); i++ )
-		{
-			double r = rates[ i ];
-			double t = annuity_future_value( monthly_deposit, r / 24, period );
-			printf( ",%.2f", t );
-		}
-
-		period += 1;
-		printf( "\n" );
+		printf( ",%.2f", balances[ i ] );
 	}
+	printf( "\n" );
+	return true;
 }
 
+void csv_table( double monthly_deposit, int years, int start_year, int start_month )
+{
+	financial_schedule_t schedule = financial_schedule_semi_monthly( monthly_deposit );
+	table_context_t context = { .start_year = start_year, .start_month = start_month };
+	financial_projection_sink_t sink = { .begin = csv_header, .row = csv_row, .end = NULL, .context = &context };
+
+	financial_projection_run( &schedule, 0.0, rates, arr_len(rates), 24 * years, &sink );
+}
 
 int main( int argc, char *argv[] )
 {
@@ -176,27 +179,3 @@ int main( int argc, char *argv[] )
 
 	return 0;
 }
-
-bool is_leap( int year )
-{
-	return year % 4 == 0;
-}
-
-int get_last_day( int month, int year )
-{
-	const int ndays[]={ 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
-	int result = -1;
-
-	if( month >= 0 && month < 12 )
-	{
-		result = ndays[ month ];
-
-		if( is_leap(year) && month == 1 )
-		{
-			result += 1;
-		}
-	}
-
-	return result;
-}
-